@@ -0,0 +1,316 @@
+/*
+  Program name: binner
+  Native replacement of egamma-ta-al-in/scripts/binner.py,
+  same arguments, same output:
+
+    binner INPFILE 2000              #prints to stdout
+    binner INPFILE 2000 OUTFILE
+    binner INPFILE 2000 OUTFILE 102400
+
+  The file is read twice(min/max, then histogramm) by blocks of
+  BATCH lines, memory does not depend on the file size.
+
+  May be distributed and modified under the terms of the GNU
+  General Public License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+*/
+#include "fast_parse.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+/** Lines per batch of the histogramm pass, as in binner.py*/
+#define BINNER_DEFAULT_BATCH (1024*300)
+
+/** Lines per batch of the min/max pass, binner.py always uses 1024 there.*/
+#define BINNER_MIN_MAX_BATCH 1024
+
+/** Bytes of the read buffer per line of the batch.*/
+#define BINNER_BYTES_PER_LINE 32
+
+/** Smallest read buffer.*/
+#define BINNER_MIN_BUFFER (64*1024)
+
+static const char *usage =
+  "Program name: binner\n"
+  "Synopsis:\n"
+  "    binner INPFILE 2000 [OUTFILE] [102400]\n\n"
+  "INPFILE -- file with 1 or more columns of floating point values(C-locale).\n"
+  "2000    -- quantity of bins, the (max - min) range is chopped into.\n"
+  "OUTFILE -- (optional) output file, 2 columns: bin position, count.\n"
+  "           Without it the histogramm is printed to stdout.\n"
+  "102400  -- (optional) max number of lines processed at one time.\n\n"
+  "Output is the same as of scripts/binner.py.\n";
+
+/**
+   Reads a file by blocks and splits them into lines,
+   the buffer is allocated once and grows only for a line longer than it.
+ */
+class line_reader
+{
+public:
+  line_reader(const size_t buffer_size)
+    : buffer(buffer_size), fp(NULL), begin(0), filled(0), eof(false)
+  {
+  }
+
+  ~line_reader()
+  {
+    if(fp != NULL) fclose(fp);
+  }
+
+  bool open(const char *filename)
+  {
+    fp = fopen(filename, "rb");
+    return fp != NULL;
+  }
+
+  /** Next line without '\n', the last line may have no '\n'.
+      \return false at the end of file.*/
+  bool next(const char *&line, const char *&line_end)
+  {
+    for(;;)
+      {
+	const char *start = &buffer[0] + begin;
+	const char *stop = &buffer[0] + filled;
+	const char *newline = (const char*)memchr(start, '\n', stop - start);
+	if(newline != NULL)
+	  {
+	    line = start;
+	    line_end = newline;
+	    begin = newline - &buffer[0] + 1;
+	    return true;
+	  }
+	if(eof)
+	  {
+	    if(start == stop) return false;
+	    line = start;
+	    line_end = stop;
+	    begin = filled;
+	    return true;
+	  }
+	//move the incomplete line to the beginning and read more:
+	memmove(&buffer[0], start, stop - start);
+	filled -= begin;
+	begin = 0;
+	if(filled == buffer.size())
+	  buffer.resize(2*buffer.size());
+	size_t n = fread(&buffer[0] + filled, 1, buffer.size() - filled, fp);
+	filled += n;
+	if(n == 0) eof = true;
+      }
+  }
+
+private:
+  std::vector<char> buffer;
+  FILE *fp;
+  size_t begin;
+  size_t filled;
+  bool eof;
+};
+
+/** Parse one whitespace-separated token like Python's float() does:
+    correctly rounded, the whole token must be a number.
+    \return false if it's not a number.*/
+static bool parse_token(const char *token, const char *token_end, double &value)
+{
+  const char *p = token;
+  bool exact = false;
+  if(fast_parse_number(p, token_end, value, exact) && p == token_end && exact)
+    return true;
+  //rare: many digits, big exponents, inf/nan or a bad word:
+  char small[64];
+  std::string big;
+  const size_t length = token_end - token;
+  char *copy = small;
+  if(length >= sizeof(small))
+    {
+      big.assign(token, length);
+      copy = &big[0];
+    }
+  else
+    {
+      memcpy(small, token, length);
+      small[length] = '\0';
+    }
+  if(memchr(token, 'x', length) != NULL || memchr(token, 'X', length) != NULL)
+    return false;//strtod() takes hex, float() does not
+  char *stop = NULL;
+  value = strtod(copy, &stop);
+  return length > 0 && stop == copy + length;
+}
+
+/**
+   Call (param4) for every value of the file, going by batches of lines
+   like binner.py does. It stops processing a batch at the first line
+   without values, the rest of the batch is skipped: the output has to be
+   the same as the script's one.
+   \return 0 if ok, -1 if the file can't be read or has got a bad value.
+*/
+template <typename F>
+static int scan_file(const char *filename, const size_t batch, const size_t buffer_size,
+		     F &book)
+{
+  line_reader reader(buffer_size);
+  if(!reader.open(filename))
+    {
+      fprintf(stderr, "ERROR! can't open file %s\n", filename);
+      return -1;
+    }
+  const char *line, *line_end;
+  size_t line_no = 0;
+  bool skip_batch = false;
+  while(reader.next(line, line_end))
+    {
+      if(line_no % batch == 0) skip_batch = false;
+      line_no++;
+      if(skip_batch) continue;
+      const char *p = line;
+      bool any = false;
+      for(;;)
+	{
+	  while(p < line_end && fast_parse_is_space(*p)) p++;
+	  if(p >= line_end) break;
+	  const char *token = p;
+	  while(p < line_end && !fast_parse_is_space(*p)) p++;
+	  double value;
+	  if(!parse_token(token, p, value))
+	    {
+	      fprintf(stderr, "ERROR! could not convert string to float: '%.*s' at line %lu\n",
+		      (int)(p - token), token, (unsigned long)line_no);
+	      return -1;
+	    }
+	  book(value);
+	  any = true;
+	}
+      if(!any) skip_batch = true;
+    }
+  return 0;
+}
+
+/** min/max of the values, as get_min_max() of the script,
+    -1 and -0.1 if there are no values.*/
+struct min_max_booking
+{
+  min_max_booking() : min(-1), max(-0.1), first(true) {}
+  void operator()(const double value)
+  {
+    if(first)
+      {
+	min = max = value;
+	first = false;
+      }
+    min = (value < min)? value : min;
+    max = (value > max)? value : max;
+  }
+  double min, max;
+  bool first;
+};
+
+/** Counts of bins, the value equal to max goes to the extra bin
+    number n_bins, as in make_histogramm_file() of the script.*/
+struct histogramm_booking
+{
+  histogramm_booking(const double minval, const double step, const size_t n_bins)
+    : min(minval), h(step), counts(n_bins + 1, 0), bad(false) {}
+  void operator()(const double value)
+  {
+    const double position = (value - min)/h;
+    if(!(position >= 0 && position < counts.size()))
+      {
+	bad = true;
+	return;
+      }
+    counts[(size_t)position]++;
+  }
+  double min, h;
+  std::vector<unsigned long long> counts;
+  bool bad;
+};
+
+/** str() of numpy.float64: "%.12g", ".0" is added to integers.*/
+static int format_value(char *buf, const size_t size, const double value)
+{
+  int n = snprintf(buf, size, "%.12g", value);
+  int i = (buf[0] == '-')? 1 : 0;
+  while(i < n && buf[i] >= '0' && buf[i] <= '9') i++;
+  if(i == n && n + 3 <= (int)size)
+    {
+      strcpy(buf + n, ".0");
+      n += 2;
+    }
+  return n;
+}
+
+int main(int argc, char **argv)
+{
+  if(argc > 1 && strstr(argv[1], "-help") != NULL)
+    {
+      printf("%s", usage);
+      return 0;
+    }
+  if(argc < 2)
+    {
+      printf("%s", usage);
+      return -1;
+    }
+  const char *in_filename = argv[1];
+  std::string out_filename = "stdout";
+  long n_bins = 2000;
+  if(argc > 2) n_bins = atol(argv[2]);
+  if(argc > 3) out_filename = argv[3];
+  long batch = BINNER_DEFAULT_BATCH;
+  if(argc > 4) batch = atol(argv[4]);
+  if(batch < 1) batch = 1;
+  size_t buffer_size = batch*BINNER_BYTES_PER_LINE;
+  if(buffer_size < BINNER_MIN_BUFFER) buffer_size = BINNER_MIN_BUFFER;
+
+  min_max_booking range;
+  if(scan_file(in_filename, BINNER_MIN_MAX_BATCH, buffer_size, range) != 0)
+    return -1;
+  if(!(range.max - range.min > 0 && n_bins > 0))
+    {
+      printf("Wrong min, max or n_bins values!\n");
+      return 0;
+    }
+  const double h = (range.max - range.min)/n_bins;
+  histogramm_booking histogramm(range.min, h, n_bins);
+  if(scan_file(in_filename, batch, buffer_size, histogramm) != 0)
+    return -1;
+  if(histogramm.bad)
+    {
+      fprintf(stderr, "ERROR! value out of [min, max] range, NaN in the file?\n");
+      return -1;
+    }
+
+  FILE *out = stdout;
+  if(out_filename != "stdout")
+    {
+      out = fopen(out_filename.c_str(), "w");
+      if(out == NULL)
+	{
+	  fprintf(stderr, "ERROR! can't write file %s\n", out_filename.c_str());
+	  return -1;
+	}
+    }
+  std::vector<char> output_buffer(1 << 20);
+  if(out != stdout)
+    setvbuf(out, &output_buffer[0], _IOFBF, output_buffer.size());
+  char line[128];
+  for(long i = 0; i <= n_bins; i++)
+    {
+      //the bin positions are not shifted by min, like in the script:
+      const double position = (i < n_bins)? (i + 0.5)*h : 0;
+      int n = format_value(line, 60, position);
+      line[n++] = '\t';
+      n += format_value(line + n, 60, (double)histogramm.counts[i]);
+      line[n++] = '\n';
+      fwrite(line, 1, n, out);
+    }
+  if(out != stdout)
+    fclose(out);
+  printf("success\n");
+  return 0;
+}
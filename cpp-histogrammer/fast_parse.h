@@ -0,0 +1,157 @@
+#ifndef FAST_PARSE_H
+#define FAST_PARSE_H
+
+/**
+   Parser of C-locale floating point numbers like
+   "3.14157", "-1e-5", "+.5E3" from a memory buffer,
+   no locale, no allocations, no iostreams.
+ **/
+
+/** Powers of ten 1e0..1e22 are exact in double.*/
+static const double fast_parse_pow10[] =
+  {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+    1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20,
+    1e21, 1e22
+  };
+
+/** Multiply or divide value by 10^exponent.*/
+inline double fast_parse_scale(double value, int exponent)
+{
+  if(exponent < 0)
+    {
+      while(exponent < -22)
+	{
+	  value /= 1e22;
+	  exponent += 22;
+	}
+      return value / fast_parse_pow10[-exponent];
+    }
+  while(exponent > 22)
+    {
+      value *= 1e22;
+      exponent -= 22;
+    }
+  return value * fast_parse_pow10[exponent];
+}
+
+inline bool fast_parse_is_space(const char c)
+{
+  return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+/** Parse the next number, whitespaces before it are skipped.
+    \param pointer to the current position, it's moved past the number.
+    \param end of the buffer.
+    \param parsed value.
+    \param set to true if the value is correctly rounded(like strtod() does):
+    up to 19 significant digits, mantissa < 2^53 and |exponent| <= 22,
+    otherwise the value may differ from the nearest double by few ulp.
+    \return true if the number has been parsed, false at the end of buffer
+    or at a character that can't start a number(the position is moved
+    past the bad word then).
+**/
+inline bool fast_parse_number(const char *&p, const char *end, double &value, bool &exact)
+{
+  while(p < end && fast_parse_is_space(*p)) p++;
+  if(p >= end) return false;
+
+  bool negative = false;
+  if(*p == '-' || *p == '+')
+    {
+      negative = (*p == '-');
+      p++;
+    }
+  unsigned long long mantissa = 0;
+  int digits = 0;
+  int exponent = 0;
+  bool any_digit = false;
+  bool truncated = false;
+  //integer part:
+  while(p < end && (unsigned)(*p - '0') < 10)
+    {
+      if(digits < 19)
+	{
+	  mantissa = mantissa*10 + (*p - '0');
+	  if(mantissa != 0) digits++;
+	}
+      else
+	{//digits beyond the precision of mantissa
+	  exponent++;
+	  truncated = truncated || (*p != '0');
+	}
+      any_digit = true;
+      p++;
+    }
+  //fraction:
+  if(p < end && *p == '.')
+    {
+      p++;
+      while(p < end && (unsigned)(*p - '0') < 10)
+	{
+	  if(digits < 19)
+	    {
+	      mantissa = mantissa*10 + (*p - '0');
+	      if(mantissa != 0) digits++;
+	      exponent--;
+	    }
+	  else
+	    truncated = truncated || (*p != '0');
+	  any_digit = true;
+	  p++;
+	}
+    }
+  if(!any_digit)
+    {//skip the bad word:
+      while(p < end && !fast_parse_is_space(*p)) p++;
+      return false;
+    }
+  //exponent:
+  if(p < end && (*p == 'e' || *p == 'E'))
+    {
+      const char *mark = p;
+      p++;
+      bool exp_negative = false;
+      if(p < end && (*p == '-' || *p == '+'))
+	{
+	  exp_negative = (*p == '-');
+	  p++;
+	}
+      if(p < end && (unsigned)(*p - '0') < 10)
+	{
+	  int e = 0;
+	  while(p < end && (unsigned)(*p - '0') < 10)
+	    {
+	      if(e < 10000) e = e*10 + (*p - '0');
+	      p++;
+	    }
+	  exponent += (exp_negative)? -e : e;
+	}
+      else
+	p = mark;//"1e" -- not an exponent
+    }
+  value = (double)mantissa;
+  if(exponent != 0)
+    value = fast_parse_scale(value, exponent);
+  if(negative) value = -value;
+  exact = !truncated && mantissa <= (1ULL << 53) && exponent >= -22 && exponent <= 22;
+  return true;
+}
+
+/** Same as fast_parse_number(), when exactness does not matter.*/
+inline bool fast_parse_double(const char *&p, const char *end, double &value)
+{
+  bool exact;
+  return fast_parse_number(p, end, value, exact);
+}
+
+/** Same as fast_parse_double(), but for float.*/
+inline bool fast_parse_float(const char *&p, const char *end, float &value)
+{
+  double v;
+  if(!fast_parse_double(p, end, v)) return false;
+  value = (float)v;
+  return true;
+}
+
+#endif
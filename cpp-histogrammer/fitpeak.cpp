@@ -0,0 +1,170 @@
+/*
+  Program name: fitpeak
+  Fits a gaussian peak on a linear background in the [XMIN, XMAX] window
+  of many spectra at once, see lmfit.h:
+
+    fitpeak XMIN XMAX FILE1 [FILE2 ...]
+
+  May be distributed and modified under the terms of the GNU
+  General Public License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+*/
+#include "lmfit.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <sys/time.h>
+
+/** Table of the results.*/
+#define FITPEAK_SUMMARY_NAME "fitpeak_summary.dat"
+
+static const char *usage =
+  "Program name: fitpeak\n"
+  "Synopsis:\n"
+  "    fitpeak XMIN XMAX FILE1 [FILE2 ...]\n\n"
+  "FILE -- spectrum, 2 columns: x, counts(histogrammer output).\n"
+  "The points with x in [XMIN, XMAX] are fitted by\n"
+  "    A*exp(-(x - X0)^2/(2*SIGMA^2)) + B + K*x\n"
+  "with errors sqrt(counts), like call_mpfit() of fitexpr.py does.\n"
+  "Files are fitted concurrently, one thread per core(FITPEAK_THREADS\n"
+  "environment variable may set the number), the results are written to\n"
+  FITPEAK_SUMMARY_NAME ".\n";
+
+/** One spectrum, points of the window only.*/
+struct fitpeak_item
+{
+  std::string name;
+  xydata<double> data;
+  std::vector<double> errors;
+};
+
+/** Points of the file within [xmin, xmax] and their errors.
+    \return 0 if there are enough points to fit.*/
+static int load_window(fitpeak_item &item, const double xmin, const double xmax)
+{
+  xydata<double> all;
+  if(all.read_file(item.name) != 0) return -1;
+  std::vector<double> x, y;
+  bool ok = true;
+  for(size_t i = 0; i < all.size() && ok; i++)
+    {
+      const double xi = all.x(i, ok), yi = all.y(i, ok);
+      if(!(xi >= xmin && xi <= xmax)) continue;
+      x.push_back(xi);
+      y.push_back(yi);
+      item.errors.push_back(sqrt((yi > 1)? yi : 1.0));
+    }
+  if(x.size() < 6) return -1;
+  item.data.set_data(x, y);
+  return 0;
+}
+
+/** Start values and limits from the window.*/
+static std::vector<lmfit_parinfo> guess(const fitpeak_item &item, const double xmin,
+					const double xmax)
+{
+  bool ok = true;
+  size_t top = 0;
+  double low = item.data.y(0, ok), high = low;
+  for(size_t i = 1; i < item.data.size(); i++)
+    {
+      const double yi = item.data.y(i, ok);
+      if(yi > high)
+	{
+	  high = yi;
+	  top = i;
+	}
+      low = (yi < low)? yi : low;
+    }
+  std::vector<lmfit_parinfo> parinfo(5);
+  parinfo[0] = lmfit_parinfo(high - low);
+  parinfo[0].parname = "A";
+  parinfo[0].limited[0] = true;
+  parinfo[1] = lmfit_parinfo(item.data.x(top, ok));
+  parinfo[1].parname = "X0";
+  parinfo[1].limited[0] = parinfo[1].limited[1] = true;
+  parinfo[1].limits[0] = xmin;
+  parinfo[1].limits[1] = xmax;
+  parinfo[2] = lmfit_parinfo((xmax - xmin)/10);
+  parinfo[2].parname = "SIGMA";
+  parinfo[2].limited[0] = true;
+  parinfo[2].limits[0] = (xmax - xmin)*1e-6;
+  parinfo[3] = lmfit_parinfo(low);
+  parinfo[3].parname = "B";
+  parinfo[4] = lmfit_parinfo(0);
+  parinfo[4].parname = "K";
+  return parinfo;
+}
+
+int main(int argc, char **argv)
+{
+  if(argc > 1 && strstr(argv[1], "-help") != NULL)
+    {
+      printf("%s", usage);
+      return 0;
+    }
+  if(argc < 4)
+    {
+      printf("%s", usage);
+      return -1;
+    }
+  const double xmin = atof(argv[1]), xmax = atof(argv[2]);
+  if(!(xmax > xmin))
+    {
+      printf("Wrong XMIN, XMAX!\n");
+      return -1;
+    }
+  std::vector<fitpeak_item> items(argc - 3);
+  std::vector<lmfit_task> tasks(items.size());
+  for(size_t i = 0; i < items.size(); i++)
+    {
+      items[i].name = argv[i + 3];
+      if(load_window(items[i], xmin, xmax) != 0)
+	{
+	  fprintf(stderr, "(error) can't read enough points of %s\n", argv[i + 3]);
+	  continue;
+	}
+      tasks[i].data = &items[i].data;
+      tasks[i].errors = &items[i].errors[0];
+      tasks[i].parinfo = guess(items[i], xmin, xmax);
+    }
+  size_t n_threads = 0;
+  if(getenv("FITPEAK_THREADS") != NULL)
+    n_threads = atol(getenv("FITPEAK_THREADS"));
+
+  struct timeval t0, t1;
+  gettimeofday(&t0, NULL);
+  std::vector<lmfit_result> results;
+  lmfit_many(lmfit_gauss_peak(), tasks, std::vector<lmfit_parinfo>(), results, n_threads);
+  gettimeofday(&t1, NULL);
+
+  FILE *out = fopen(FITPEAK_SUMMARY_NAME, "w");
+  if(out == NULL)
+    {
+      fprintf(stderr, "ERROR! can't write file %s\n", FITPEAK_SUMMARY_NAME);
+      return -1;
+    }
+  fprintf(out, "#file\tstatus\tA\terr\tX0\terr\tSIGMA\terr\tB\terr\tK\terr\tchi2\tdof\n");
+  int failed = 0;
+  for(size_t i = 0; i < items.size(); i++)
+    {
+      const lmfit_result &result = results[i];
+      if(tasks[i].data == NULL || result.status <= 0)
+	{
+	  failed++;
+	  fprintf(out, "%s\t%d\n", items[i].name.c_str(), result.status);
+	  continue;
+	}
+      fprintf(out, "%s\t%d", items[i].name.c_str(), result.status);
+      for(size_t j = 0; j < result.params.size(); j++)
+	fprintf(out, "\t%.10g\t%.4g", result.params[j], result.perror[j]);
+      fprintf(out, "\t%.10g\t%ld\n", result.chi2, result.dof);
+    }
+  fclose(out);
+  printf("%lu spectra fitted in %.3f s, %d failed, results are in %s\n",
+	 (unsigned long)items.size(),
+	 (t1.tv_sec - t0.tv_sec) + 1e-6*(t1.tv_usec - t0.tv_usec),
+	 failed, FITPEAK_SUMMARY_NAME);
+  return (failed == 0)? 0 : -1;
+}
@@ -0,0 +1,514 @@
+#include "lmfit.h"
+#include <math.h>
+#include <float.h>
+#include <thread>
+#include <atomic>
+
+/** Largest damping before the step is considered impossible.*/
+#define LMFIT_MAX_LAMBDA 1e32
+
+/**
+   Residuals and jacobian of one fit in the space of free parameters,
+   fixed and tied ones are filled in by expand().
+*/
+class lmfit_problem
+{
+public:
+  lmfit_problem(const lmfit_model &m, const std::vector<lmfit_parinfo> &info,
+		const lmfit_config &c)
+    : model(m), parinfo(info), config(c), nfev(0)
+  {
+  }
+
+  /** \return 0 if parinfo is fine and all points are read.*/
+  int init(const xydata<double> &data, const double *errors)
+  {
+    const size_t n = model.size();
+    if(parinfo.size() != n || data.size() == 0) return -1;
+    for(size_t i = 0; i < n; i++)
+      {
+	const lmfit_parinfo &info = parinfo[i];
+	if(info.tied_to >= 0)
+	  {
+	    if((size_t)info.tied_to >= n || (size_t)info.tied_to == i
+	       || parinfo[info.tied_to].tied_to >= 0)
+	      return -1;
+	    continue;
+	  }
+	if(info.limited[0] && info.limited[1] && info.limits[0] >= info.limits[1])
+	  return -1;
+	if((info.limited[0] && info.value < info.limits[0])
+	   || (info.limited[1] && info.value > info.limits[1]))
+	  return -1;
+	if(!info.fixed)
+	  free_index.push_back(i);
+      }
+    const size_t m = data.size();
+    if(free_index.empty() || m < free_index.size()) return -1;
+    x.resize(m);
+    y.resize(m);
+    weight.assign(m, 1.0);
+    size_t bytes, items;
+    data.copy_xdata(bytes, items, &x[0]);
+    data.copy_ydata(bytes, items, &y[0]);
+    if(errors != NULL)
+      for(size_t i = 0; i < m; i++)
+	weight[i] = (errors[i] > 0)? 1.0/errors[i] : 0;
+    full.resize(n);
+    dfdp.resize(n);
+    return 0;
+  }
+
+  size_t n_free() const
+  {
+    return free_index.size();
+  }
+
+  size_t n_points() const
+  {
+    return x.size();
+  }
+
+  /** Start values of free parameters.*/
+  void start(std::vector<double> &p) const
+  {
+    p.resize(free_index.size());
+    for(size_t j = 0; j < p.size(); j++)
+      p[j] = parinfo[free_index[j]].value;
+  }
+
+  /** Free parameters -> all parameters.*/
+  void expand(const double *p, double *all) const
+  {
+    const size_t n = parinfo.size();
+    for(size_t i = 0; i < n; i++)
+      all[i] = parinfo[i].value;
+    for(size_t j = 0; j < free_index.size(); j++)
+      all[free_index[j]] = p[j];
+    for(size_t i = 0; i < n; i++)
+      if(parinfo[i].tied_to >= 0)
+	all[i] = parinfo[i].tied_scale*all[parinfo[i].tied_to] + parinfo[i].tied_offset;
+  }
+
+  /** Move p[j] into the limits of it's parameter.*/
+  double clamp(const size_t j, const double value) const
+  {
+    const lmfit_parinfo &info = parinfo[free_index[j]];
+    if(info.limited[0] && value < info.limits[0]) return info.limits[0];
+    if(info.limited[1] && value > info.limits[1]) return info.limits[1];
+    return value;
+  }
+
+  /** -1 if p[j] is at the lower limit, 1 if at the upper, 0 otherwise.*/
+  int at_limit(const size_t j, const double value) const
+  {
+    const lmfit_parinfo &info = parinfo[free_index[j]];
+    if(info.limited[0] && value <= info.limits[0]) return -1;
+    if(info.limited[1] && value >= info.limits[1]) return 1;
+    return 0;
+  }
+
+  /** residuals r[i] = (y[i] - f(x[i]))/error[i].
+      \return chi2, NaN if the model gave NaN.*/
+  double residuals(const std::vector<double> &p, std::vector<double> &r)
+  {
+    expand(&p[0], &full[0]);
+    r.resize(x.size());
+    double chi2 = 0;
+    for(size_t i = 0; i < x.size(); i++)
+      {
+	r[i] = (y[i] - model.value(&full[0], x[i]))*weight[i];
+	chi2 += r[i]*r[i];
+      }
+    nfev++;
+    return chi2;
+  }
+
+  /** Jacobian dr[i]/dp[j] of the free parameters, point by point(row of n_free()).*/
+  void jacobian(const std::vector<double> &p, const std::vector<double> &r,
+		std::vector<double> &jac)
+  {
+    const size_t m = x.size(), nf = free_index.size(), n = parinfo.size();
+    jac.assign(m*nf, 0.0);
+    expand(&p[0], &full[0]);
+    if(model.gradient(&full[0], x[0], &dfdp[0]))
+      {
+	for(size_t i = 0; i < m; i++)
+	  {
+	    model.gradient(&full[0], x[i], &dfdp[0]);
+	    for(size_t j = 0; j < nf; j++)
+	      {
+		double d = dfdp[free_index[j]];
+		for(size_t k = 0; k < n; k++)
+		  if(parinfo[k].tied_to == (int)free_index[j])
+		    d += parinfo[k].tied_scale*dfdp[k];
+		jac[i*nf + j] = -weight[i]*d;
+	      }
+	  }
+	return;
+      }
+    std::vector<double> shifted(p), r1, r2;
+    for(size_t j = 0; j < nf; j++)
+      {
+	const lmfit_parinfo &info = parinfo[free_index[j]];
+	double h = info.step;
+	if(!(h > 0) && info.relstep > 0)
+	  h = info.relstep*fabs(p[j]);
+	if(!(h > 0))
+	  h = sqrt(std::max(config.epsfcn, DBL_EPSILON))*fabs(p[j]);
+	if(!(h > 0))
+	  h = sqrt(std::max(config.epsfcn, DBL_EPSILON));
+	//the model may be undefined out of the limits:
+	const bool up_ok = clamp(j, p[j] + h) == p[j] + h;
+	const bool down_ok = clamp(j, p[j] - h) == p[j] - h;
+	if(info.side == 2 && up_ok && down_ok)
+	  {
+	    shifted[j] = p[j] + h;
+	    residuals(shifted, r1);
+	    shifted[j] = p[j] - h;
+	    residuals(shifted, r2);
+	    for(size_t i = 0; i < m; i++)
+	      jac[i*nf + j] = (r1[i] - r2[i])/(2*h);
+	    shifted[j] = p[j];
+	    continue;
+	  }
+	if(info.side == -1)
+	  h = -h;
+	if(clamp(j, p[j] + h) != p[j] + h)
+	  {//the other side, or up to the farther limit if both are too near:
+	    h = -h;
+	    if(clamp(j, p[j] + h) != p[j] + h)
+	      {
+		const double up = clamp(j, p[j] + fabs(h)) - p[j];
+		const double down = clamp(j, p[j] - fabs(h)) - p[j];
+		h = (up >= -down)? up : down;
+	      }
+	  }
+	if(h == 0)
+	  continue;//no room between the limits, the column stays 0
+	shifted[j] = p[j] + h;
+	residuals(shifted, r1);
+	for(size_t i = 0; i < m; i++)
+	  jac[i*nf + j] = (r1[i] - r[i])/h;
+	shifted[j] = p[j];
+      }
+  }
+
+  const lmfit_model &model;
+  const std::vector<lmfit_parinfo> &parinfo;
+  const lmfit_config &config;
+  /** model index of each free parameter*/
+  std::vector<size_t> free_index;
+  std::vector<double> x, y, weight;
+  int nfev;
+
+private:
+  std::vector<double> full, dfdp;
+};
+
+/** Cholesky decomposition of the symmetric n*n matrix a in place(lower triangle).
+    \return false if it's not positive definite.*/
+static bool cholesky(std::vector<double> &a, const size_t n)
+{
+  for(size_t j = 0; j < n; j++)
+    {
+      double d = a[j*n + j];
+      for(size_t k = 0; k < j; k++) d -= a[j*n + k]*a[j*n + k];
+      if(!(d > 0)) return false;
+      d = sqrt(d);
+      a[j*n + j] = d;
+      for(size_t i = j + 1; i < n; i++)
+	{
+	  double s = a[i*n + j];
+	  for(size_t k = 0; k < j; k++) s -= a[i*n + k]*a[j*n + k];
+	  a[i*n + j] = s/d;
+	}
+    }
+  return true;
+}
+
+/** Solve L*L^T*x = b, L is from cholesky().*/
+static void cholesky_solve(const std::vector<double> &l, const size_t n, double *b)
+{
+  for(size_t i = 0; i < n; i++)
+    {
+      double s = b[i];
+      for(size_t k = 0; k < i; k++) s -= l[i*n + k]*b[k];
+      b[i] = s/l[i*n + i];
+    }
+  for(size_t i = n; i-- > 0; )
+    {
+      double s = b[i];
+      for(size_t k = i + 1; k < n; k++) s -= l[k*n + i]*b[k];
+      b[i] = s/l[i*n + i];
+    }
+}
+
+/** A = J^T*J and g = J^T*r.*/
+static void normal_equations(const std::vector<double> &jac, const std::vector<double> &r,
+			     const size_t nf, std::vector<double> &A, std::vector<double> &g)
+{
+  A.assign(nf*nf, 0.0);
+  g.assign(nf, 0.0);
+  for(size_t i = 0; i < r.size(); i++)
+    {
+      const double *row = &jac[i*nf];
+      for(size_t j = 0; j < nf; j++)
+	{
+	  g[j] += row[j]*r[i];
+	  for(size_t k = 0; k <= j; k++)
+	    A[j*nf + k] += row[j]*row[k];
+	}
+    }
+  for(size_t j = 0; j < nf; j++)
+    for(size_t k = 0; k < j; k++)
+      A[k*nf + j] = A[j*nf + k];
+}
+
+static double norm2(const std::vector<double> &v)
+{
+  double s = 0;
+  for(size_t i = 0; i < v.size(); i++) s += v[i]*v[i];
+  return sqrt(s);
+}
+
+/** Covariance of all parameters from J^T*J of the free ones,
+    tied parameters get it through their scale.*/
+static void covariance(const lmfit_problem &problem, std::vector<double> A,
+		       lmfit_result &result)
+{
+  const size_t nf = problem.n_free(), n = problem.parinfo.size();
+  result.covar.assign(n*n, 0.0);
+  result.perror.assign(n, 0.0);
+  if(!cholesky(A, nf)) return;
+  //T maps free parameters to all of them:
+  std::vector<double> T(n*nf, 0.0);
+  for(size_t j = 0; j < nf; j++)
+    T[problem.free_index[j]*nf + j] = 1;
+  for(size_t i = 0; i < n; i++)
+    {
+      const int master = problem.parinfo[i].tied_to;
+      if(master < 0) continue;
+      for(size_t j = 0; j < nf; j++)
+	if(problem.free_index[j] == (size_t)master)
+	  T[i*nf + j] = problem.parinfo[i].tied_scale;
+    }
+  std::vector<double> C(nf*nf, 0.0), column(nf);
+  for(size_t k = 0; k < nf; k++)
+    {
+      column.assign(nf, 0.0);
+      column[k] = 1;
+      cholesky_solve(A, nf, &column[0]);
+      for(size_t j = 0; j < nf; j++) C[j*nf + k] = column[j];
+    }
+  for(size_t a = 0; a < n; a++)
+    for(size_t b = 0; b < n; b++)
+      {
+	double s = 0;
+	for(size_t j = 0; j < nf; j++)
+	  for(size_t k = 0; k < nf; k++)
+	    s += T[a*nf + j]*C[j*nf + k]*T[b*nf + k];
+	result.covar[a*n + b] = s;
+      }
+  for(size_t a = 0; a < n; a++)
+    result.perror[a] = sqrt(std::max(result.covar[a*n + a], 0.0));
+}
+
+int lmfit(const lmfit_model &model, const xydata<double> &data, const double *errors,
+	  const std::vector<lmfit_parinfo> &parinfo, lmfit_result &result,
+	  const lmfit_config &config)
+{
+  result = lmfit_result();
+  lmfit_problem problem(model, parinfo, config);
+  if(problem.init(data, errors) != 0)
+    return result.status = LMFIT_ERROR_INPUT;
+  const size_t nf = problem.n_free();
+  std::vector<double> p, trial, r, r_trial, jac, A, g, M, step(nf);
+  problem.start(p);
+  double chi2 = problem.residuals(p, r);
+  if(!(chi2 == chi2))
+    return result.status = LMFIT_ERROR_NAN;
+
+  double lambda = -1, nu = 2;
+  int status = LMFIT_MAXITER;
+  int iter = 0;
+  for(; iter < config.maxiter && status == LMFIT_MAXITER; iter++)
+    {
+      problem.jacobian(p, r, jac);
+      normal_equations(jac, r, nf, A, g);
+      if(chi2 == 0)
+	{
+	  status = LMFIT_CONVERGED_FTOL;
+	  break;
+	}
+      //the step goes along -g, parameters pegged at a limit are not moved outwards:
+      std::vector<bool> pegged(nf, false);
+      double gnorm = 0;
+      for(size_t j = 0; j < nf; j++)
+	{
+	  const int limit = problem.at_limit(j, p[j]);
+	  if((limit < 0 && g[j] > 0) || (limit > 0 && g[j] < 0))
+	    pegged[j] = true;
+	  else if(A[j*nf + j] > 0)
+	    gnorm = std::max(gnorm, fabs(g[j])/sqrt(A[j*nf + j]*chi2));
+	}
+      if(gnorm <= config.gtol)
+	{
+	  status = LMFIT_CONVERGED_GTOL;
+	  break;
+	}
+      if(lambda < 0)
+	{
+	  double max_diag = 0;
+	  for(size_t j = 0; j < nf; j++) max_diag = std::max(max_diag, A[j*nf + j]);
+	  lambda = 1e-3*max_diag;
+	}
+
+      for(;;)
+	{
+	  M = A;
+	  for(size_t j = 0; j < nf; j++)
+	    {
+	      if(pegged[j])
+		{
+		  for(size_t k = 0; k < nf; k++) M[j*nf + k] = M[k*nf + j] = 0;
+		  M[j*nf + j] = 1;
+		  step[j] = 0;
+		  continue;
+		}
+	      M[j*nf + j] += lambda*std::max(A[j*nf + j], DBL_MIN);
+	      step[j] = -g[j];
+	    }
+	  if(!cholesky(M, nf))
+	    {
+	      lambda = std::max(lambda*nu, DBL_MIN);
+	      nu *= 2;
+	      if(lambda > LMFIT_MAX_LAMBDA)
+		{
+		  status = LMFIT_ERROR_SINGULAR;
+		  break;
+		}
+	      continue;
+	    }
+	  cholesky_solve(M, nf, &step[0]);
+	  //cut the step at the limits:
+	  trial.resize(nf);
+	  for(size_t j = 0; j < nf; j++)
+	    {
+	      trial[j] = problem.clamp(j, p[j] + step[j]);
+	      step[j] = trial[j] - p[j];
+	    }
+	  const double chi2_trial = problem.residuals(trial, r_trial);
+	  //chi2(p + step) ~ chi2 + 2*g*step + step*A*step:
+	  double predicted = 0;
+	  for(size_t j = 0; j < nf; j++)
+	    {
+	      double As = 0;
+	      for(size_t k = 0; k < nf; k++) As += A[j*nf + k]*step[k];
+	      predicted -= 2*g[j]*step[j] + step[j]*As;
+	    }
+	  const bool small_step = norm2(step) <= config.xtol*(norm2(p) + config.xtol);
+	  if(chi2_trial == chi2_trial && chi2_trial < chi2)
+	    {
+	      const double actual = chi2 - chi2_trial;
+	      const double rho = (predicted > 0)? actual/predicted : 0;
+	      const bool ftol_ok = actual <= config.ftol*chi2 && predicted <= config.ftol*chi2;
+	      p.swap(trial);
+	      r.swap(r_trial);
+	      chi2 = chi2_trial;
+	      const double t = 2*rho - 1;
+	      lambda *= std::max(1.0/3.0, 1 - t*t*t);
+	      nu = 2;
+	      if(ftol_ok && small_step) status = LMFIT_CONVERGED_BOTH;
+	      else if(ftol_ok) status = LMFIT_CONVERGED_FTOL;
+	      else if(small_step) status = LMFIT_CONVERGED_XTOL;
+	      break;
+	    }
+	  if(small_step)
+	    {//chi2 can't be decreased any more:
+	      status = LMFIT_CONVERGED_XTOL;
+	      break;
+	    }
+	  lambda *= nu;
+	  nu *= 2;
+	  if(lambda > LMFIT_MAX_LAMBDA)
+	    {//even the tiny steps of this lambda don't decrease chi2:
+	      status = LMFIT_ERROR_LAMBDA;
+	      break;
+	    }
+	}
+      if(!(chi2 == chi2))
+	{
+	  status = LMFIT_ERROR_NAN;
+	  break;
+	}
+    }
+
+  result.params.resize(parinfo.size());
+  problem.expand(&p[0], &result.params[0]);
+  problem.jacobian(p, r, jac);
+  normal_equations(jac, r, nf, A, g);
+  covariance(problem, A, result);
+  result.chi2 = chi2;
+  result.dof = (long)problem.n_points() - (long)nf;
+  result.niter = iter;
+  result.nfev = problem.nfev;
+  return result.status = status;
+}
+
+static void lmfit_worker(const lmfit_model *model, const std::vector<lmfit_task> *tasks,
+			 const std::vector<lmfit_parinfo> *parinfo,
+			 std::vector<lmfit_result> *results, const lmfit_config *config,
+			 std::atomic<size_t> *next)
+{
+  for(size_t i = (*next)++; i < tasks->size(); i = (*next)++)
+    {
+      const lmfit_task &task = (*tasks)[i];
+      if(task.data == NULL) continue;
+      lmfit(*model, *task.data, task.errors,
+	    task.parinfo.empty()? *parinfo : task.parinfo, (*results)[i], *config);
+    }
+}
+
+int lmfit_many(const lmfit_model &model, const std::vector<lmfit_task> &tasks,
+	       const std::vector<lmfit_parinfo> &parinfo, std::vector<lmfit_result> &results,
+	       size_t n_threads, const lmfit_config &config)
+{
+  results.assign(tasks.size(), lmfit_result());
+  if(n_threads == 0)
+    n_threads = std::thread::hardware_concurrency();
+  if(n_threads > tasks.size())
+    n_threads = tasks.size();
+  if(n_threads < 1)
+    n_threads = 1;
+  std::atomic<size_t> next(0);
+  std::vector<std::thread> threads;
+  for(size_t i = 1; i < n_threads; i++)
+    threads.push_back(std::thread(lmfit_worker, &model, &tasks, &parinfo, &results,
+				  &config, &next));
+  lmfit_worker(&model, &tasks, &parinfo, &results, &config, &next);
+  for(size_t i = 0; i < threads.size(); i++)
+    threads[i].join();
+  int failed = 0;
+  for(size_t i = 0; i < results.size(); i++)
+    if(results[i].status <= 0) failed++;
+  return failed;
+}
+
+double lmfit_gauss_peak::value(const double *p, const double x) const
+{
+  const double d = (x - p[1])/p[2];
+  return p[0]*exp(-0.5*d*d) + p[3] + p[4]*x;
+}
+
+bool lmfit_gauss_peak::gradient(const double *p, const double x, double *dfdp) const
+{
+  const double d = (x - p[1])/p[2];
+  const double g = exp(-0.5*d*d);
+  dfdp[0] = g;
+  dfdp[1] = p[0]*g*d/p[2];
+  dfdp[2] = p[0]*g*d*d/p[2];
+  dfdp[3] = 1;
+  dfdp[4] = x;
+  return true;
+}
@@ -0,0 +1,185 @@
+/*
+  Levenberg-Marquardt least squares fit of xydata<double>,
+  native replacement of scripts/mpfit.py + call_mpfit() of fitexpr.py
+  of egamma-ta-al-in.
+
+  May be distributed and modified under the terms of the GNU
+  General Public License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+*/
+#ifndef LMFIT_H
+#define LMFIT_H
+
+#include "xydata_template.h"
+#include <string>
+#include <vector>
+
+/** Status codes of lmfit_result, the same as of mpfit.*/
+#define LMFIT_ERROR_INPUT     0
+#define LMFIT_CONVERGED_FTOL  1
+#define LMFIT_CONVERGED_XTOL  2
+#define LMFIT_CONVERGED_BOTH  3
+#define LMFIT_CONVERGED_GTOL  4
+#define LMFIT_MAXITER         5
+#define LMFIT_ERROR_NAN      -16
+/** the damped normal equations can't be solved for any lambda(not in mpfit)*/
+#define LMFIT_ERROR_SINGULAR -25
+/** no step decreased chi2 up to the largest lambda, the fit stalled(not in mpfit)*/
+#define LMFIT_ERROR_LAMBDA   -26
+
+/**
+   Constraints of one parameter, like the parinfo dictionary of mpfit.
+   mpfit ties parameters by a python expression, here the tie is linear:
+   p[i] = tied_scale*p[tied_to] + tied_offset.
+*/
+struct lmfit_parinfo
+{
+  lmfit_parinfo(const double start = 0)
+  {
+    value = start;
+    fixed = false;
+    limited[0] = limited[1] = false;
+    limits[0] = limits[1] = 0;
+    tied_to = -1;
+    tied_scale = 1;
+    tied_offset = 0;
+    step = 0;
+    relstep = 0;
+    side = 0;
+  }
+
+  /** start value*/
+  double value;
+  bool fixed;
+  /** whether lower/upper limit is set*/
+  bool limited[2];
+  double limits[2];
+  /** index of the parameter this one is tied to, -1 if free*/
+  int tied_to;
+  double tied_scale;
+  double tied_offset;
+  /** absolute step of the numerical derivative, 0 -- automatic*/
+  double step;
+  /** relative step of the numerical derivative, 0 -- automatic*/
+  double relstep;
+  /** 0 or 1 -- one-sided(+) derivative, -1 -- one-sided(-), 2 -- two-sided, as mpside;
+      the steps stay within the limits, a side crossing one is not used*/
+  int side;
+  std::string parname;
+};
+
+/**
+   Model function y = f(x; p). It's called from many threads
+   by lmfit_many(), so it must not change itself.
+*/
+class lmfit_model
+{
+public:
+  virtual ~lmfit_model() {}
+
+  /** \return f(x; p)*/
+  virtual double value(const double *p, const double x) const = 0;
+
+  /** Analytic derivatives df/dp[j] of all parameters at x.
+      \return false if there are none, then they're numerical.*/
+  virtual bool gradient(const double *p, const double x, double *dfdp) const
+  {
+    (void)p; (void)x; (void)dfdp;
+    return false;
+  }
+
+  /** number of parameters*/
+  virtual size_t size() const = 0;
+};
+
+/** Tolerances, defaults are the ones of mpfit.*/
+struct lmfit_config
+{
+  lmfit_config()
+  {
+    ftol = 1e-10;
+    xtol = 1e-10;
+    gtol = 1e-10;
+    epsfcn = 2.2204460e-16;
+    maxiter = 200;
+  }
+  /** relative decrease of chi2*/
+  double ftol;
+  /** relative change of parameters*/
+  double xtol;
+  /** orthogonality of residuals to the jacobian*/
+  double gtol;
+  /** relative precision of the model, sets the automatic derivative step*/
+  double epsfcn;
+  int maxiter;
+};
+
+struct lmfit_result
+{
+  lmfit_result() : status(LMFIT_ERROR_INPUT), chi2(0), dof(0), niter(0), nfev(0) {}
+  /** LMFIT_* code, > 0 on success*/
+  int status;
+  std::vector<double> params;
+  /** sqrt of covariance diagonal, 0 for fixed and tied parameters*/
+  std::vector<double> perror;
+  /** covariance matrix, size()*size(), row by row*/
+  std::vector<double> covar;
+  double chi2;
+  /** number of points - number of free parameters*/
+  long dof;
+  int niter;
+  int nfev;
+};
+
+/**
+   \brief Fit the model to the points of data.
+   Chi2 = sum(((y - f(x; p))/error)^2). Parameters are kept within their
+   limits: the step is cut at the limit and a parameter pegged at it is
+   not moved outwards.
+   \param model.
+   \param data points.
+   \param errors of y, data.size() values; NULL -- all errors are 1.
+   \param constraints and start values, one per parameter of the model.
+   \param result.
+   \param tolerances.
+   \return result.status.
+*/
+int lmfit(const lmfit_model &model, const xydata<double> &data, const double *errors,
+	  const std::vector<lmfit_parinfo> &parinfo, lmfit_result &result,
+	  const lmfit_config &config = lmfit_config());
+
+/** One spectrum of lmfit_many().*/
+struct lmfit_task
+{
+  lmfit_task() : data(NULL), errors(NULL) {}
+  const xydata<double> *data;
+  const double *errors;
+  /** start values and constraints, empty -- the common ones are used*/
+  std::vector<lmfit_parinfo> parinfo;
+};
+
+/**
+   \brief Fit many independent spectra with the same model,
+   the tasks are shared between n_threads threads.
+   \param n_threads: 0 -- one per core.
+   \return number of failed fits.
+*/
+int lmfit_many(const lmfit_model &model, const std::vector<lmfit_task> &tasks,
+	       const std::vector<lmfit_parinfo> &parinfo, std::vector<lmfit_result> &results,
+	       size_t n_threads = 0, const lmfit_config &config = lmfit_config());
+
+/** Gaussian peak on a linear background:
+    p[0]*exp(-(x - p[1])^2/(2*p[2]^2)) + p[3] + p[4]*x,
+    with analytic derivatives.*/
+class lmfit_gauss_peak : public lmfit_model
+{
+public:
+  double value(const double *p, const double x) const;
+  bool gradient(const double *p, const double x, double *dfdp) const;
+  size_t size() const
+  {
+    return 5;
+  }
+};
+
+#endif
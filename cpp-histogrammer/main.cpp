@@ -1,31 +1,79 @@
 #include <iostream>
 #include "makehist.h"
 #include <stdlib.h>
+#include <string>
+#include <vector>
+
+/** Summary table of the batch mode.*/
+#define BATCH_SUMMARY_NAME "histogrammer_summary.dat"
 
 int main(int argc, char* argv[])
 {
   std::cout << "USAGE: \n" 
-	    << argv[0] << " in_filename out_filename N_BINS\n"
+	    << argv[0] << " in_filename out_filename N_BINS [MIN MAX] [N_THREADS] [--threads N]\n"
 	    << "for example: "
-	    << argv[0] << " file1.dat file1_histo.dat 2000\n";
-  if( argc < 2)
+	    << argv[0] << " file1.dat file1_histo.dat 2000\n"
+	    << "if MIN and MAX are given, the file is read once.\n"
+	    << "N_THREADS or --threads N -- quantity of threads, one per core by default,\n"
+	    << "--threads N may be given without MIN and MAX.\n"
+	    << argv[0] << " --batch 'PATTERN'|MANIFEST N_BINS [MIN MAX] [N_FILES]\n"
+	    << "bins many files at once, N_FILES of them concurrently,\n"
+	    << "summary table is written to " << BATCH_SUMMARY_NAME << "\n";
+  //"--threads N" may stand anywhere, the other arguments are positional:
+  std::vector<std::string> args;
+  for(int i = 0; i < argc; i++)
+    {
+      if(std::string(argv[i]) != "--threads")
+	{
+	  args.push_back(argv[i]);
+	  continue;
+	}
+      if(i + 1 >= argc || atol(argv[i + 1]) <= 0)
+	{
+	  std::cout << "--threads needs a positive number!\n";
+	  return -1;
+	}
+      set_histogramm_threads(atol(argv[++i]));
+    }
+  const size_t n_args = args.size();
+  if(n_args < 2)
     {
       //не задано вхідний файл:
       std::cout << "No input file given!\n";
       return -1;
     }
-  int ret = -1;
-  std::string name1 = argv[1];
-  std::string name2 = "output.hist.dat";
-  if(argc == 2)
-    ret = make_histogramm(2000, name1, name2);
-
-  if(argc > 2)
-    name2 = argv[2];
-  if(argc == 3)
-    ret = make_histogramm(2000, name1, name2);
-  if(argc == 4)
-    ret = make_histogramm(atol(argv[3]), name1, name2);
-  return ret;
+  if(args[1] == "--batch")
+    {
+      if(n_args < 4)
+	{
+	  std::cout << "No file list or number of bins given!\n";
+	  return -1;
+	}
+      if(n_args == 5)
+	{
+	  std::cout << "MIN is given without MAX!\n";
+	  return -1;
+	}
+      if(n_args > 6)
+	set_batch_in_flight(atol(args[6].c_str()));
+      if(n_args > 5)
+	return make_histogramm_batch(args[2], atol(args[3].c_str()), true,
+				     atof(args[4].c_str()), atof(args[5].c_str()),
+				     BATCH_SUMMARY_NAME);
+      return make_histogramm_batch(args[2], atol(args[3].c_str()), false, 0, 0,
+				   BATCH_SUMMARY_NAME);
+    }
+  if(n_args == 5)
+    {
+      std::cout << "MIN is given without MAX!\n";
+      return -1;
+    }
+  std::string name1 = args[1];
+  std::string name2 = (n_args > 2)? args[2] : "output.hist.dat";
+  const long n_bins = (n_args > 3)? atol(args[3].c_str()) : 2000;
+  if(n_args > 6)
+    set_histogramm_threads(atol(args[6].c_str()));
+  if(n_args > 5)
+    return make_histogramm(n_bins, name1, name2, atof(args[4].c_str()), atof(args[5].c_str()));
+  return make_histogramm(n_bins, name1, name2);
 }
-
@@ -1,56 +1,565 @@
 #include "makehist.h"
 #include "xydata_template.h"
+#include "mapped_file.h"
+#include "fast_parse.h"
 #include <iostream>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+#include <fstream>
+#include <time.h>
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/time.h>
+#include <sys/stat.h>
+#include <glob.h>
+#endif
 
-int make_histogramm(const size_t N_bins, const std::string inputname, const std::string outputname)
+/** Quantity of threads, 0 -- one per core.*/
+static size_t histogramm_threads = 0;
+
+/** Quantity of files processed at once in batch mode, 0 -- one per thread.*/
+static size_t batch_in_flight = 0;
+
+/** Chunks smaller than this are not worth a thread.*/
+#define MIN_CHUNK_SIZE (1 << 20)
+
+void set_histogramm_threads(const size_t n_threads)
 {
-  if(N_bins == 0 && inputname.empty()) return -1;
-  std::ifstream input;
-  input.open(inputname.c_str(), std::ios::in );
-  float min = 0;
-  float max = 0;
+  histogramm_threads = n_threads;
+}
+
+void set_batch_in_flight(const size_t n_files)
+{
+  batch_in_flight = n_files;
+}
+
+/** \return quantity of threads to use.*/
+static size_t thread_count()
+{
+  size_t n = histogramm_threads;
+  if(n == 0)
+    n = std::thread::hardware_concurrency();
+  return (n == 0)? 1 : n;
+}
+
+/** Wall clock time in seconds.*/
+static double seconds_now()
+{
+#if defined(__unix__) || defined(__APPLE__)
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + 1e-6*tv.tv_usec;
+#else
+  return (double)clock()/CLOCKS_PER_SEC;
+#endif
+}
+
+/** Print the throughput of the pass over the file.*/
+static void report_speed(const char *pass, const size_t bytes, const double seconds)
+{
+  std::cout << pass << ": " << bytes/1.0e6 << " MB in " << seconds << " s";
+  if(seconds > 0)
+    std::cout << ", " << bytes/seconds/1.0e9 << " GB/s";
+  std::cout << "\n";
+}
+
+/** Statistics of the values of a buffer or it's chunk.*/
+struct min_max_part
+{
+  float min, max;
+  double sum;
+  size_t count;
+};
+
+/** Find min/max and sum of all values in the buffer.
+    \return quantity of values.*/
+static size_t find_min_max(const char *begin, const char *end, float &min, float &max,
+			   double &sum)
+{
+  const char *p = begin;
   float value;
-  input >> value;
-  min = max = value;
-  size_t cnt_read = 0;
-  while(input.good() && !input.eof())
+  size_t count = 0;
+  sum = 0;
+  while(p < end)
     {
-      input >> value;
+      if(!fast_parse_float(p, end, value)) continue;
+      if(count == 0)
+	min = max = value;
       min = (value < min)? value : min;
       max = (value > max)? value : max;
-      cnt_read++;
+      sum += value;
+      count++;
+    }
+  return count;
+}
+
+/** Count the values of the buffer in bins:
+    [min, min + step), [min + step, min + 2*step) ... [max - step, max].
+    \param if not NULL, statistics of all values are collected there
+    in the same pass.
+    \return quantity of values out of the range.*/
+static size_t bin_values(const char *begin, const char *end,
+			 const double min, const double max, const double step,
+			 std::vector<unsigned long long> &counts,
+			 min_max_part *seen = NULL)
+{
+  const char *p = begin;
+  const size_t N_bins = counts.size();
+  float value;
+  size_t n_out = 0;
+  while(p < end)
+    {
+      if(!fast_parse_float(p, end, value)) continue;
+      if(seen != NULL)
+	{
+	  if(seen->count == 0)
+	    seen->min = seen->max = value;
+	  seen->min = (value < seen->min)? value : seen->min;
+	  seen->max = (value > seen->max)? value : seen->max;
+	  seen->sum += value;
+	  seen->count++;
+	}
+      if(!(value >= min && value <= max))
+	{
+	  n_out++;
+	  continue;
+	}
+      size_t index = (size_t)((value - min)/step);
+      if(index >= N_bins) index = N_bins - 1;//value == max
+      counts[index]++;
+    }
+  return n_out;
+}
+
+/** Split the buffer into chunks at whitespaces, so no number is cut.
+    \return chunk boundaries: chunk i is [bounds[i], bounds[i+1]).*/
+static std::vector<const char*> split_chunks(const char *begin, const char *end)
+{
+  size_t n_chunks = thread_count();
+  const size_t size = end - begin;
+  if(size/n_chunks < MIN_CHUNK_SIZE)
+    n_chunks = size/MIN_CHUNK_SIZE + 1;
+
+  std::vector<const char*> bounds;
+  bounds.push_back(begin);
+  for(size_t i = 1; i < n_chunks; i++)
+    {
+      const char *p = begin + i*(size/n_chunks);
+      if(p < bounds.back()) p = bounds.back();
+      while(p < end && !fast_parse_is_space(*p)) p++;
+      bounds.push_back(p);
+    }
+  bounds.push_back(end);
+  return bounds;
+}
+
+static void find_min_max_part(const char *begin, const char *end, min_max_part *part)
+{
+  part->count = find_min_max(begin, end, part->min, part->max, part->sum);
+}
+
+static void bin_values_part(const char *begin, const char *end,
+			    const double min, const double max, const double step,
+			    std::vector<unsigned long long> *counts, size_t *n_out,
+			    min_max_part *seen)
+{
+  *n_out = bin_values(begin, end, min, max, step, *counts, seen);
+}
+
+/** Add statistics of the chunk to the total.*/
+static void merge_part(min_max_part &total, const min_max_part &part)
+{
+  if(part.count == 0) return;
+  if(total.count == 0)
+    {
+      total.min = part.min;
+      total.max = part.max;
+    }
+  total.min = (part.min < total.min)? part.min : total.min;
+  total.max = (part.max > total.max)? part.max : total.max;
+  total.sum += part.sum;
+  total.count += part.count;
+}
+
+/** find_min_max() of chunks by all threads.
+    \return quantity of values.*/
+static size_t find_min_max_parallel(const char *begin, const char *end, float &min, float &max,
+				    double &sum)
+{
+  std::vector<const char*> bounds = split_chunks(begin, end);
+  const size_t n_chunks = bounds.size() - 1;
+  std::vector<min_max_part> parts(n_chunks);
+  std::vector<std::thread> threads;
+  for(size_t i = 1; i < n_chunks; i++)
+    threads.push_back(std::thread(find_min_max_part, bounds[i], bounds[i+1], &parts[i]));
+  find_min_max_part(bounds[0], bounds[1], &parts[0]);
+  for(size_t i = 0; i < threads.size(); i++)
+    threads[i].join();
+
+  min_max_part total;
+  total.count = 0;
+  total.sum = 0;
+  for(size_t i = 0; i < n_chunks; i++)
+    merge_part(total, parts[i]);
+  if(total.count > 0)
+    {
+      min = total.min;
+      max = total.max;
+    }
+  sum = total.sum;
+  return total.count;
+}
+
+/** bin_values() of chunks by all threads, each thread has got
+    it's own counts, they're summed at the end, so the result
+    is the same as of a single thread.
+    \param if not NULL, statistics of all values are added there.
+    \return quantity of values out of the range.*/
+static size_t bin_values_parallel(const char *begin, const char *end,
+				  const double min, const double max, const double step,
+				  std::vector<unsigned long long> &counts,
+				  min_max_part *seen = NULL)
+{
+  std::vector<const char*> bounds = split_chunks(begin, end);
+  const size_t n_chunks = bounds.size() - 1;
+  std::vector<std::vector<unsigned long long> > part_counts(n_chunks);
+  std::vector<size_t> part_out(n_chunks, 0);
+  std::vector<min_max_part> parts(n_chunks);
+  for(size_t i = 0; i < n_chunks; i++)
+    {
+      parts[i].count = 0;
+      parts[i].sum = 0;
     }
-  input.close();
+  std::vector<std::thread> threads;
+  for(size_t i = 1; i < n_chunks; i++)
+    {
+      part_counts[i].assign(counts.size(), 0);
+      threads.push_back(std::thread(bin_values_part, bounds[i], bounds[i+1],
+				    min, max, step, &part_counts[i], &part_out[i],
+				    (seen != NULL)? &parts[i] : NULL));
+    }
+  size_t n_out = bin_values(bounds[0], bounds[1], min, max, step, counts,
+			    (seen != NULL)? &parts[0] : NULL);
+  for(size_t i = 0; i < threads.size(); i++)
+    threads[i].join();
+
+  for(size_t i = 1; i < n_chunks; i++)
+    {
+      const std::vector<unsigned long long> &part = part_counts[i];
+      for(size_t k = 0; k < counts.size(); k++)
+	counts[k] += part[k];
+      n_out += part_out[i];
+    }
+  if(seen != NULL)
+    for(size_t i = 0; i < n_chunks; i++)
+      merge_part(*seen, parts[i]);
+  return n_out;
+}
+
+/** Write counts as 2 columns: right edge of the bin, count.
+    \return 0 if ok, -1 if the file can't be written.*/
+static int write_histogramm(const std::vector<unsigned long long> &counts,
+			    const double min, const double step,
+			    const std::string &outputname)
+{
+  const size_t N_bins = counts.size();
+  xydata<float> data;
+  data.resize(N_bins);
+  for(size_t cnt = 0; cnt < N_bins; cnt++)
+    {
+      data.setx(cnt, min + (cnt + 1)*step);
+      data.sety(cnt, counts[cnt]);
+    }
+  //binary output for the next steps of processing, they don't reparse text:
+  const std::string suffix = XYDATA_BINARY_SUFFIX;
+  const bool binary = outputname.size() > suffix.size()
+    && outputname.compare(outputname.size() - suffix.size(), suffix.size(), suffix) == 0;
+  return (binary? data.write_binary(outputname) : data.write_file(outputname));
+}
+
+/** Bin the mapped file and write the histogramm.*/
+static int bin_and_write(const mapped_file &file, const size_t N_bins,
+			 const double min, const double max,
+			 const std::string &outputname)
+{
   std::cout << "making histogramm with " << N_bins <<" bins...\n";
+  std::vector<unsigned long long> counts(N_bins, 0);
+  const double step = (max - min)/N_bins;
+  double start = seconds_now();
+  size_t n_out = bin_values_parallel(file.begin(), file.end(), min, max, step, counts);
+  report_speed("binning", file.size(), seconds_now() - start);
+  if(n_out > 0)
+    std::cout << n_out << "\tvalues out of range.\n";
+  if(write_histogramm(counts, min, step, outputname) != 0)
+    {
+      std::cout << "(error) can't write file " << outputname << "\n";
+      return -1;
+    }
+  std::cout << "success.\n";
+  return 0;
+}
+
+
+int make_histogramm(const size_t N_bins, const std::string inputname, const std::string outputname)
+{
+  if(N_bins == 0 || inputname.empty()) return -1;
+  mapped_file file;
+  if(file.open(inputname) != 0)
+    {
+      std::cout << "(error) can't read file " << inputname << "\n";
+      return -1;
+    }
+  float min = 0;
+  float max = 0;
+  double sum = 0;
+  double start = seconds_now();
+  size_t cnt_read = find_min_max_parallel(file.begin(), file.end(), min, max, sum);
+  report_speed("min/max search", file.size(), seconds_now() - start);
   std::cout << cnt_read << "\tfloat values had been read.\n";
   std::cout << "min value: " << min
-	    << "\tmax value: " << max << "\n";
+	    << "\tmax value: " << max;
+  if(cnt_read > 0)
+    std::cout << "\tmean value: " << sum/cnt_read;
+  std::cout << "\n";
   if(max <= min)
     {
       std::cout << "(error) wrong max/min values, quitting.\n";
       return -1;
     }
-  xydata<float> data;
-  data.resize(N_bins);
-  double step = (max - min)/N_bins;
-  size_t cnt = 0;
-  while(cnt < N_bins)
+  return bin_and_write(file, N_bins, min, max, outputname);
+}
+
+int make_histogramm(const size_t N_bins, const std::string inputname, const std::string outputname,
+		    const double min, const double max)
+{
+  if(N_bins == 0 || inputname.empty()) return -1;
+  if(max <= min)
+    {
+      std::cout << "(error) wrong max/min values, quitting.\n";
+      return -1;
+    }
+  mapped_file file;
+  if(file.open(inputname) != 0)
     {
-      data.setx(cnt, (cnt + 1)*step);
-      cnt++;
+      std::cout << "(error) can't read file " << inputname << "\n";
+      return -1;
     }
-  
-  input.open(inputname.c_str(), std::ios::in );
-  while(input.good() && !input.eof())
+  return bin_and_write(file, N_bins, min, max, outputname);
+}
+
+/** One file of the batch and it's results.*/
+struct batch_item
+{
+  std::string inputname;
+  std::string outputname;
+  size_t size;
+  int result;
+  min_max_part stats;
+  size_t n_out;
+  double seconds;
+};
+
+static bool batch_item_larger(const batch_item &a, const batch_item &b)
+{
+  return a.size > b.size;
+}
+
+/** Output name: input name without extension + "_hist.dat".*/
+static std::string batch_output_name(const std::string &inputname)
+{
+  size_t slash = inputname.find_last_of("/\\");
+  size_t dot = inputname.find_last_of('.');
+  if(dot == std::string::npos || (slash != std::string::npos && dot < slash))
+    dot = inputname.size();
+  return inputname.substr(0, dot) + "_hist.dat";
+}
+
+/** List of input files of the batch: a glob pattern if (param1) has got
+    any of "*?[", otherwise a manifest file with one file name per line.
+    \return 0 if ok, -1 if the manifest can't be read.*/
+static int batch_inputs(const std::string &list, std::vector<std::string> &names)
+{
+  if(list.find_first_of("*?[") != std::string::npos)
     {
-      input >> value;
-      size_t index = (size_t)(value/step);
-      bool ok = false;
-      data.sety(index, data.y(index, ok) + 1.0);
+#if defined(__unix__) || defined(__APPLE__)
+      glob_t found;
+      if(glob(list.c_str(), 0, NULL, &found) == 0)
+	for(size_t i = 0; i < found.gl_pathc; i++)
+	  names.push_back(found.gl_pathv[i]);
+      globfree(&found);
+      return 0;
+#else
+      std::cout << "(error) file patterns are not supported, use a manifest file.\n";
+      return -1;
+#endif
+    }
+  std::ifstream manifest(list.c_str());
+  if(!manifest.good()) return -1;
+  std::string line;
+  while(std::getline(manifest, line))
+    {
+      size_t first = line.find_first_not_of(" \t\r");
+      if(first == std::string::npos || line[first] == '#') continue;
+      size_t last = line.find_last_not_of(" \t\r");
+      names.push_back(line.substr(first, last - first + 1));
     }
-  input.close();
-  data.write_file(outputname);
-  std::cout << "success.\n";
-  data.clear();
   return 0;
 }
+
+/** Bin one file of the batch and write it's histogramm.
+    \param true if the file is split in chunks between threads,
+    false if the files are processed concurrently.*/
+static void batch_process(batch_item &item, const size_t N_bins,
+			  const bool fixed_range, const double range_min, const double range_max,
+			  const bool parallel)
+{
+  const double start = seconds_now();
+  item.result = -1;
+  item.n_out = 0;
+  item.stats.count = 0;
+  item.stats.sum = 0;
+  item.stats.min = item.stats.max = 0;
+  mapped_file file;
+  if(file.open(item.inputname) != 0) return;
+  double min = range_min, max = range_max;
+  std::vector<unsigned long long> counts(N_bins, 0);
+  if(!fixed_range)
+    {
+      if(parallel)
+	item.stats.count = find_min_max_parallel(file.begin(), file.end(), item.stats.min,
+						 item.stats.max, item.stats.sum);
+      else
+	item.stats.count = find_min_max(file.begin(), file.end(), item.stats.min,
+					item.stats.max, item.stats.sum);
+      min = item.stats.min;
+      max = item.stats.max;
+    }
+  if(max > min)
+    {//statistics are collected again while binning:
+      item.stats.count = 0;
+      item.stats.sum = 0;
+      if(parallel)
+	item.n_out = bin_values_parallel(file.begin(), file.end(), min, max,
+					 (max - min)/N_bins, counts, &item.stats);
+      else
+	item.n_out = bin_values(file.begin(), file.end(), min, max,
+				(max - min)/N_bins, counts, &item.stats);
+    }
+  file.close();
+  if(item.stats.count > 0 && max > min)
+    item.result = write_histogramm(counts, min, (max - min)/N_bins, item.outputname);
+  item.seconds = seconds_now() - start;
+}
+
+/** Worker of the batch: takes the next file until none left.*/
+static void batch_worker(std::vector<batch_item> *items, std::atomic<size_t> *next,
+			 const size_t N_bins, const bool fixed_range,
+			 const double min, const double max, std::mutex *print_mutex)
+{
+  for(size_t i = (*next)++; i < items->size(); i = (*next)++)
+    {
+      batch_item &item = (*items)[i];
+      batch_process(item, N_bins, fixed_range, min, max, false);
+      std::lock_guard<std::mutex> lock(*print_mutex);
+      std::cout << ((item.result == 0)? "done: " : "(error) failed: ")
+		<< item.inputname << "\n";
+    }
+}
+
+/** Write and print the summary table of the batch.*/
+static int batch_summary(const std::vector<batch_item> &items, const std::string &summaryname)
+{
+  std::ofstream out(summaryname.c_str());
+  out << "#file\tvalues\tout_of_range\tmin\tmax\tmean\tseconds\thistogramm\n";
+  int failed = 0;
+  for(size_t i = 0; i < items.size(); i++)
+    {
+      const batch_item &item = items[i];
+      if(item.result != 0) failed++;
+      out << item.inputname << '\t' << item.stats.count << '\t' << item.n_out << '\t'
+	  << item.stats.min << '\t' << item.stats.max << '\t'
+	  << ((item.stats.count > 0)? item.stats.sum/item.stats.count : 0) << '\t'
+	  << item.seconds << '\t'
+	  << ((item.result == 0)? item.outputname : std::string("-")) << '\n';
+    }
+  std::cout << "summary written to " << summaryname << ": "
+	    << items.size() - failed << " of " << items.size() << " files binned.\n";
+  return (out.good() && failed == 0)? 0 : -1;
+}
+
+int make_histogramm_batch(const std::string list, const size_t N_bins,
+			  const bool fixed_range, const double min, const double max,
+			  const std::string summaryname)
+{
+  if(N_bins == 0) return -1;
+  if(fixed_range && max <= min)
+    {
+      std::cout << "(error) wrong max/min values, quitting.\n";
+      return -1;
+    }
+  std::vector<std::string> names;
+  if(batch_inputs(list, names) != 0)
+    {
+      std::cout << "(error) can't read file list " << list << "\n";
+      return -1;
+    }
+  if(names.empty())
+    {
+      std::cout << "(error) no input files in " << list << "\n";
+      return -1;
+    }
+  
+  std::vector<batch_item> items(names.size());
+  size_t total = 0;
+  for(size_t i = 0; i < names.size(); i++)
+    {
+      items[i].inputname = names[i];
+      items[i].outputname = batch_output_name(names[i]);
+      items[i].size = 0;
+      items[i].result = -1;
+      items[i].seconds = 0;
+#if defined(__unix__) || defined(__APPLE__)
+      struct stat st;
+      if(stat(names[i].c_str(), &st) == 0)
+	items[i].size = st.st_size;
+#endif
+      total += items[i].size;
+    }
+  //largest files first, the small ones fill the gaps at the end:
+  std::stable_sort(items.begin(), items.end(), batch_item_larger);
+
+  //few files -- they're done one by one, split between all threads:
+  size_t n_workers = batch_in_flight;
+  if(n_workers == 0)
+    n_workers = (items.size() < thread_count())? 1 : thread_count();
+  if(n_workers > items.size())
+    n_workers = items.size();
+  std::cout << "binning " << items.size() << " files, "
+	    << n_workers << " at once...\n";
+  
+  const double start = seconds_now();
+  if(n_workers <= 1)
+    {//one file at a time, each one is split in chunks between threads:
+      for(size_t i = 0; i < items.size(); i++)
+	{
+	  batch_process(items[i], N_bins, fixed_range, min, max, true);
+	  std::cout << ((items[i].result == 0)? "done: " : "(error) failed: ")
+		    << items[i].inputname << "\n";
+	}
+    }
+  else
+    {
+      std::atomic<size_t> next(0);
+      std::mutex print_mutex;
+      std::vector<std::thread> threads;
+      for(size_t i = 0; i < n_workers; i++)
+	threads.push_back(std::thread(batch_worker, &items, &next, N_bins,
+				      fixed_range, min, max, &print_mutex));
+      for(size_t i = 0; i < threads.size(); i++)
+	threads[i].join();
+    }
+  report_speed("batch", total, seconds_now() - start);
+  return batch_summary(items, summaryname);
+}
@@ -4,7 +4,8 @@
 #include <string>
 /** 
     Makes a histogramm from input file with floating point values.
-    Min/max of the histogramm will be automatically determined.
+    Min/max of the histogramm will be automatically determined,
+    so the file is read twice.
     \param number of bins of histogramm.
     \param input file name.
     \param output file name.
@@ -12,5 +13,50 @@
  **/
 int make_histogramm(const size_t N_bins, const std::string inputname, const std::string outputname);
 
+/** 
+    Makes a histogramm from input file with floating point values
+    within the given range, the file is read once.
+    Values out of [min, max] are not counted.
+    \param number of bins of histogramm.
+    \param input file name.
+    \param output file name.
+    \param minimum value of range.
+    \param maximum value of range.
+    
+ **/
+int make_histogramm(const size_t N_bins, const std::string inputname, const std::string outputname,
+		    const double min, const double max);
+
+
+/** 
+    Makes histogramms of many input files with the same binning,
+    files are processed concurrently, the largest ones first.
+    Histogramm of "dir/name.ext" is written to "dir/name_hist.dat".
+    \param glob pattern if it has got any of "*?[", otherwise name of
+    the manifest file with one input file name per line('#' -- comment).
+    \param number of bins of each histogramm.
+    \param true if [min, max] is given, otherwise each file gets it's own
+    range and is read twice.
+    \param minimum value of range.
+    \param maximum value of range.
+    \param name of the summary table: file, values, out of range values,
+    min, max, mean, seconds, histogramm file.
+    \return 0 if all files have been binned, -1 otherwise.
+ **/
+int make_histogramm_batch(const std::string list, const size_t N_bins,
+			  const bool fixed_range, const double min, const double max,
+			  const std::string summaryname);
+
+/** Set quantity of files processed at once by make_histogramm_batch().
+    \param quantity of files, 0 -- one per thread(default),
+    or one at a time split between threads if there are fewer files than threads.
+ **/
+void set_batch_in_flight(const size_t n_files);
+
+/** Set quantity of threads used by make_histogramm().
+    \param quantity of threads, 0 -- one per core(default).
+ **/
+void set_histogramm_threads(const size_t n_threads);
+
 
 #endif
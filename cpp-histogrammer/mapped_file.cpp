@@ -0,0 +1,94 @@
+#include "mapped_file.h"
+#include <stdio.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define MAPPED_FILE_MMAP 1
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+mapped_file::mapped_file()
+{
+  d_data = NULL;
+  d_size = 0;
+  d_mapped = false;
+  d_writable = false;
+}
+
+mapped_file::~mapped_file()
+{
+  close();
+}
+
+int mapped_file::open(const std::string &filename, const access mode)
+{
+  close();
+#ifdef MAPPED_FILE_MMAP
+  int fd = ::open(filename.c_str(), O_RDONLY);
+  if(fd < 0) return -1;
+  struct stat st;
+  if(fstat(fd, &st) != 0)
+    {
+      ::close(fd);
+      return -1;
+    }
+  d_size = st.st_size;
+  if(d_size == 0)
+    {
+      ::close(fd);
+      return 0;
+    }
+  const int protection = (mode == copy_on_write)? (PROT_READ | PROT_WRITE) : PROT_READ;
+  void *addr = mmap(NULL, d_size, protection, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if(addr == MAP_FAILED)
+    {
+      d_size = 0;
+      return -1;
+    }
+  //the file is read from the beginning to the end:
+  if(mode == sequential)
+    madvise(addr, d_size, MADV_SEQUENTIAL);
+  d_data = (const char*)addr;
+  d_mapped = true;
+  d_writable = (mode == copy_on_write);
+  return 0;
+#else
+  FILE *fp = fopen(filename.c_str(), "rb");
+  if(fp == NULL) return -1;
+  fseek(fp, 0, SEEK_END);
+  long length = ftell(fp);
+  fseek(fp, 0, SEEK_SET);
+  if(length < 0)
+    {
+      fclose(fp);
+      return -1;
+    }
+  char *buffer = new char[length + 1];
+  d_size = fread(buffer, 1, length, fp);
+  fclose(fp);
+  d_data = buffer;
+  d_mapped = false;
+  d_writable = (mode == copy_on_write);
+  return 0;
+#endif
+}
+
+void mapped_file::close()
+{
+  if(d_data != NULL)
+    {
+#ifdef MAPPED_FILE_MMAP
+      if(d_mapped)
+	munmap((void*)d_data, d_size);
+      else
+#endif
+	delete [] d_data;
+    }
+  d_data = NULL;
+  d_size = 0;
+  d_mapped = false;
+  d_writable = false;
+}
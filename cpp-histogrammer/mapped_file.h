@@ -0,0 +1,69 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <string>
+#include <stddef.h>
+
+/**
+   Read-only view of the whole file in memory.
+   The file is memory-mapped where mmap() is available,
+   otherwise it is read into a buffer.
+ **/
+class mapped_file
+{
+public:
+  /** How the file is going to be used.*/
+  enum access
+    {
+      /** read-only, read from the beginning to the end*/
+      sequential,
+      /** read-only, any order*/
+      random,
+      /** pages may be changed by writable_data(), changes are private
+	  and never written to the file*/
+      copy_on_write
+    };
+  
+  mapped_file();
+  ~mapped_file();
+
+  /** Map the file.
+      \param file name.
+      \param access mode.
+      \return 0 if ok, -1 if the file can not be opened or mapped.
+  **/
+  int open(const std::string &filename, const access mode = sequential);
+  void close();
+
+  /** \return pointer to the data if the file is opened with
+      copy_on_write access, NULL otherwise.*/
+  char *writable_data() const
+  {
+    return d_writable? (char*)d_data : NULL;
+  }
+
+  const char *begin() const
+  {
+    return d_data;
+  }
+  const char *end() const
+  {
+    return d_data + d_size;
+  }
+  size_t size() const
+  {
+    return d_size;
+  }
+
+private:
+  mapped_file(const mapped_file&);
+  mapped_file &operator=(const mapped_file&);
+
+  const char *d_data;
+  size_t d_size;
+  /** true if d_data is mapped, false if it's allocated by new[]*/
+  bool d_mapped;
+  bool d_writable;
+};
+
+#endif
@@ -0,0 +1,328 @@
+#include "schiff.h"
+#include "xydata_template.h"
+#include <thread>
+#include <atomic>
+
+const double gauss_kronrod_table::xk[8] =
+  {
+    0.991455371120812639206854697526329, 0.949107912342758524526189684047851,
+    0.864864423359769072789712788640926, 0.741531185599394439863864773280788,
+    0.586087235467691130294144845693013, 0.405845151377397166906606412076961,
+    0.207784955007898467600689403773245, 0.0
+  };
+
+const double gauss_kronrod_table::wk[8] =
+  {
+    0.022935322010529224963732008058970, 0.063092092629978553290700663189204,
+    0.104790010322250183839876322541518, 0.140653259715525918745189590510238,
+    0.169004726639267902826583426598550, 0.190350578064785409913256402421014,
+    0.204432940075298892414161999234649, 0.209482141084727828012999174891714
+  };
+
+const double gauss_kronrod_table::wg[4] =
+  {
+    0.129484966168869693270611432679082, 0.279705391489276667901467771423780,
+    0.381830050505118944950369775488975, 0.417959183673469387755102040816327
+  };
+
+/** Factors of the formula which do not depend on Eg,
+    multiplied in the same order as in the script.*/
+static double schiff_constant(const schiff_parameters &p)
+{
+  const double E0_mu = p.E0()/p.mu;
+  double A = 1;
+  A *= 1/(2*M_PI)*4;
+  A *= p.Z*p.Z/137.0;
+  A *= p.r0*p.r0;
+  A *= p.norm;
+  A *= E0_mu*E0_mu;
+  return A;
+}
+
+/** (Z^(1/3)/C)^2 -- screening term of M0().*/
+static double schiff_screening(const schiff_parameters &p)
+{
+  const double s = pow(p.Z, 1.0/3.0)/p.C;
+  return s*s;
+}
+
+double schiff_flux(const schiff_parameters &p, const double Eg)
+{
+  if(!(Eg > 0) || Eg > p.Ee) return 0;
+  const double E0 = p.E0();
+  const double E = E0 - Eg;
+  const double z3 = pow(p.Z, 1.0/3.0);
+  const double t = p.mu*Eg/(2.0*E0*E);
+  const double m0 = 1.0/(t*t + (z3/p.C)*(z3/p.C));
+  const double b = 2.0*E0*E*z3/(p.C*p.mu*Eg);
+  const double b2 = b*b;
+  const double atan_b = atan(b);
+  const double e = E/E0;
+  const double a1 = (1 + e*e - 2.0/3.0*e)*(log(m0) + 1 - 2/b*atan_b);
+  const double a2 = e*(2/b2*log1p(b2) + 4*(2 - b2)/(3*b2*b)*atan_b - 8/(3*b2) + 2.0/9.0);
+  return p.norm*2*p.Z*p.Z/137.0*p.r0*p.r0/Eg*(a1 + a2);
+}
+
+static inline double schiff_kernel(const schiff_parameters &p, const double A,
+				   const double screening, const double Eg)
+{
+  if(Eg > p.Ee) return 0;
+  const double E0 = p.E0();
+  const double t = p.mu*Eg/(2.0*E0*(E0 - Eg));
+  const double m0 = 1.0/(t*t + screening);
+  const double E0_2 = E0*E0;
+  const double a1 = (E0_2 + (E0 - Eg)*(E0 - Eg))/E0_2*log(m0);
+  const double a2 = (E0 + (E0 - Eg))*(E0 + (E0 - Eg))/E0_2;
+  return A*(p.deltaEg/Eg)*(a1 - a2);
+}
+
+double schiff_value(const schiff_parameters &p, const double Eg)
+{
+  return schiff_kernel(p, schiff_constant(p), schiff_screening(p), Eg);
+}
+
+void schiff_values(const schiff_parameters &p, const double *Eg, double *result,
+		   const size_t n)
+{
+  const double A = schiff_constant(p);
+  const double screening = schiff_screening(p);
+  for(size_t i = 0; i < n; i++)
+    result[i] = schiff_kernel(p, A, screening, Eg[i]);
+}
+
+int schiff_root(const schiff_parameters &p, const double x0, double &root)
+{
+  const double tol = 1.48e-8;
+  const int maxiter = 50;
+  double p0 = x0;
+  double p1 = x0*(1 + 1e-4) + ((x0 >= 0)? 1e-4 : -1e-4);
+  double q0 = schiff_value(p, p0);
+  double q1 = schiff_value(p, p1);
+  for(int iter = 0; iter < maxiter; iter++)
+    {
+      if(q1 == q0)
+	{
+	  root = 0.5*(p1 + p0);
+	  return (p1 != p0)? -1 : 0;
+	}
+      const double next = p1 - q1*(p1 - p0)/(q1 - q0);
+      if(fabs(next - p1) < tol)
+	{
+	  root = next;
+	  return 0;
+	}
+      p0 = p1;
+      q0 = q1;
+      p1 = next;
+      q1 = schiff_value(p, p1);
+    }
+  root = p1;
+  return -1;
+}
+
+int tabulated_function::read_file(const std::string &filename, const double x_scale,
+				  const double y_scale)
+{
+  xydata<double> data;
+  if(data.read_file(filename) != 0 || data.size() < 2) return -1;
+  data.sort_ascending_x();
+  d_x.resize(data.size());
+  d_y.resize(data.size());
+  bool ok = true;
+  for(size_t i = 0; i < data.size() && ok; i++)
+    {
+      d_x[i] = data.x(i, ok)*x_scale;
+      d_y[i] = data.y(i, ok)*y_scale;
+    }
+  return ok? 0 : -1;
+}
+
+activation_calculator::activation_calculator()
+{
+  d_use_schiff = true;
+  d_schiff.norm = SCHIFF_NORM_PER_ELECTRON;
+  d_theta = 0;
+  d_electrons = 30e6;
+  d_abs_tol = 0;
+  d_rel_tol = 1e-10;
+  update_photon_energy();
+}
+
+void activation_calculator::set_schiff(const schiff_parameters &p)
+{
+  d_schiff = p;
+  d_use_schiff = true;
+  update_breaks();
+  update_photon_energy();
+}
+
+int activation_calculator::set_spectrum(const tabulated_function &histogramm,
+					const double n_electrons)
+{
+  const std::vector<double> &x = histogramm.x();
+  if(x.size() < 2 || !(n_electrons > 0)) return -1;
+  //counts in the bin -> photons per MeV per electron:
+  std::vector<double> flux(x.size());
+  for(size_t i = 0; i < x.size(); i++)
+    {
+      const double width = (i + 1 < x.size())? x[i + 1] - x[i] : x[i] - x[i - 1];
+      flux[i] = (width > 0)? histogramm.y()[i]/(width*n_electrons) : 0;
+    }
+  d_spectrum.set_data(x, flux);
+  d_use_schiff = false;
+  update_breaks();
+  update_photon_energy();
+  return 0;
+}
+
+int activation_calculator::set_cross_section(const tabulated_function &sigma)
+{
+  if(!sigma.empty() && !(sigma.min_x() > 0)) return -1;
+  d_sigma = sigma;
+  update_breaks();
+  return 0;
+}
+
+void activation_calculator::set_attenuation(const tabulated_function &attenuation)
+{
+  d_attenuation = attenuation;
+  update_breaks();
+}
+
+void activation_calculator::update_breaks()
+{
+  d_breaks = d_sigma.x();
+  if(!d_use_schiff)
+    d_breaks.insert(d_breaks.end(), d_spectrum.x().begin(), d_spectrum.x().end());
+  d_breaks.insert(d_breaks.end(), d_attenuation.x().begin(), d_attenuation.x().end());
+  std::sort(d_breaks.begin(), d_breaks.end());
+  d_breaks.erase(std::unique(d_breaks.begin(), d_breaks.end()), d_breaks.end());
+}
+
+double activation_calculator::photon_flux(const double E) const
+{
+  if(d_use_schiff)
+    return schiff_flux(d_schiff, E);
+  return d_spectrum(E);
+}
+
+/** E*F(E), the flux goes as 1/E at low energies.*/
+struct photon_energy_integrand
+{
+  const activation_calculator *calc;
+  double operator()(const double E) const
+  {
+    return E*calc->photon_flux(E);
+  }
+};
+
+void activation_calculator::update_photon_energy()
+{
+  photon_energy_integrand f;
+  f.calc = this;
+  d_photon_energy = 0;
+  if(d_use_schiff)
+    {
+      d_photon_energy = gauss_kronrod(f, 0, d_schiff.Ee, 0, 1e-8);
+      return;
+    }
+  //the table is linear between the points:
+  const std::vector<double> &x = d_spectrum.x();
+  for(size_t i = 1; i < x.size(); i++)
+    d_photon_energy += gauss_kronrod(f, x[i - 1], x[i], 0, 1e-8);
+}
+
+double activation_calculator::acceptance(const activation_target &target) const
+{
+  if(!(target.distance > 0)) return 1;
+  const double theta = (d_theta > 0)? d_theta : d_schiff.mu/d_schiff.E0();
+  const double alpha = atan(0.5*target.diameter/target.distance);
+  return 1 - exp(-(alpha/theta)*(alpha/theta));
+}
+
+double activation_calculator::integrand::operator()(const double E) const
+{
+  double thick = rho_L;//thin target
+  if(!calc->d_attenuation.empty())
+    {
+      const double mu = calc->d_attenuation(E);
+      if(mu*rho_L > 1e-8)
+	thick = -expm1(-mu*rho_L)/mu;
+    }
+  return calc->photon_flux(E)*calc->d_sigma(E)*SCHIFF_MILLIBARN*thick;
+}
+
+int activation_calculator::calculate(const activation_target &target,
+				     activation_result &result) const
+{
+  result = activation_result();
+  if(d_sigma.empty() || !(target.M > 0) || !is_physical()) return -1;
+  double low = d_sigma.min_x();
+  double high = d_sigma.max_x();
+  if(d_use_schiff)
+    high = std::min(high, d_schiff.Ee);
+  else
+    {
+      low = std::max(low, d_spectrum.min_x());
+      high = std::min(high, d_spectrum.max_x());
+    }
+  if(!(high > low)) return -1;
+
+  integrand f;
+  f.calc = this;
+  f.rho_L = target.rho*target.thickness;
+  double sum = 0, error = 0;
+  double a = low;
+  std::vector<double>::const_iterator it =
+    std::upper_bound(d_breaks.begin(), d_breaks.end(), low);
+  for(;;)
+    {
+      const double b = (it != d_breaks.end() && *it < high)? *it : high;
+      double piece_error = 0;
+      sum += gauss_kronrod(f, a, b, d_abs_tol, d_rel_tol, &piece_error);
+      error += piece_error;
+      if(b >= high) break;
+      a = b;
+      ++it;
+    }
+  const double nuclei = SCHIFF_N_AVOGADRO/target.M;
+  result.acceptance = acceptance(target);
+  result.per_electron = result.acceptance*nuclei*sum;
+  result.error = result.acceptance*nuclei*error;
+  result.total = result.per_electron*d_electrons;
+  return 0;
+}
+
+static void sweep_worker(const activation_calculator *calc,
+			 const std::vector<activation_target> *targets,
+			 std::vector<activation_result> *results,
+			 std::vector<int> *status, std::atomic<size_t> *next)
+{
+  for(size_t i = (*next)++; i < targets->size(); i = (*next)++)
+    (*status)[i] = calc->calculate((*targets)[i], (*results)[i]);
+}
+
+int activation_calculator::sweep(const std::vector<activation_target> &targets,
+				 std::vector<activation_result> &results,
+				 size_t n_threads) const
+{
+  results.assign(targets.size(), activation_result());
+  std::vector<int> status(targets.size(), 0);
+  if(n_threads == 0)
+    n_threads = std::thread::hardware_concurrency();
+  if(n_threads > targets.size())
+    n_threads = targets.size();
+  if(n_threads < 1)
+    n_threads = 1;
+  std::atomic<size_t> next(0);
+  std::vector<std::thread> threads;
+  for(size_t i = 1; i < n_threads; i++)
+    threads.push_back(std::thread(sweep_worker, this, &targets, &results, &status, &next));
+  sweep_worker(this, &targets, &results, &status, &next);
+  for(size_t i = 0; i < threads.size(); i++)
+    threads[i].join();
+  int failed = 0;
+  for(size_t i = 0; i < status.size(); i++)
+    if(status[i] != 0) failed++;
+  return failed;
+}
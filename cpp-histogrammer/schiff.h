@@ -0,0 +1,419 @@
+/*
+  Schiff bremsstrahlung spectrum and activation yield of a target,
+  native replacement of the calculations of scripts/schiff.py
+  of egamma-ta-al-in.
+
+  May be distributed and modified under the terms of the GNU
+  General Public License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+*/
+#ifndef SCHIFF_H
+#define SCHIFF_H
+
+#include <stddef.h>
+#include <math.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+/** Intervals the adaptive quadrature may split an integral into.*/
+#define SCHIFF_GK_MAX_INTERVALS 200
+
+/** Avogadro constant, 1/mole.*/
+#define SCHIFF_N_AVOGADRO 6.022e23
+
+/** Normalization of schiff_flux() per electron: nuclei per m^2
+    of the radiator, 2.8 mm of tantalum(16.654 g/cm^3, 180.9 g/mole).
+    schiff_flux() is photons per MeV per electron with it.*/
+#define SCHIFF_NORM_PER_ELECTRON 1.55e26
+
+/** 1 millibarn in cm^2.*/
+#define SCHIFF_MILLIBARN 1e-27
+
+/**
+   Parameters of the Schiff formula, defaults are the ones of schiff.py:
+   44MeV electrons on the thallium plate. Energies are in MeV.
+*/
+struct schiff_parameters
+{
+  schiff_parameters()
+  {
+    Z = 81;
+    r0 = 2.81794e-15;
+    Ee = 44;
+    mu = 0.511;
+    C = 111;
+    deltaEg = 0.008;
+    norm = 1.55e26*4.4*2.8*(1.0/deltaEg);
+  }
+
+  /** \return total energy of the electron, Ee + mu.*/
+  double E0() const
+  {
+    return Ee + mu;
+  }
+
+  /** charge of the radiator's nucleus*/
+  double Z;
+  /** classical electron radius*/
+  double r0;
+  /** kinetic energy of the electron*/
+  double Ee;
+  /** electron mass*/
+  double mu;
+  /** screening constant*/
+  double C;
+  /** width of the spectrum's bin*/
+  double deltaEg;
+  /** normalization, parameters[0] of the script(fitted to a simulated
+      spectrum), see SCHIFF_NORM_PER_ELECTRON*/
+  double norm;
+};
+
+/** \brief Schiff spectrum at photon energy Eg, schiff_func() of the script.
+    \return 0 if Eg > Ee.*/
+double schiff_value(const schiff_parameters &p, const double Eg);
+
+/** \brief Schiff spectrum on the energy grid.
+    Constant factors are computed once, the loop has no calls but log().
+    \param parameters.
+    \param energies, n values.
+    \param output array of n values.
+    \param n.
+*/
+void schiff_values(const schiff_parameters &p, const double *Eg, double *result,
+		   const size_t n);
+
+/** \brief Bremsstrahlung spectrum integrated over the photon angles,
+    formula 3BS(a) of Koch and Motz(Rev. Mod. Phys. 31, 920): the nuclei
+    per m^2 of the radiator(p.norm) times dsigma/dk(m^2/MeV).
+    schiff_value() is the spectrum at zero angle per steradian, it is
+    about (E0/mu)^2 larger and must not be used as the flux.
+    \return photons per MeV per electron for the norm
+    SCHIFF_NORM_PER_ELECTRON, 0 if Eg > Ee or Eg <= 0.*/
+double schiff_flux(const schiff_parameters &p, const double Eg);
+
+/** \brief Root of the Schiff spectrum by the secant method started at x0,
+    exactly as scipy.optimize.newton() without a derivative does it in
+    find_zero() of the script.
+    \return 0 if converged, -1 otherwise(root is the last estimate).*/
+int schiff_root(const schiff_parameters &p, const double x0, double &root);
+
+/**
+   \brief Adaptive Gauss-Kronrod(7-15 points) quadrature of f over [a, b].
+   The interval with the largest error estimate is bisected until the total
+   error is below max(abs_tol, rel_tol*|integral|) or max_intervals is reached.
+   \param function or functor double(double).
+   \param a, b -- limits.
+   \param absolute tolerance.
+   \param relative tolerance.
+   \param if not NULL, the error estimate is written there.
+   \return integral.
+*/
+template <typename F>
+double gauss_kronrod(const F &f, const double a, const double b,
+		     const double abs_tol, const double rel_tol,
+		     double *error = NULL, const size_t max_intervals = SCHIFF_GK_MAX_INTERVALS);
+
+/**
+   Piecewise-linear function given by a table of points, 0 out of the table.
+*/
+class tabulated_function
+{
+public:
+  tabulated_function() {}
+
+  /** Read 2 columns "x y" from the text file(or xydata binary file),
+      the points are sorted by x.
+      \param filename.
+      \param x values are multiplied by x_scale.
+      \param y values are multiplied by y_scale.
+      \return 0 if ok, -1 if the file can't be read or has less than 2 points.
+  */
+  int read_file(const std::string &filename, const double x_scale = 1, const double y_scale = 1);
+
+  /** Set the points, x must be ascending.*/
+  void set_data(const std::vector<double> &x, const std::vector<double> &y)
+  {
+    d_x = x;
+    d_y = y;
+  }
+
+  double operator()(const double x) const
+  {
+    if(d_x.size() < 2 || !(x >= d_x.front() && x <= d_x.back())) return 0;
+    size_t i = std::upper_bound(d_x.begin(), d_x.end(), x) - d_x.begin();
+    if(i >= d_x.size()) return d_y.back();
+    const double x1 = d_x[i - 1], x2 = d_x[i];
+    return d_y[i - 1] + (d_y[i] - d_y[i - 1])*(x - x1)/(x2 - x1);
+  }
+
+  bool empty() const
+  {
+    return d_x.size() < 2;
+  }
+
+  double min_x() const
+  {
+    return d_x.empty()? 0 : d_x.front();
+  }
+
+  double max_x() const
+  {
+    return d_x.empty()? 0 : d_x.back();
+  }
+
+  const std::vector<double> &x() const
+  {
+    return d_x;
+  }
+
+  const std::vector<double> &y() const
+  {
+    return d_y;
+  }
+
+private:
+  std::vector<double> d_x;
+  std::vector<double> d_y;
+};
+
+/**
+   Cylindrical target exposed to the photon beam. Lengths are in cm.
+   Defaults are the tantalum target of schiff.py right behind the radiator.
+*/
+struct activation_target
+{
+  activation_target()
+  {
+    thickness = 0.105;
+    diameter = 0.9;
+    distance = 0;
+    rho = 16.654;
+    M = 180.9;
+  }
+  double thickness;
+  /** diameter of the exposed round*/
+  double diameter;
+  /** distance from the radiator*/
+  double distance;
+  /** density, g/cm^3*/
+  double rho;
+  /** molar mass, g/mole*/
+  double M;
+};
+
+/** Result of the activation_calculator::calculate().*/
+struct activation_result
+{
+  activation_result() : acceptance(0), per_electron(0), total(0), error(0) {}
+  /** fraction of the photons hitting the target*/
+  double acceptance;
+  /** reactions per electron*/
+  double per_electron;
+  /** reactions for all electrons*/
+  double total;
+  /** error estimate of the quadrature, reactions per electron*/
+  double error;
+};
+
+/**
+   Activation yield of the target:
+
+   per_electron = acceptance * N_A/M * Integral( F(E) * sigma(E) * (1 - exp(-mu(E)*rho*L))/mu(E) dE )
+
+   F(E) -- photons per MeV per electron: schiff_flux()(the norm must be set
+   per electron) or the simulated spectrum. The photons must carry less
+   energy than the electron, F(E) breaking it is refused(photon_energy()).
+   sigma(E) -- photonuclear cross section(mb), mu(E) -- mass attenuation
+   coefficient of the target(cm^2/g), without it the target is thin: rho*L.
+   acceptance -- fraction of photons within the target's half-angle
+   alpha = atan(D/2/distance) for the gaussian angular distribution of width
+   theta: 1 - exp(-(alpha/theta)^2), theta is mu/E0 by default.
+   The energy integral is split at every point of the tables and each piece
+   is taken by gauss_kronrod().
+*/
+class activation_calculator
+{
+public:
+  activation_calculator();
+
+  /** Use the Schiff spectrum with these parameters, the norm must be
+      per electron(default: SCHIFF_NORM_PER_ELECTRON).*/
+  void set_schiff(const schiff_parameters &p);
+
+  /** Use the simulated spectrum.
+      \param histogramm: energy(MeV), counts in the bin.
+      \param number of simulated electrons.
+      \return 0 if ok, -1 if the spectrum has less than 2 bins.*/
+  int set_spectrum(const tabulated_function &histogramm, const double n_electrons);
+
+  /** \param cross section: energy(MeV), sigma(mb).
+      \return 0 if ok, -1 if the table starts at E <= 0, where the flux
+      of the Schiff spectrum is infinite.*/
+  int set_cross_section(const tabulated_function &sigma);
+
+  /** \param mass attenuation coefficient: energy(MeV), mu(cm^2/g).*/
+  void set_attenuation(const tabulated_function &attenuation);
+
+  /** Width of the photon angular distribution, rad.*/
+  void set_theta(const double theta)
+  {
+    d_theta = theta;
+  }
+
+  /** Number of electrons for activation_result::total.*/
+  void set_electrons(const double n_electrons)
+  {
+    d_electrons = n_electrons;
+  }
+
+  /** Tolerances of the quadrature.*/
+  void set_tolerance(const double abs_tol, const double rel_tol)
+  {
+    d_abs_tol = abs_tol;
+    d_rel_tol = rel_tol;
+  }
+
+  /** Photons per MeV per electron.*/
+  double photon_flux(const double E) const;
+
+  /** \return energy of the photons per electron, MeV.*/
+  double photon_energy() const
+  {
+    return d_photon_energy;
+  }
+
+  /** \return false if the photons carry more energy than the electron
+      has got(E0 of the Schiff parameters).*/
+  bool is_physical() const
+  {
+    return d_photon_energy < d_schiff.E0();
+  }
+
+  double acceptance(const activation_target &target) const;
+
+  /** \return 0 if ok, -1 if there's no cross section,
+      the spectrum and the cross section do not overlap
+      or the spectrum is not physical.*/
+  int calculate(const activation_target &target, activation_result &result) const;
+
+  /** Calculate all targets by n_threads threads(0 -- one per core).
+      \return number of failed targets.*/
+  int sweep(const std::vector<activation_target> &targets,
+	    std::vector<activation_result> &results, size_t n_threads = 0) const;
+
+private:
+  /** Integrand of one target.*/
+  struct integrand
+  {
+    const activation_calculator *calc;
+    /** rho*L, g/cm^2*/
+    double rho_L;
+    double operator()(const double E) const;
+  };
+
+  schiff_parameters d_schiff;
+  bool d_use_schiff;
+  tabulated_function d_spectrum;
+  tabulated_function d_sigma;
+  tabulated_function d_attenuation;
+  double d_theta;
+  double d_electrons;
+  double d_abs_tol;
+  double d_rel_tol;
+  /** photon_energy(), computed when the spectrum is set*/
+  double d_photon_energy;
+
+  /** Sorted points where the integrand is not smooth.*/
+  std::vector<double> d_breaks;
+
+  void update_breaks();
+  void update_photon_energy();
+};
+
+/** Gauss-Kronrod 7-15 nodes and weights.*/
+struct gauss_kronrod_table
+{
+  static const double xk[8];
+  static const double wk[8];
+  static const double wg[4];
+};
+
+/** One G7K15 rule on [a, b], error is |K15 - G7|.*/
+template <typename F>
+inline double gauss_kronrod_rule(const F &f, const double a, const double b, double &error)
+{
+  const double center = 0.5*(a + b);
+  const double half = 0.5*(b - a);
+  const double f_center = f(center);
+  double kronrod = f_center*gauss_kronrod_table::wk[7];
+  double gauss = f_center*gauss_kronrod_table::wg[3];
+  for(int j = 0; j < 7; j++)
+    {
+      const double dx = half*gauss_kronrod_table::xk[j];
+      const double sum = f(center - dx) + f(center + dx);
+      kronrod += gauss_kronrod_table::wk[j]*sum;
+      if(j % 2 == 1) gauss += gauss_kronrod_table::wg[j/2]*sum;
+    }
+  error = fabs((kronrod - gauss)*half);
+  return kronrod*half;
+}
+
+/** Piece of the integration interval with it's estimate.*/
+struct gauss_kronrod_interval
+{
+  double a, b, value, error;
+  bool operator<(const gauss_kronrod_interval &other) const
+  {
+    return error < other.error;
+  }
+};
+
+template <typename F>
+inline double gauss_kronrod(const F &f, const double a, const double b,
+			    const double abs_tol, const double rel_tol,
+			    double *error, const size_t max_intervals)
+{
+  std::vector<gauss_kronrod_interval> heap(1);
+  heap[0].a = a;
+  heap[0].b = b;
+  heap[0].value = gauss_kronrod_rule(f, a, b, heap[0].error);
+  double value = heap[0].value;
+  double total_error = heap[0].error;
+  while(total_error > std::max(abs_tol, rel_tol*fabs(value))
+	&& heap.size() < max_intervals)
+    {
+      std::pop_heap(heap.begin(), heap.end());
+      gauss_kronrod_interval worst = heap.back();
+      heap.pop_back();
+      const double middle = 0.5*(worst.a + worst.b);
+      if(!(middle > worst.a && middle < worst.b))
+	{//can't be split anymore:
+	  heap.push_back(worst);
+	  std::push_heap(heap.begin(), heap.end());
+	  break;
+	}
+      gauss_kronrod_interval left, right;
+      left.a = worst.a;
+      left.b = right.a = middle;
+      right.b = worst.b;
+      left.value = gauss_kronrod_rule(f, left.a, left.b, left.error);
+      right.value = gauss_kronrod_rule(f, right.a, right.b, right.error);
+      heap.push_back(left);
+      std::push_heap(heap.begin(), heap.end());
+      heap.push_back(right);
+      std::push_heap(heap.begin(), heap.end());
+      //sum again instead of updating, so the round-off does not accumulate:
+      value = total_error = 0;
+      for(size_t i = 0; i < heap.size(); i++)
+	{
+	  value += heap[i].value;
+	  total_error += heap[i].error;
+	}
+    }
+  if(error != NULL) *error = total_error;
+  return value;
+}
+
+#endif
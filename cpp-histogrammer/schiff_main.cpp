@@ -0,0 +1,316 @@
+/*
+  Program name: schiff
+  Native replacement of egamma-ta-al-in/scripts/schiff.py:
+
+    schiff SPECTRUM.txt       #same output as the script, no plot
+    schiff --yield SIGMA.txt [OPTIONS]
+
+  The second form calculates the activation yield of the target,
+  see activation_calculator in schiff.h.
+
+  May be distributed and modified under the terms of the GNU
+  General Public License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+*/
+#include "schiff.h"
+#include "xydata_template.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+/** Output of the first form, as in the script.*/
+#define SCHIFF_VALUES_NAME "func_values_output.txt"
+
+/** Output of the sweep.*/
+#define SCHIFF_SWEEP_NAME "activation_sweep.dat"
+
+static const char *usage =
+  "Program name: schiff\n"
+  "Synopsis:\n"
+  "    schiff SPECTRUM.txt\n"
+  "    schiff --yield SIGMA.txt [OPTIONS]\n\n"
+  "SPECTRUM.txt -- 2 columns: energy(keV), counts. The Schiff function is\n"
+  "                written next to them to " SCHIFF_VALUES_NAME ",\n"
+  "                like scripts/schiff.py does.\n"
+  "SIGMA.txt    -- 2 columns: energy(MeV), photonuclear cross section(mb).\n"
+  "OPTIONS:\n"
+  "  --spectrum FILE N      simulated photon spectrum(keV, counts) of N electrons,\n"
+  "                         the Schiff spectrum is used without it.\n"
+  "  --norm P0              normalization of the Schiff spectrum per electron,\n"
+  "                         radiator nuclei per m^2(1.55e26), not with --spectrum.\n"
+  "  --attenuation FILE     mass attenuation of the target(MeV, cm^2/g).\n"
+  "  --target L D R         thickness, diameter, distance, cm(0.105 0.9 0).\n"
+  "  --material RHO M       g/cm^3, g/mole(16.654 180.9).\n"
+  "  --electrons Q          number of electrons(30e6).\n"
+  "  --theta RAD            width of the photon angular distribution(mu/E0).\n"
+  "  --sweep L1 L2 NL D1 D2 ND R1 R2 NR\n"
+  "                         grid of thickness, diameter and distance,\n"
+  "                         written to " SCHIFF_SWEEP_NAME ".\n"
+  "  --threads N            threads of the sweep, one per core by default.\n";
+
+/** str() of numpy.float64 and of float: "%.12g", ".0" is added to integers.*/
+static int format_value(char *buf, const size_t size, const double value)
+{
+  int n = snprintf(buf, size, "%.12g", value);
+  int i = (buf[0] == '-')? 1 : 0;
+  while(i < n && buf[i] >= '0' && buf[i] <= '9') i++;
+  if(i == n && n + 3 <= (int)size)
+    {
+      strcpy(buf + n, ".0");
+      n += 2;
+    }
+  return n;
+}
+
+static double seconds_now()
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + 1e-6*tv.tv_usec;
+}
+
+/** Values of the first form, make_schiff_calc() of the script.*/
+static int make_schiff_calc(const char *filename)
+{
+  //the script prints these at start:
+  const activation_target target;
+  const double S = M_PI*(target.diameter/2.0)*(target.diameter/2.0);
+  const double Q_Tn = S*target.thickness*target.rho/target.M*SCHIFF_N_AVOGADRO;
+  printf("Q_Tn: %.15g\n", Q_Tn);
+  printf("coeff: %.15g\n", S*Q_Tn/30e6);
+
+  xydata<double> data;
+  if(data.read_file(filename) != 0 || data.size() < 2)
+    {
+      printf("-1FAIL: make_schiff_calc(filename): The read arrays has length less than 2 numbers.\n");
+      return -1;
+    }
+  const schiff_parameters p;
+  const size_t n = data.size();
+  std::vector<double> X(n), Y(n), X_MEV(n), FVAL(n);
+  bool ok = true;
+  for(size_t i = 0; i < n; i++)
+    {
+      X[i] = data.x(i, ok);
+      Y[i] = data.y(i, ok);
+      X_MEV[i] = X[i]/1000.0;
+    }
+  schiff_values(p, &X_MEV[0], &FVAL[0], n);
+
+  FILE *out = fopen(SCHIFF_VALUES_NAME, "w");
+  if(out == NULL)
+    {
+      fprintf(stderr, "ERROR! can't write file %s\n", SCHIFF_VALUES_NAME);
+      return -1;
+    }
+  char line[256];
+  for(size_t i = 0; i < n; i++)
+    {
+      int k = format_value(line, 60, X[i]);
+      line[k++] = '\t';
+      k += format_value(line + k, 60, Y[i]);
+      line[k++] = '\t';
+      k += format_value(line + k, 60, FVAL[i]);
+      line[k++] = '\t';
+      line[k++] = '\n';
+      fwrite(line, 1, k, out);
+    }
+  fclose(out);
+
+  printf("Value at 44MeV: %.15g\n", schiff_value(p, 44.0));
+  printf("Value at E0MeV: %.15g\n", schiff_value(p, p.E0()));
+  printf("Looking for the function root:\n");
+  double root = 0;
+  if(schiff_root(p, 44.0, root) != 0)
+    printf("(warning) the secant method did not converge.\n");
+  format_value(line, 60, root);
+  printf("The function(par, x) root is at x0 = %s\n", line);
+  printf("0make_schiff_calc(filename): success.\n");
+  return 0;
+}
+
+/** \return n values from first to last.*/
+static std::vector<double> grid(const double first, const double last, const long n)
+{
+  std::vector<double> values;
+  if(n <= 1)
+    values.push_back(first);
+  else
+    for(long i = 0; i < n; i++)
+      values.push_back(first + (last - first)*i/(n - 1));
+  return values;
+}
+
+/** Activation yield, the second form.*/
+static int make_yield_calc(int argc, char **argv)
+{
+  activation_calculator calc;
+  activation_target target;
+  schiff_parameters p;
+  p.norm = SCHIFF_NORM_PER_ELECTRON;
+  bool has_spectrum = false;
+  bool has_norm = false;
+  std::vector<double> thickness, diameter, distance;
+  size_t n_threads = 0;
+  tabulated_function table;
+  if(table.read_file(argv[2]) != 0)
+    {
+      fprintf(stderr, "ERROR! can't read cross section from %s\n", argv[2]);
+      return -1;
+    }
+  if(calc.set_cross_section(table) != 0)
+    {
+      fprintf(stderr, "ERROR! cross section in %s starts at E <= 0, the photon flux is infinite there\n",
+	      argv[2]);
+      return -1;
+    }
+  for(int i = 3; i < argc; i++)
+    {
+      const std::string option = argv[i];
+      const int left = argc - i - 1;
+      if(option == "--spectrum" && left >= 2)
+	{
+	  if(table.read_file(argv[i + 1], 1e-3) != 0
+	     || calc.set_spectrum(table, atof(argv[i + 2])) != 0)
+	    {
+	      fprintf(stderr, "ERROR! can't read spectrum from %s\n", argv[i + 1]);
+	      return -1;
+	    }
+	  has_spectrum = true;
+	  i += 2;
+	}
+      else if(option == "--norm" && left >= 1)
+	{
+	  p.norm = atof(argv[++i]);
+	  has_norm = true;
+	}
+      else if(option == "--attenuation" && left >= 1)
+	{
+	  if(table.read_file(argv[++i]) != 0)
+	    {
+	      fprintf(stderr, "ERROR! can't read attenuation from %s\n", argv[i]);
+	      return -1;
+	    }
+	  calc.set_attenuation(table);
+	}
+      else if(option == "--target" && left >= 3)
+	{
+	  target.thickness = atof(argv[i + 1]);
+	  target.diameter = atof(argv[i + 2]);
+	  target.distance = atof(argv[i + 3]);
+	  i += 3;
+	}
+      else if(option == "--material" && left >= 2)
+	{
+	  target.rho = atof(argv[i + 1]);
+	  target.M = atof(argv[i + 2]);
+	  i += 2;
+	}
+      else if(option == "--electrons" && left >= 1)
+	calc.set_electrons(atof(argv[++i]));
+      else if(option == "--theta" && left >= 1)
+	calc.set_theta(atof(argv[++i]));
+      else if(option == "--sweep" && left >= 9)
+	{
+	  thickness = grid(atof(argv[i + 1]), atof(argv[i + 2]), atol(argv[i + 3]));
+	  diameter = grid(atof(argv[i + 4]), atof(argv[i + 5]), atol(argv[i + 6]));
+	  distance = grid(atof(argv[i + 7]), atof(argv[i + 8]), atol(argv[i + 9]));
+	  i += 9;
+	}
+      else if(option == "--threads" && left >= 1)
+	n_threads = atol(argv[++i]);
+      else
+	{
+	  fprintf(stderr, "ERROR! wrong option or too few values: %s\n%s", argv[i], usage);
+	  return -1;
+	}
+    }
+
+  //the options may come in any order, the spectrum is chosen after all:
+  if(has_spectrum && has_norm)
+    {
+      fprintf(stderr, "ERROR! --norm is the Schiff spectrum's, it can't be used with --spectrum\n");
+      return -1;
+    }
+  if(!has_spectrum)
+    calc.set_schiff(p);
+  //energy conservation, a wrong norm or spectrum breaks it:
+  printf("photon energy per electron: %.6g MeV\n", calc.photon_energy());
+  if(!calc.is_physical())
+    {
+      fprintf(stderr, "ERROR! the photons carry more energy than the electron(%g MeV), "
+	      "check --norm or --spectrum\n", p.E0());
+      return -1;
+    }
+
+  if(thickness.empty())
+    {
+      activation_result result;
+      if(calc.calculate(target, result) != 0)
+	{
+	  fprintf(stderr, "ERROR! the spectrum and the cross section do not overlap.\n");
+	  return -1;
+	}
+      printf("acceptance: %.15g\n", result.acceptance);
+      printf("reactions per electron: %.15g (+- %.3g)\n", result.per_electron, result.error);
+      printf("reactions: %.15g\n", result.total);
+      return 0;
+    }
+
+  std::vector<activation_target> targets;
+  for(size_t i = 0; i < thickness.size(); i++)
+    for(size_t j = 0; j < diameter.size(); j++)
+      for(size_t k = 0; k < distance.size(); k++)
+	{
+	  target.thickness = thickness[i];
+	  target.diameter = diameter[j];
+	  target.distance = distance[k];
+	  targets.push_back(target);
+	}
+  std::vector<activation_result> results;
+  const double start = seconds_now();
+  const int failed = calc.sweep(targets, results, n_threads);
+  const double elapsed = seconds_now() - start;
+
+  FILE *out = fopen(SCHIFF_SWEEP_NAME, "w");
+  if(out == NULL)
+    {
+      fprintf(stderr, "ERROR! can't write file %s\n", SCHIFF_SWEEP_NAME);
+      return -1;
+    }
+  fprintf(out, "#thickness\tdiameter\tdistance\tacceptance\tper_electron\terror\treactions\n");
+  for(size_t i = 0; i < targets.size(); i++)
+    fprintf(out, "%g\t%g\t%g\t%.10g\t%.10g\t%.3g\t%.10g\n",
+	    targets[i].thickness, targets[i].diameter, targets[i].distance,
+	    results[i].acceptance, results[i].per_electron, results[i].error,
+	    results[i].total);
+  fclose(out);
+  printf("%lu targets in %.3f s, %d failed, written to %s\n",
+	 (unsigned long)targets.size(), elapsed, failed, SCHIFF_SWEEP_NAME);
+  return (failed == 0)? 0 : -1;
+}
+
+int main(int argc, char **argv)
+{
+  if(argc > 1 && strstr(argv[1], "-help") != NULL)
+    {
+      printf("%s", usage);
+      return 0;
+    }
+  if(argc < 2)
+    {
+      printf("%s", usage);
+      return -1;
+    }
+  if(strcmp(argv[1], "--yield") == 0)
+    {
+      if(argc < 3)
+	{
+	  printf("%s", usage);
+	  return -1;
+	}
+      return make_yield_calc(argc, argv);
+    }
+  return make_schiff_calc(argv[1]);
+}
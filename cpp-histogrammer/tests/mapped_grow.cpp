@@ -0,0 +1,67 @@
+/* ========================================================== */
+// Regression test: an xydata mapped from a binary file must be copied
+// with the file's length when set_data() or the copy-assignment
+// makes it longer than the mapping.
+//
+// Taras Schevchenko National University of Kyiv, 2012.
+/* ========================================================== */
+
+#include "xydata_template.h"
+#include <stdio.h>
+#include <math.h>
+#include <vector>
+
+/** \return y of the (param2) point, NaN if there is no such point.*/
+static double last_y(const xydata<double> &data, const size_t i)
+{
+  bool success = false;
+  const double value = data.y_at(i, success);
+  return success? value : NAN;
+}
+
+static int check(bool ok, const char *what)
+{
+  if(!ok) fprintf(stderr, "FAILED: %s\n", what);
+  return ok? 0 : 1;
+}
+
+int main()
+{
+  const std::string name = "mapped_grow_test.xyb";
+  const size_t big = 4000000;
+  int failed = 0;
+
+  const double sx[] = {1, 2, 3}, sy[] = {10, 20, 30};
+  xydata<double> small(3, sx, sy);
+  if(small.write_binary(name) != 0)
+    {
+      fprintf(stderr, "can't write %s\n", name.c_str());
+      return 1;
+    }
+
+  std::vector<double> x(big), y(big);
+  for(size_t i = 0; i < big; i++)
+    {
+      x[i] = i;
+      y[i] = 2.0*i;
+    }
+
+  //set_data() of the mapped object:
+  xydata<double> mapped;
+  failed += check(mapped.map_file(name, true) == 0 && mapped.is_mapped(), "map_file");
+  mapped.set_data(x, y);
+  failed += check(!mapped.is_mapped() && mapped.size() == big
+		  && last_y(mapped, big - 1) == 2.0*(big - 1),
+		  "set_data after map_file");
+
+  //read_file() maps binary files, then the copy-assignment:
+  xydata<double> read;
+  failed += check(read.read_file(name) == 0 && read.size() == 3, "read_file");
+  xydata<double> longer(x, y);
+  read = longer;
+  failed += check(read.size() == big && last_y(read, big - 1) == 2.0*(big - 1),
+		  "copy-assignment after read_file");
+
+  remove(name.c_str());
+  return failed;
+}
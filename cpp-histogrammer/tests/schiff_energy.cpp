@@ -0,0 +1,52 @@
+/* ========================================================== */
+// Regression test: the photon flux of the activation calculator
+// must carry less energy than the electron, and the cross section
+// starting at E = 0 is refused.
+//
+// Taras Schevchenko National University of Kyiv, 2012.
+/* ========================================================== */
+
+#include "schiff.h"
+#include <stdio.h>
+#include <vector>
+
+static int check(bool ok, const char *what)
+{
+  if(!ok) fprintf(stderr, "FAILED: %s\n", what);
+  return ok? 0 : 1;
+}
+
+int main()
+{
+  int failed = 0;
+  activation_calculator calc;
+  const schiff_parameters p;
+  printf("photon energy per electron: %g MeV of %g\n", calc.photon_energy(), p.E0());
+  failed += check(calc.photon_energy() > 0 && calc.is_physical(),
+		  "Schiff flux per electron conserves energy");
+
+  //the zero angle spectrum per steradian is (E0/mu)^2 larger than the flux:
+  failed += check(schiff_flux(p, 10)*1e3 < schiff_value(p, 10)/p.deltaEg*p.norm/SCHIFF_NORM_PER_ELECTRON,
+		  "flux is integrated over the angles");
+
+  std::vector<double> x(2), y(2, 1.0);
+  x[0] = 0;
+  x[1] = 20;
+  tabulated_function sigma;
+  sigma.set_data(x, y);
+  failed += check(calc.set_cross_section(sigma) != 0, "cross section from E = 0 is refused");
+  x[0] = 8;
+  sigma.set_data(x, y);
+  failed += check(calc.set_cross_section(sigma) == 0, "cross section from 8 MeV is taken");
+  activation_result result;
+  const activation_target target;
+  failed += check(calc.calculate(target, result) == 0 && result.per_electron > 0
+		  && result.per_electron < 1e-3, "yield per electron of 1 mb is small");
+
+  schiff_parameters heavy;
+  heavy.norm = 100*SCHIFF_NORM_PER_ELECTRON;
+  calc.set_schiff(heavy);
+  failed += check(!calc.is_physical() && calc.calculate(target, result) != 0,
+		  "a norm breaking energy conservation is refused");
+  return failed;
+}
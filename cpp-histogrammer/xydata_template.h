@@ -31,10 +31,183 @@
 #include <fstream>
 #include <vector>
 #include <algorithm>
+#include <mutex>
 #include "qpoint.h"
+#include "mapped_file.h"
 
 #define XYDATA_MAX_ARRAY_SIZE 1048576000 //1000 Mbytes
 
+/** First 8 bytes of the binary xydata file, see xydata<T>::write_binary().*/
+#define XYDATA_BINARY_MAGIC "XYDATAB1"
+
+/** Size of the binary file header, X and Y arrays start at
+    multiples of it, so the mapped arrays are aligned.*/
+#define XYDATA_BINARY_HEADER_SIZE 64
+
+/** File name suffix used by tools for binary xydata files.*/
+#define XYDATA_BINARY_SUFFIX ".xyb"
+
+/** flags of the binary file header*/
+#define XYDATA_BINARY_USER_X    0x1
+#define XYDATA_BINARY_BIG_ENDIAN 0x2
+
+/**
+   Header of the binary xydata file, numbers are in the byte order
+   of the machine which wrote the file(see XYDATA_BINARY_BIG_ENDIAN):
+
+   char     magic[8]     "XYDATAB1"
+   uint32   value_type   1 -- float, 2 -- double
+   uint32   flags        XYDATA_BINARY_* bits
+   uint64   count        number of XY points
+   uint64   x_offset     position of X array in the file
+   uint64   y_offset     position of Y array in the file
+   zero padding up to XYDATA_BINARY_HEADER_SIZE bytes.
+*/
+struct xydata_binary_header
+{
+  char magic[8];
+  unsigned int value_type;
+  unsigned int flags;
+  unsigned long long count;
+  unsigned long long x_offset;
+  unsigned long long y_offset;
+  char padding[XYDATA_BINARY_HEADER_SIZE - 40];
+};
+
+/** value_type code of T in the binary file, 0 if T can't be stored.*/
+template <typename T>
+struct xydata_binary_type
+{
+  enum {code = 0};
+};
+
+template <>
+struct xydata_binary_type<float>
+{
+  enum {code = 1};
+};
+
+template <>
+struct xydata_binary_type<double>
+{
+  enum {code = 2};
+};
+
+/** Independent accumulators per reduction, the compiler
+    turns them into SIMD registers.*/
+#define XYDATA_REDUCE_LANES 8
+
+/** Values per block of xydata_reduce(), a block stays in L1 cache
+    for the second pass over it.*/
+#define XYDATA_REDUCE_BLOCK 1024
+
+/** Type of the sums in xydata_reduce(): float data is summed in double.*/
+template <typename T>
+struct xydata_accumulator
+{
+  typedef T type;
+};
+
+template <>
+struct xydata_accumulator<float>
+{
+  typedef double type;
+};
+
+/** Min, max, sum, mean and sum of squared deviations from the mean
+    of one array, see xydata_reduce().*/
+template <typename T>
+struct xydata_stats
+{
+  typedef typename xydata_accumulator<T>::type A;
+  size_t count;
+  T min;
+  T max;
+  A sum;
+  A mean;
+  A m2;
+};
+
+/**
+   Compute all statistics of (param1) in one pass over memory.
+   Each block of XYDATA_REDUCE_BLOCK values is reduced with
+   XYDATA_REDUCE_LANES independent accumulators, which GCC and Clang
+   vectorize without -ffast-math, then the block is passed again
+   (from cache) for the squared deviations from it's own mean.
+   Blocks are merged by the Chan-Welford formula, so the variance does not
+   suffer from cancellation like sum(x^2) - sum(x)^2/N does.
+   NaN values are skipped by min and max like in a plain loop with (<).
+   
+   \param non-NULL array.
+   \param number of values, > 0.
+   \param result.
+*/
+template <typename T>
+inline void xydata_reduce(const T *v, const size_t n, xydata_stats<T> &result)
+{
+  typedef typename xydata_accumulator<T>::type A;
+  const size_t L = XYDATA_REDUCE_LANES;
+  result.count = 0;
+  result.min = result.max = v[0];
+  result.sum = result.mean = result.m2 = 0;
+
+  T lane_min[L], lane_max[L];
+  for(size_t j = 0; j < L; j++) lane_min[j] = lane_max[j] = v[0];
+  
+  for(size_t start = 0; start < n; start += XYDATA_REDUCE_BLOCK)
+    {
+      const size_t size = qMin((size_t)XYDATA_REDUCE_BLOCK, n - start);
+      const size_t vector_size = size - size % L;
+      const T *b = v + start;
+      
+      A lane_sum[L];
+      for(size_t j = 0; j < L; j++) lane_sum[j] = 0;
+      for(size_t i = 0; i < vector_size; i += L)
+	for(size_t j = 0; j < L; j++)
+	  {
+	    const T x = b[i+j];
+	    lane_sum[j] += x;
+	    lane_min[j] = (x < lane_min[j])? x : lane_min[j];
+	    lane_max[j] = (lane_max[j] < x)? x : lane_max[j];
+	  }
+      A block_sum = 0;
+      for(size_t j = 0; j < L; j++) block_sum += lane_sum[j];
+      for(size_t i = vector_size; i < size; i++)
+	{
+	  block_sum += b[i];
+	  if(b[i] < result.min) result.min = b[i];
+	  if(result.max < b[i]) result.max = b[i];
+	}
+      const A block_mean = block_sum/size;
+      
+      A lane_m2[L];
+      for(size_t j = 0; j < L; j++) lane_m2[j] = 0;
+      for(size_t i = 0; i < vector_size; i += L)
+	for(size_t j = 0; j < L; j++)
+	  {
+	    const A d = b[i+j] - block_mean;
+	    lane_m2[j] += d*d;
+	  }
+      A block_m2 = 0;
+      for(size_t j = 0; j < L; j++) block_m2 += lane_m2[j];
+      for(size_t i = vector_size; i < size; i++)
+	block_m2 += (b[i] - block_mean)*(b[i] - block_mean);
+
+      //merge the block into the result:
+      const size_t total = result.count + size;
+      const A delta = block_mean - result.mean;
+      result.mean += delta*size/total;
+      result.m2 += block_m2 + delta*delta*((A)result.count*size/total);
+      result.sum += block_sum;
+      result.count = total;
+    }
+  for(size_t j = 0; j < L; j++)
+    {
+      if(lane_min[j] < result.min) result.min = lane_min[j];
+      if(result.max < lane_max[j]) result.max = lane_max[j];
+    }
+}
+
 /** If defined in Makefile anr somewhere else**/
 #ifdef CEGUI
 #include <CEGUI/Vector.h>
@@ -82,11 +255,24 @@ class xydata
       Values will be simply copied.
   */
   xydata(const xydata<T> &other);
+
+  /** \brief Create class and take over the arrays of another instance,
+      (other) is left empty.
+  */
+  xydata(xydata<T> &&other);
+
+  /** \brief Copy values of another instance, inner arrays are reused
+      if they are large enough.*/
+  xydata<T> &operator=(const xydata<T> &other);
+
+  /** \brief Free inner arrays and take over the arrays of (other),
+      (other) is left empty.*/
+  xydata<T> &operator=(xydata<T> &&other);
   
   /** \brief allocate inner data arrays and copy values from
       std::vector<T> into Y-data array.
   */
-  xydata(const std::vector <T>);
+  xydata(const std::vector <T> &);
 
   /** \brief allocate inner data arrays and copy values from
       std::vector<T>.
@@ -95,7 +281,7 @@ class xydata
       
      \param std::vector<T> data_y to be copied into inner Y-data array;
   */
-  xydata(const std::vector <T>, const std::vector <T>);
+  xydata(const std::vector <T> &, const std::vector <T> &);
   
   
   /**\brief Copy (param1) values of T from (param2) into inner array. */
@@ -117,10 +303,10 @@ class xydata
 
   /** \brief Copy data from std vector to object.
       Y-values are set from data, X will be set to 0,1,2,3 ..*/
-  int set_data(const std::vector <T> );
+  int set_data(const std::vector <T> &);
   
   /** \brief Copy data from std vectors to object.*/
-  int set_data(const std::vector <T> , const std::vector <T>);
+  int set_data(const std::vector <T> &, const std::vector <T> &);
   
 
     
@@ -174,6 +360,8 @@ class xydata
       It will count how much each Y value happens in the array
       and create histogramm with contents like:
         Y[i]  N_events
+      Values which differ by qFuzzyIsNull() are counted as one,
+      the bins are sorted by value. O(n*log(n)), no limit of distinct values.
       
       \param reference to a bool value wo indicate whether it's ok.
       \return newly allocated xydata<T> pointer to class of bject. Return value may be NULL if operation failed.
@@ -185,6 +373,7 @@ class xydata
       It will count how much each Y value happens in the array
       and create histogramm with contents like:
         X[i]  N_events
+      Same as make_Y_histogramm(), but no swapped copy of data is made.
       
       \param reference to a bool value wo indicate whether it's ok.
       \return newly allocated xydata<T> pointer to class ofbject.      CALLER CARES ABOUT MEM. FREE.
@@ -204,7 +393,7 @@ class xydata
   inline int read_file (const char* filename, bool append = false, int max_read = -1)
   {
     std::string name = filename;
-    return this->read_file(name, append, max_read);
+    return this->read_file(name, append, (max_read > 0)? max_read : 0);
   }
   
   /** Write array values to the file.
@@ -231,6 +420,8 @@ class xydata
       if false -- I use newly created inner arrays to keep values.
       \param max_read:
       maximum read values limitation.  if <=0 -- then no limit set.
+      Binary files written by write_binary() are detected by their
+      header, a whole binary file of T is mapped by map_file(filename, true).
       \return 0 if ok, -1 if file does not exist or it's unable for reading.
   */
   int read_file (const std::string filename, bool append = false, size_t max_read = 0);
@@ -246,6 +437,33 @@ class xydata
       \return 0 if ok, -1 if file does not exist or it's unable for writing.
   */
   int write_file(const std::string filename, bool append = false, size_t max_write = -1);
+
+  /** \brief Write arrays to the binary file, see xydata_binary_header.
+      Only float and double data may be written.
+      \return 0 if ok, -1 if the file can not be written.
+  */
+  int write_binary(const std::string filename) const;
+
+  /** \brief Use arrays of the binary file without copying them.
+      The file is memory-mapped and px, py point into it until the data
+      is changed: any change which needs more memory copies the arrays first.
+      \param file name.
+      \param if false, the pages are read-only and any in-place change
+      makes a private copy of arrays first; if true, the pages are
+      copy-on-write and may be changed in place, the file is never changed.
+      \return 0 if ok, -1 if the file is not a binary xydata file of T
+      written on a machine with the same byte order.
+  */
+  int map_file(const std::string filename, const bool copy_on_write = false);
+
+  /** \brief true if arrays point into a mapped file.*/
+  bool is_mapped() const
+  {
+    return mapping != NULL;
+  }
+
+  /** \return true if the file starts with XYDATA_BINARY_MAGIC.*/
+  static bool is_binary_file(const std::string filename);
   
   /** \brief Set n_values=0, free pointer (p).*/
   int clear();
@@ -273,14 +491,28 @@ class xydata
 
   /** \brief Return number of values stored in array of T.*/
   size_t size() const;
+
+  /** \brief Return number of values the inner arrays can keep
+      without reallocation.*/
+  size_t capacity() const
+  {
+    return n_capacity;
+  }
+
+  /** \brief Allocate inner arrays for at least (param1) values,
+      stored values are preserved, length() is not changed.
+      Call it before a series of append(...) when the final size is known.
+      \return 0 on success, -1 if memory could not be allocated.
+  */
+  int reserve(const size_t);
   
   /** \brief Append new data to the one that already present.
-      Will realloc inner array (p).
+      Inner arrays grow geometrically, see reserve().
   */  
   int append(const size_t, const  T*);
   
   /** \brief Append new data to the one that already present.
-      Will realloc inner array (p).
+      Inner arrays grow geometrically, see reserve().
   */  
   int append(const size_t, const  T*, const  T*);
   
@@ -362,12 +594,14 @@ class xydata
   /** \return Y-value of the N-th point.*/
   T x_at(const size_t, bool &success) const;
   
-  /** \brief Find Y value for it's X. */
-  T y_at_x(bool &success, const T xval, const T numerror) const;
+  /** \brief Find Y value for it's X.
+      X values are searched in sorted order, O(log N) per call after
+      the index is built once. */
+  T y_at_x(bool &success, const T xval, const T numerror=1e-16) const;
   
 
   /** \brief Find X value for it's Y. */
-  T x_at_y(bool &success, const T xval, const T numerror) const;
+  T x_at_y(bool &success, const T xval, const T numerror=1e-16) const;
   
   /** \brief get minimum value from X data array*/
   T get_min_x(bool &success);
@@ -381,9 +615,9 @@ class xydata
   /** \brief get index of maximum value from Y data array*/
   T get_max_y(bool &success);
   
-  /** \brief get maximum Y value at given X-region.
+  /** \brief get maximum Y value of points with X in [x1, x2].
       \param Lesser X-region value.
-      \param Bigger Y-region value.
+      \param Bigger X-region value.
       \return T value: max. Y.
   */
   T max_y_local(const T x1, const T x2, bool &success);
@@ -497,6 +731,14 @@ class xydata
   */
   size_t find_index(const qpointf point, bool &success);
 
+  /** \brief Keep sparse tables for the *_local() functions, so that
+      range min/max costs O(1) after O(log N) search of the range.
+      Tables take 2*(log2(N)+1)*N values of T per axis and are
+      rebuilt after every change of data, so use them for fixed data only.
+      Off by default, then the range is scanned in O(log N + k).
+  */
+  void set_range_tables(const bool on);
+
   /** Exchange values of X and Y:
       it will make internal X-data array to be equal to Y values,
       Y values to be equal to previous X values.
@@ -552,6 +794,9 @@ class xydata
   
   /** py and px arrays length. */
   size_t  n_values;
+
+  /** number of values allocated for px and py, n_capacity >= n_values.*/
+  size_t  n_capacity;
   
   /** True if we're not using auto-filled with 0,1,2,3 X-array.*/
   bool user_x_values;
@@ -571,30 +816,317 @@ class xydata
   T stored_xmax;
   T stored_ymin;
   T stored_ymax;
+
+  /** sums and deviations, valid together with stored_* values.*/
+  xydata_stats<T> x_stats;
+  xydata_stats<T> y_stats;
   
-  /** Private function which checks the value of
-      int n_values
+  /** Private function which sets n_values to (param1) and
       reallocates the px, py arrays. Makes malloc(..) if they were NULL.
+      The arrays are grown before n_values is changed: a mapped file
+      is copied with it's own length, not the new one.
     
       Only used internally to shorten code, just in few cases!
+      \return 0 on success, -1 if memory could not be allocated
+      (n_values is not changed then).
   */
-  void check_and_realloc_py_px()
+  int check_and_realloc_py_px(const size_t N)
   {
-    if(n_values > 0)
+    if(N > 0 && grow(N) != 0) return -1;
+    n_values = N;
+    return 0;
+  }
+
+  /** Lookup structures over one axis of the data, built lazily by
+      find_index*(), y_at_x(), x_at_y() and the *_local() functions,
+      dropped by touch() on every change of data.
+      Const lookups may run in several threads, so the index is built
+      under (lock); once built it's only read until the next touch().*/
+  struct axis_index
+  {
+    axis_index() {state = 0;}
+
+    void reset()
+    {
+      if(state == 0) return;
+      state = 0;
+      std::vector<size_t>().swap(order);
+      std::vector<T>().swap(max_table);
+      std::vector<T>().swap(min_table);
+    }
+
+    /** 0 -- not built, 1 -- values are ascending, array index is the order,
+	2 -- (order) keeps indices of the values sorted ascending, NaN dropped.*/
+    int state;
+    std::vector<size_t> order;
+    
+    /** sparse tables of the values of the other axis taken in sorted order,
+	level k starts at k*size and keeps extrema of 2^k neighbours.*/
+    std::vector<T> max_table;
+    std::vector<T> min_table;
+
+    std::mutex lock;
+  };
+
+  mutable axis_index x_index;
+  mutable axis_index y_index;
+  bool use_range_tables;
+
+  /** file which px and py point into, NULL if they're allocated by malloc.*/
+  mapped_file *mapping;
+
+  /** Free arrays or unmap the file, pointers are left dangling.*/
+  void release_storage()
+  {
+    if(mapping != NULL)
       {
-	if(!is_empty())
-	  {
-	    px = (T*)realloc((void*)px, sizeof(T)*(n_values));
-	    py = (T*)realloc((void*)py, sizeof(T)*(n_values));
-	  }
-	else
+	delete mapping;
+	mapping = NULL;
+      }
+    else
+      {
+	free(px);
+	free(py);
+      }
+  }
+
+  /** Copy mapped arrays to malloc-ed ones of (param1) capacity.
+      \return 0 on success, -1 if memory could not be allocated.*/
+  int detach(size_t new_capacity)
+  {
+    if(mapping == NULL) return 0;
+    if(new_capacity < n_values) new_capacity = n_values;
+    if(new_capacity < 1) new_capacity = 1;
+    T *nx = (T*)malloc(sizeof(T)*new_capacity);
+    T *ny = (T*)malloc(sizeof(T)*new_capacity);
+    if(nx == NULL || ny == NULL)
+      {
+	free(nx);
+	free(ny);
+	return -1;
+      }
+    memcpy((void*)nx, (void*)px, sizeof(T)*n_values);
+    memcpy((void*)ny, (void*)py, sizeof(T)*n_values);
+    release_storage();
+    px = nx;
+    py = ny;
+    n_capacity = new_capacity;
+    return 0;
+  }
+
+  /** Copy values from the binary file, converting float/double if needed.
+      Arguments are the same as of read_file().*/
+  int read_binary(const std::string filename, bool append, size_t max_read);
+
+  /** Check header of the mapped binary file.
+      \return 0 if the file is a valid binary xydata file
+      of this machine's byte order.*/
+  static int parse_binary_header(const mapped_file &file, xydata_binary_header &header);
+
+  static bool host_is_big_endian()
+  {
+    const unsigned short one = 1;
+    return *((const unsigned char*)&one) == 0;
+  }
+
+  /** Called before values are changed in place.
+      \return 0 if px, py may be written.*/
+  int make_writable()
+  {
+    if(mapping == NULL || mapping->writable_data() != NULL) return 0;
+    return detach(n_values);
+  }
+
+  /** Mark data as changed, drops cached min/max and lookup indices.
+      Every function which changes px, py or n_values must call it.*/
+  void touch()
+  {
+    modified = true;
+    x_index.reset();
+    y_index.reset();
+  }
+
+  /** Number of positions in the sorted order of the index.*/
+  size_t index_size(const axis_index &index) const
+  {
+    return (index.state == 1)? n_values : index.order.size();
+  }
+
+  /** Array index of the (param2)-th value in sorted order.*/
+  size_t index_at(const axis_index &index, const size_t pos) const
+  {
+    return (index.state == 1)? pos : index.order[pos];
+  }
+
+  /** Build the index of (keys), unless it's built already.
+      \param values of the axis being searched.
+      \param values of the other axis, used for the range tables.
+  */
+  void build_index(axis_index &index, const T *keys, const T *others) const
+  {
+    std::lock_guard<std::mutex> guard(index.lock);
+    if(index.state != 0) return;
+    size_t i = 1;
+    while(i < n_values && keys[i-1] <= keys[i]) i++;
+    if(i >= n_values && keys[0] == keys[0])
+      index.state = 1;
+    else
+      {
+	index.order.reserve(n_values);
+	for(i = 0; i < n_values; i++)
+	  if(keys[i] == keys[i]) index.order.push_back(i);
+	key_order_less less(keys);
+	std::sort(index.order.begin(), index.order.end(), less);
+	index.state = 2;
+      }
+    if(use_range_tables) build_range_tables(index, others);
+  }
+
+  /** Compares array indices by their key, equal keys -- by index.*/
+  struct key_order_less
+  {
+    key_order_less(const T *k) : keys(k) {}
+    bool operator()(const size_t a, const size_t b) const
+    {
+      return (keys[a] < keys[b]) || (keys[a] == keys[b] && a < b);
+    }
+    const T *keys;
+  };
+
+  void build_range_tables(axis_index &index, const T *others) const
+  {
+    const size_t m = index_size(index);
+    size_t levels = 1;
+    while(((size_t)1 << levels) <= m) levels++;
+    index.max_table.resize(levels*m);
+    index.min_table.resize(levels*m);
+    for(size_t i = 0; i < m; i++)
+      index.max_table[i] = index.min_table[i] = others[index_at(index, i)];
+    for(size_t k = 1; k < levels; k++)
+      {
+	const size_t half = (size_t)1 << (k-1);
+	const T *pmax = &index.max_table[(k-1)*m];
+	const T *pmin = &index.min_table[(k-1)*m];
+	T *nmax = &index.max_table[k*m];
+	T *nmin = &index.min_table[k*m];
+	for(size_t i = 0; i + 2*half <= m; i++)
 	  {
-	    px = (T*)malloc(sizeof(T)*(n_values));
-	    py = (T*)malloc(sizeof(T)*(n_values));	  
+	    nmax[i] = qMax(pmax[i], pmax[i+half]);
+	    nmin[i] = qMin(pmin[i], pmin[i+half]);
 	  }
       }
   }
+
+  /** Find positions [begin, end) in sorted order of the keys which are
+      inside [lo, hi], values equal in qFuzzyIsNull() sense are included.
+      \return false if there are no such keys.
+  */
+  bool find_range(const axis_index &index, const T *keys,
+		  const T lo, const T hi, size_t &begin, size_t &end) const
+  {
+    size_t first = 0, last = index_size(index);
+    while(first < last)
+      {//first key which is not definitely less than lo:
+	size_t mid = first + (last - first)/2;
+	T v = keys[index_at(index, mid)];
+	if(v < lo && !qFuzzyIsNull(qAbs(v - lo))) first = mid + 1;
+	else last = mid;
+      }
+    begin = first;
+    last = index_size(index);
+    while(first < last)
+      {//first key which is definitely greater than hi:
+	size_t mid = first + (last - first)/2;
+	T v = keys[index_at(index, mid)];
+	if(v > hi && !qFuzzyIsNull(qAbs(v - hi))) last = mid;
+	else first = mid + 1;
+      }
+    end = first;
+    return begin < end;
+  }
+
+  /** Smallest array index among the matches of value in (keys).
+      If (check) is not NULL, check[i] must match (other_value) too.*/
+  size_t find_first(axis_index &index, const T *keys, const T *others,
+		    const T value, const T *check, const T other_value,
+		    bool &success) const
+  {
+    success = false;
+    if(is_empty()) return 0;
+    build_index(index, keys, others);
+    size_t begin, end, found = n_values;
+    if(!find_range(index, keys, value, value, begin, end)) return 0;
+    for(size_t pos = begin; pos < end; pos++)
+      {
+	size_t i = index_at(index, pos);
+	if(i < found && (check == NULL || qFuzzyIsNull(qAbs(check[i] - other_value))))
+	  found = i;
+	//for ascending keys the first match is the smallest index:
+	if(index.state == 1 && found < n_values) break;
+      }
+    success = (found < n_values);
+    return success? found : 0;
+  }
+
+  /** Maximum(or minimum) of (others) over the points with keys in [lo, hi].*/
+  T range_extreme(axis_index &index, const T *keys, const T *others,
+		  const T lo, const T hi, const bool maximum, bool &success) const
+  {
+    success = false;
+    if(is_empty() || hi < lo) return -1;
+    build_index(index, keys, others);
+    size_t begin, end;
+    if(!find_range(index, keys, lo, hi, begin, end)) return -1;
+    success = true;
+    if(!index.max_table.empty())
+      {
+	const size_t m = index_size(index);
+	size_t k = 0;
+	while(((size_t)2 << k) <= end - begin) k++;
+	const std::vector<T> &table = maximum? index.max_table : index.min_table;
+	T a = table[k*m + begin];
+	T b = table[k*m + end - ((size_t)1 << k)];
+	return maximum? qMax(a, b) : qMin(a, b);
+      }
+    T result = others[index_at(index, begin)];
+    for(size_t pos = begin + 1; pos < end; pos++)
+      {
+	T v = others[index_at(index, pos)];
+	if(maximum? (result < v) : (v < result)) result = v;
+      }
+    return result;
+  }
+
+  /** Make px and py arrays keep at least (param1) values.
+      Capacity is at least doubled on every reallocation, so
+      a series of append(...) copies every value O(1) times.
+      \return 0 on success, -1 if realloc failed: values and n_capacity
+      are kept then, though px may have moved to a larger block.
+  */
+  int grow(const size_t needed)
+  {
+    //everything which grows arrays also writes into them:
+    if(mapping != NULL) return detach(needed);
+    if(needed <= n_capacity) return 0;
+    size_t new_capacity = 2*n_capacity;
+    if(new_capacity < needed) new_capacity = needed;
+    T *nx = (T*)realloc((void*)px, sizeof(T)*new_capacity);
+    if(nx == NULL) return -1;
+    px = nx;
+    T *ny = (T*)realloc((void*)py, sizeof(T)*new_capacity);
+    //py still holds the old n_capacity only, so it's not updated:
+    if(ny == NULL) return -1;
+    py = ny;
+    n_capacity = new_capacity;
+    return 0;
+  }
   
+  /** Count how much each value happens in the array,
+      values equal in qFuzzyIsNull() sense are counted together.
+      Used by make_Y_histogramm() and make_X_histogramm().
+      \return newly allocated xydata<T> or NULL if there are no values.*/
+  static xydata<T> *make_histogramm_of(const T *values, const size_t count, bool &success);
+
   /** used in constructors only.*/
   void construct()
   {
@@ -603,33 +1135,50 @@ class xydata
     py = NULL;
     user_x_values = false;
     n_values  = 0;
+    n_capacity = 0;
     p_is_null = true;
+    use_range_tables = false;
+    mapping = NULL;
+    x_index.reset();
+    y_index.reset();
   }
 
   /** \brief
-      Recalculate all XY min/max values and store them.
-      Don't worry, it runs only one loop to do that.
+      Recalculate all XY min/max values, sums and deviations and store them.
+      Don't worry, it runs only one pass over each array to do that.
   */
   inline void recalc_min_max()
   {
     if( is_empty()) return;
-  
-    stored_xmin=px[0]; stored_xmax=px[0];
-    stored_ymin=py[0]; stored_ymax=py[0];
-    T tmp=0;
-    for(size_t i=1; i<n_values; i++)
-      {
-	tmp = px[i];
-	if(stored_xmin > tmp) stored_xmin = tmp;
-	if(stored_xmax < tmp) stored_xmax = tmp;
-      
-	tmp = py[i];
-	if(stored_ymin > tmp) stored_ymin = tmp;
-	if(stored_ymax < tmp) stored_ymax = tmp;
-      }
+    xydata_reduce(px, n_values, x_stats);
+    xydata_reduce(py, n_values, y_stats);
+    stored_xmin = x_stats.min; stored_xmax = x_stats.max;
+    stored_ymin = y_stats.min; stored_ymax = y_stats.max;
     modified = false;
   }
 
+  /** \return statistics of X(param1 is true) or Y array,
+      recalculated if data has been changed.*/
+  inline const xydata_stats<T> &stats(const bool of_x)
+  {
+    if(modified) recalc_min_max();
+    return of_x? x_stats : y_stats;
+  }
+
+  /** \return standard deviation of the array.
+      \param true for X array, false for Y array.
+      \param true for deviation of the mean.*/
+  inline T deviation(const bool of_x, const bool of_mean, bool &ok)
+  {
+    ok = false;
+    if(is_empty()) return -1.0;
+    ok = true;
+    if(n_values == 1) return 0;
+    const xydata_stats<T> &st = stats(of_x);
+    T sd = sqrt(st.m2/(n_values - 1));
+    return of_mean? sd/sqrt(n_values) : sd;
+  }
+
 };//end of class
 
 
@@ -670,11 +1219,49 @@ xydata<T>::xydata(const xydata<T> &other)
   set_data(other);
 }
 
+template <typename T>
+xydata<T>::xydata(xydata<T> &&other)
+{
+  construct();
+  *this = std::move(other);
+}
+
+template <typename T>
+inline xydata<T> &xydata<T>::operator=(const xydata<T> &other)
+{
+  if(this == &other) return *this;
+  if(other.is_empty())
+    clear();
+  else
+    {
+      set_data(other);
+      user_x_values = other.user_x_values;
+    }
+  return *this;
+}
+
+template <typename T>
+inline xydata<T> &xydata<T>::operator=(xydata<T> &&other)
+{
+  if(this == &other) return *this;
+  release_storage();
+  px = other.px;
+  py = other.py;
+  mapping = other.mapping;
+  n_values = other.n_values;
+  n_capacity = other.n_capacity;
+  user_x_values = other.user_x_values;
+  p_is_null = other.p_is_null;
+  touch();
+  other.construct();
+  return *this;
+}
+
 /** \brief allocate inner data arrays and copy values from
     std::vector<T> into Y-data array.
 */
 template <typename T>
-inline xydata<T>::xydata(std::vector <T> data)
+inline xydata<T>::xydata(const std::vector <T> &data)
 {
   construct();
   set_data(data);
@@ -682,7 +1269,7 @@ inline xydata<T>::xydata(std::vector <T> data)
 
 
 template <typename T>
-inline xydata<T>::xydata(std::vector <T> data_x, std::vector <T> data_y)
+inline xydata<T>::xydata(const std::vector <T> &data_x, const std::vector <T> &data_y)
 {
   construct();
   set_data(data_x, data_y);
@@ -698,24 +1285,19 @@ inline xydata<T>::xydata(const size_t N,
   
   if( (N>0) && (data_y!=NULL))
     {
-      py = (T*)malloc(sizeof(T)*N);
-      px = (T*)malloc(sizeof(T)*N);
+      if(check_and_realloc_py_px(N) != 0) return;
       memmove((void*)px, (void*)data_x, N*sizeof(T));      
       memmove((void*)py, (void*)data_y, N*sizeof(T));
       user_x_values = true;      
       p_is_null = false;
-      n_values = N;
     }
 }
 
 template <typename T>
 inline xydata<T>::~xydata()
 {
-  if(!is_empty())
-    {
-      free(py);
-      free(px);
-    }
+  //arrays may be allocated by reserve() while there are no values:
+  release_storage();
 }
 
 /**  
@@ -834,47 +1416,18 @@ T xydata<T>::y(const size_t i, bool &success) const
 
 /** \brief Find Y value for it's X. */
 template <typename T>
-inline T xydata<T>::y_at_x(bool &success, const T xval, const T numerror=1e-16 ) const
+inline T xydata<T>::y_at_x(bool &success, const T xval, const T numerror) const
 {
-
-  if( !is_empty() )
-    {
-      size_t k = 0;
-      while( k < n_values)
-	{
-	  if(qFuzzyIsNull(qAbs( px[k] - xval)))
-	    {
-	      success = true;
-	      return py[k];
-	    }
-	  k++;
-	}
-      success = false;
-    }
-  success = false;
-  return 0;
+  size_t i = find_first(x_index, px, py, xval, NULL, 0, success);
+  return success? py[i] : 0;
 }
 
 /** \brief Find X value for it's Y. */
 template <typename T>
-inline T xydata<T>::x_at_y(bool &success, const T xval, const T numerror=1e-16 ) const
+inline T xydata<T>::x_at_y(bool &success, const T xval, const T numerror) const
 {
-  if( !is_empty())
-    {
-      size_t k=0;
-      while(k<n_values)
-	{
-	  if(qFuzzyIsNull(qAbs(py[k] - xval)))
-	    {
-	      success = true;
-	      return px[k];
-	    }
-	  k++;
-	}
-      success = false;
-    }
-  success = false;
-  return -1;
+  size_t i = find_first(y_index, py, px, xval, NULL, 0, success);
+  return success? px[i] : -1;
 }
 
 /** \brief Return number of values stored in array of T.*/
@@ -901,10 +1454,9 @@ inline int xydata<T>::append(const size_t N_append, const T *data)
     {
       if(!is_empty())
 	{//preserve old data and append new one:
-	  px = (T*)realloc((void*)px, sizeof(T)*(n_values+N_append));
-	  for(int i=n_values; i<(n_values+N_append); i++)  px[i] = i+px[n_values-1];
+	  if(grow(n_values+N_append) != 0) return -1;
+	  for(size_t i=n_values; i<(n_values+N_append); i++)  px[i] = i+px[n_values-1];
 	  
-	  py = (T*)realloc((void*)py, sizeof(T)*(n_values+N_append));
 	  //now go to the end of previous data:
 	  //and copy data to there:
 	  memmove((void*)(py + n_values), (void*)data, N_append*sizeof(T));
@@ -918,7 +1470,7 @@ inline int xydata<T>::append(const size_t N_append, const T *data)
 	}
       
       p_is_null = false;
-      modified = true;
+      touch();
       return 0;
     }
   return -1;
@@ -939,15 +1491,13 @@ inline int xydata<T>::append(const size_t N_append,
   //usual case:
   if(!is_empty())
     {
-      //preserve old Y data and append new one:
-      py = (T*)realloc((void*)py, sizeof(T)*(n_values+N_append));
+      //preserve old data and append new one:
+      if(grow(n_values+N_append) != 0) return -1;
       //now go to the end of previous data:
       T *p_shifted = py + n_values;
       //and copy data to there:
       memmove((void*)p_shifted, (void*)data_y, N_append*sizeof(T));
 
-      //preserve old X data and append new one:
-      px = (T*)realloc((void*)px, sizeof(T)*(n_values+N_append));
       //now go to the end of previous data:
       p_shifted = (px + n_values);
       //and copy data to there:
@@ -956,7 +1506,7 @@ inline int xydata<T>::append(const size_t N_append,
       n_values += N_append;
       
       p_is_null = false;
-      modified = true;
+      touch();
       return 0;
     }
   else
@@ -978,14 +1528,13 @@ inline int xydata<T>::set_data(const size_t N, const T *data)
 {
   if( (N>0) && (data!=NULL))
     {
-      n_values = N;
-      check_and_realloc_py_px();
+      if(check_and_realloc_py_px(N) != 0) return -1;
       for(size_t i = 0; i < n_values; i++)
 	px[i] = i;
       //copy:
       memmove((void*)py, (void*)data, n_values*sizeof(T));
       p_is_null = false;
-      modified = true;
+      touch();
       return 0;
     }
   else
@@ -1011,14 +1560,13 @@ inline int xydata<T>::set_data(const size_t N,
 {
   if( (N > 0) && (data_y!=NULL) && (data_y!=NULL))
     {
-      this->n_values = N;
-      check_and_realloc_py_px();
+      if(check_and_realloc_py_px(N) != 0) return -1;
       //copy x:
       memmove((void*)px, (void*)data_x, n_values*sizeof(T));
       //copy y:
       memmove((void*)py, (void*)data_y, n_values*sizeof(T));
       p_is_null = false;
-      modified  = true;
+      touch();
       return 0;
     }
 #ifdef DEBUG
@@ -1039,14 +1587,7 @@ template <typename T>
 inline int xydata<T>::set_data(const xydata<T> *data)
 {
   if(data!=NULL)
-    {
-      std::vector <T> listx,listy;
-      data->copy_data(listx,listy);
-      int res = this->set_data(listx, listy);
-      if(!listx.empty()) listx.clear();
-      if(!listy.empty()) listy.clear();
-      return res;
-    }
+    return this->set_data(*data);
   return -1;
 }
 
@@ -1058,12 +1599,8 @@ inline int xydata<T>::set_data(const xydata<T> *data)
 template <typename T>
 inline int xydata<T>::set_data(const xydata<T> &data)
 {
-  std::vector <T> listx,listy;
-  data.copy_data(listx,listy);
-  int res = this->set_data(listx, listy);
-  if(!listx.empty()) listx.clear();
-  if(!listy.empty()) listy.clear();
-  return res;
+  if(data.is_empty() || &data == this) return -1;
+  return this->set_data(data.n_values, data.px, data.py);
 }
 
 
@@ -1075,21 +1612,20 @@ inline int xydata<T>::set_data(const xydata<T> &data)
     \return 0 on success, -1 is the given list got no data.
 */
 template <typename T>
-inline int xydata<T>::set_data(const std::vector <T> list)
+inline int xydata<T>::set_data(const std::vector <T> &list)
 {
   size_t N = list.size();
   if( N > 0 )
     {
-      n_values = N;
-      check_and_realloc_py_px();
+      if(check_and_realloc_py_px(N) != 0) return -1;
       //copy:
       for(size_t i=0; i < n_values; i++)
 	{
 	  px[i] = (T)i;
-	  py[i] = (T)list.at(i);
+	  py[i] = (T)list[i];
 	}
       p_is_null = false;
-      modified  = true;
+      touch();
       return 0;
     }
   else
@@ -1125,8 +1661,7 @@ inline int xydata<T>::set_data(const QList <T> list_x,
   //now realloc and copy data:
   if( N > 0 )
     {
-      n_values = N;
-      check_and_realloc_py_px();
+      if(check_and_realloc_py_px(N) != 0) return -1;
       //copy:
       for(size_t i=0; i < n_values; i++)
 	{
@@ -1134,7 +1669,7 @@ inline int xydata<T>::set_data(const QList <T> list_x,
 	  py[i] = list_y.at(i);
 	}
       p_is_null = false;
-      modified  = true;      
+      touch();      
       return 0;
     }
 #ifdef DEBUG
@@ -1157,8 +1692,8 @@ inline int xydata<T>::set_data(const QList <T> list_x,
     \return 0 on success, -1 is the given list got no data.
 */
 template <typename T>
-inline int xydata<T>::set_data(const std::vector <T> list_x,
-			       const std::vector <T> list_y)
+inline int xydata<T>::set_data(const std::vector <T> &list_x,
+			       const std::vector <T> &list_y)
 {
  size_t N = 0;
   //if list sizes are not equal then we choose minimal value:
@@ -1167,16 +1702,12 @@ inline int xydata<T>::set_data(const std::vector <T> list_x,
   //now realloc and copy data:
   if( N > 0 )
     {
-      n_values = N;
-      check_and_realloc_py_px();
+      if(check_and_realloc_py_px(N) != 0) return -1;
       //copy:
-      for(size_t i = 0; i < n_values; i++)
-	{
-	  px[i] = list_x.at(i);
-	  py[i] = list_y.at(i);
-	}
+      memmove((void*)px, (void*)&list_x[0], n_values*sizeof(T));
+      memmove((void*)py, (void*)&list_y[0], n_values*sizeof(T));
       p_is_null = false;
-      modified  = true;
+      touch();
       return 0;
     }
 #ifdef DEBUG
@@ -1217,64 +1748,36 @@ inline int xydata<T>::change_length(const size_t N_new_len)
 {
   if( N_new_len == n_values ) return 0;
   if(N_new_len < 1) {clear(); return 0;}
-  if(N_new_len < n_values && N_new_len > 1)
-    {
-      T *nx = (T*)malloc(sizeof(T)*N_new_len);
-      T *ny = (T*)malloc(sizeof(T)*N_new_len);
-      memset((void*)nx, 0x00, (size_t)(sizeof(T)*N_new_len));
-      memset((void*)ny, 0x00, (size_t)(sizeof(T)*N_new_len));
-      if( !is_empty())
-	{
-	  memmove((void*)nx, (void*)px, (size_t) (N_new_len*sizeof(T)));
-	  memmove((void*)ny, (void*)py, (size_t) (N_new_len*sizeof(T)));
-	  free(px);
-	  free(py);
-	}
-      px = nx;
-      py = ny;
+  if(N_new_len < n_values)
+    {//keep the memory, it will be reused by the next append(...):
       n_values = N_new_len;
-      modified = true;
-      return 0;
-    }
-  else
-  if( N_new_len > n_values && N_new_len > 1)
-    {
-      int previous_n_values = n_values;
-      n_values = N_new_len;
-      
-      int start_pos=0;
-      if(N_new_len > previous_n_values) start_pos = previous_n_values-1;
-      
-      //allocate and fill new bytes with 0 if needed
-      if(py!=NULL)
-	{
-	  py = (T*)realloc((void*)py, sizeof(T)*n_values);
-	  memset((void*)(py+start_pos), 0x00, sizeof(T)*(n_values-start_pos));
-	}
-      else
-	{
-	  py = (T*)malloc(sizeof(T)*n_values);
-	  memset((void*)py, 0x00, sizeof(T)*(n_values));
-	}
-      
-      if(px!=NULL)
-	{
-	  px = (T*)realloc((void*)px, sizeof(T)*n_values);
-	  memset((void*)(px+start_pos), 0x00, sizeof(T)*(n_values-start_pos));
-	}
-      else
-	{
-	  px = (T*)malloc(sizeof(T)*n_values);
-	  memset((void*)px, 0x00, sizeof(T)*(n_values));
-	}
-      
-      p_is_null = false;
-      modified = true;      
+      touch();
       return 0;
     }
+  
+  //allocate and fill new values with 0:
+  if(grow(N_new_len) != 0) return -1;
+  size_t start_pos = is_empty()? 0 : n_values;
+  memset((void*)(px+start_pos), 0x00, sizeof(T)*(N_new_len-start_pos));
+  memset((void*)(py+start_pos), 0x00, sizeof(T)*(N_new_len-start_pos));
+  n_values = N_new_len;
+  p_is_null = false;
+  touch();      
   return 0;
 }
 
+/** Allocates (protected) pointers to T: T *px, *py
+    so that they can keep (param1) values without reallocation.
+    Never shrinks the arrays, stored values and length() are preserved.
+
+    \return 0 if OK, -1 if memory could not be allocated.
+*/
+template <typename T>
+inline int xydata<T>::reserve(const size_t N)
+{
+  return grow(N);
+}
+
 /** set X value of the i-th element of the array.
     param1: index inside array.
     param2: new N-th x-value.
@@ -1282,9 +1785,10 @@ inline int xydata<T>::change_length(const size_t N_new_len)
 template <typename T>
 int xydata<T>::setx(const size_t index, const  T value)
 {
-  if(!is_empty() && index < n_values)
+  if(!is_empty() && index < n_values && make_writable() == 0)
     px[index] = value;
   else return -1;
+  touch();
   return 0;
 }
 
@@ -1295,9 +1799,10 @@ int xydata<T>::setx(const size_t index, const  T value)
 template <typename T>
 int xydata<T>::sety(const size_t index, const  T value)
 {
-  if(!is_empty() && index < n_values)
+  if(!is_empty() && index < n_values && make_writable() == 0)
     py[index] = value;
   else return -1;
+  touch();
   return 0;
 }
 
@@ -1322,7 +1827,7 @@ const T value_x, const T value_y): Arrays are empty NULLs!\n";
       return -1;
     }
   
-  if( (0<=i) && (i<n_values))
+  if( (i<n_values) && make_writable() == 0)
     {
       px[i] = value_x;
       py[i] = value_y;
@@ -1335,7 +1840,7 @@ const T value_x, const T value_y): Out of bounds!\n";
 #endif
       return -1;
     }
-  modified = true;  
+  touch();  
   return 0;
 }
 
@@ -1361,7 +1866,7 @@ const T value_x, const T value_y): Arrays are empty NULLs!\n";
       return -1;
     }
   
-  if( (0<=i) && (i<n_values))
+  if( (i<n_values) && make_writable() == 0)
     {
       px[i] = point.x();
       py[i] = point.y();
@@ -1374,7 +1879,7 @@ const T value_x, const T value_y): Out of bounds!\n";
 #endif
       return -1;
     }
-  
+  touch();
   return 0;
 }
 
@@ -1466,25 +1971,7 @@ inline T xydata<T>::get_max_y(bool &success)
 template <typename T>
 inline T xydata<T>::max_y_local(const T x1, const T x2, bool &success)
 {
-  if(this->is_empty())
-    {
-      success = false;
-      return -1;
-    }
-  size_t xi1 = find_index_x(x1);
-  size_t xi2 = find_index_x(x2);
-  if( (xi2<xi1)||(xi1 < 0)) 
-    {
-      success = false;
-      return -1;
-    }
-  T max = py[xi1];
-  for(size_t i=xi1; i<xi2; i++)
-    {
-      if(max < py[i]) max = py[i] ;
-    }
-  success = true;
-  return max;
+  return range_extreme(x_index, px, py, x1, x2, true, success);
 }
 
 /** \brief get maximum X value at given Y-region.
@@ -1495,25 +1982,7 @@ inline T xydata<T>::max_y_local(const T x1, const T x2, bool &success)
 template <typename T>
 inline T xydata<T>::max_x_local(const T y1, const T y2, bool &success)
 {
-  if(this->is_empty())
-    {
-      success = false;
-      return -1;
-    }
-  int yi1 = find_index_y(y1);
-  int yi2 = find_index_y(y2);
-  if( (yi2<yi1)||(yi1 < 0)) 
-    {
-      success = false;
-      return -1;
-    }
-  T max = px[yi1];
-  for(int i=yi1; i<yi2; i++)
-    {
-      if(max < px[i]) max = px[i] ;
-    }
-  success = true;
-  return max;
+  return range_extreme(y_index, py, px, y1, y2, true, success);
 }
 
 /** \brief get maximum Y value at given X-region.
@@ -1524,25 +1993,7 @@ inline T xydata<T>::max_x_local(const T y1, const T y2, bool &success)
 template <typename T>
 inline T xydata<T>::min_y_local(const T x1, const T x2, bool &success)
 {
-  if(this->is_empty())
-    {
-      success = false;
-      return -1;
-    }
-  int xi1 = find_index_x(x1);
-  int xi2 = find_index_x(x2);
-  if( (xi2<xi1)||(xi1 < 0)) 
-    {
-      success = false;
-      return -1;
-    }
-  T min = py[xi1];
-  for(int i=xi1; i<xi2; i++)
-    {
-      if(min > py[i]) min = py[i] ;
-    }
-  success = true;
-  return min;
+  return range_extreme(x_index, px, py, x1, x2, false, success);
 }
 
 /** \brief get min X value at given Y-region.
@@ -1553,25 +2004,7 @@ inline T xydata<T>::min_y_local(const T x1, const T x2, bool &success)
 template <typename T>
 inline T xydata<T>::min_x_local(const T y1, const T y2, bool &success)
 {
-  if(this->is_empty())
-    {
-      success = false;
-      return -1;
-    }
-  int yi1 = find_index_y(y1);
-  int yi2 = find_index_y(y2);
-  if( (yi2<yi1)||(yi1 < 0)) 
-    {
-      success = false;
-      return -1;
-    }
-  T min = px[yi1];
-  for(int i=yi1; i<yi2; i++)
-    {
-      if(min > px[i]) min = px[i] ;
-    }
-  success = true;
-  return min;
+  return range_extreme(y_index, py, px, y1, y2, false, success);
 }
 
 
@@ -1698,16 +2131,7 @@ inline size_t xydata<T>::find_index(const qpointf point, bool &success)
 template <typename T>
 inline size_t xydata<T>::find_index(const T x, const T y, bool &success)
 {
-  success = false;
-  if(is_empty()) return -1;
-  
-  for(size_t i=0; i<n_values; i++)
-    {
-      success = (qFuzzyIsCompare(px[i],x) && qFuzzyIsCompare(py[i],y));
-      if( success) return i;
-    }
-  
-  return 0;
+  return find_first(x_index, px, py, x, py, y, success);
 }
 
 /** Find index of nearest point to the given coordinates.
@@ -1716,15 +2140,7 @@ inline size_t xydata<T>::find_index(const T x, const T y, bool &success)
 template <typename T>
 inline size_t xydata<T>::find_index_x(const T x, bool &success)
 {
-  success = false;
-  if(is_empty()) return -1;
-  
-  for(size_t i=0; i<n_values; i++)
-    {
-      success = qFuzzyIsCompare(px[i],x);
-      if( success) return i;
-    }
-  return 0;
+  return find_first(x_index, px, py, x, NULL, 0, success);
 }
 
 /** Find index of nearest point to the given coordinates.
@@ -1733,15 +2149,18 @@ inline size_t xydata<T>::find_index_x(const T x, bool &success)
 template <typename T>
 inline size_t xydata<T>::find_index_y(const T y, bool &success)
 {
-  success = false;
-  if(is_empty()) return -1;
-  
-  for(size_t i=0; i<n_values; i++)
-    {
-      success = qFuzzyIsCompare(py[i],y);
-      if( success) return i;
-    }
-  return 0;
+  return find_first(y_index, py, px, y, NULL, 0, success);
+}
+
+/** Range tables are built together with the lookup index,
+    switching them changes nothing until the next lookup.*/
+template <typename T>
+inline void xydata<T>::set_range_tables(const bool on)
+{
+  if(use_range_tables == on) return;
+  use_range_tables = on;
+  x_index.reset();
+  y_index.reset();
 }
 
 /** get average value from Y data array.
@@ -1755,10 +2174,8 @@ inline T xydata<T>::average_y(bool &ok)
     {
       return -1.0;
     }
-  T sum = (T)0;
-  for(size_t i=0; i < n_values; i++)  sum += py[i];
   ok = true;
-  return sum/n_values;
+  return stats(false).mean;
 }
 
 /** get average value from X data array.
@@ -1772,10 +2189,8 @@ inline T xydata<T>::average_x(bool &ok)
     {
       return -1.0;
     }
-  T sum = (T)0;
-  for(size_t  i=0; i < n_values; i++)  sum += px[i];
   ok = true;
-  return sum/n_values;
+  return stats(true).mean;
 }
 
 /** Standart deviation.
@@ -1783,37 +2198,13 @@ inline T xydata<T>::average_x(bool &ok)
 template <typename T>
 inline T xydata<T>::SDY(bool &ok)
 {
-  ok = false;
-  if(is_empty())
-    {
-      return -1.0;
-    }
-  ok = true;
-  if(n_values == 1) return 0;
-  T av = average_y(ok);
-  T sum = (T)0;
-  for(size_t i=0; i < n_values; i++)
-    sum += pow(py[i] - av, 2.0);
-  
-  return sqrt(sum/(n_values - 1));
+  return deviation(false, false, ok);
 }
 
 template <typename T>
 inline T xydata<T>::SDX(bool &ok)
 {
-  ok = false;
-  if(is_empty())
-    {
-      return -1.0;
-    }
-  ok = true;
-  if(n_values == 1) return 0;
-  T av = average_x(ok);
-  T sum = (T)0;
-  for(size_t i=0; i < n_values; i++)
-    sum += pow(px[i] - av, 2.0);
-
-  return sqrt(sum/(n_values - 1));
+  return deviation(true, false, ok);
 }
 
 /** \brief get standart deviation of the mean value from Y data array.
@@ -1824,10 +2215,7 @@ inline T xydata<T>::SDX(bool &ok)
 template <typename T>
 T xydata<T>::SDMEAN_Y(bool &ok)
 {
-  if(n_values > 0)
-    return SDY(ok)/sqrt(n_values);
-  ok = false;
-  return (T)(-1);
+  return deviation(false, true, ok);
 }
 
 /** \brief get standart deviation of the mean value from X data array.
@@ -1838,10 +2226,7 @@ T xydata<T>::SDMEAN_Y(bool &ok)
 template <typename T>
 T xydata<T>::SDMEAN_X(bool &ok)
 {
-  if(n_values > 0)
-    return SDX(ok)/sqrt(n_values);
-  ok = false;
-  return (T)(-1);
+  return deviation(true, true, ok);
 }
 
 
@@ -1857,10 +2242,7 @@ T xydata<T>::SUMY(bool &ok)
       return -1.0;
   
   ok = true;
-  T sum = (T)0;
-  for(size_t i = 0; i < n_values; i++)  sum += py[i];
-
-  return sum;
+  return stats(false).sum;
 }
 
 /** \brief sum of X values;
@@ -1875,9 +2257,7 @@ T xydata<T>::SUMX(bool &ok)
       return -1.0;
   
   ok = true;
-  T sum = (T)0;
-  for(size_t i = 0; i < n_values; i++)  sum += px[i];
-  return sum;
+  return stats(true).sum;
 }
 
 /**
@@ -1994,6 +2374,7 @@ int xydata<T>::copy_xdata(size_t &bcount, size_t &icount, T *data) const
   bcount = n_values*sizeof(T);
   icount = n_values;
   memmove((void*)data, (void*)px, bcount);
+  return 0;
 }
 
 /** \brief Copy inner Y data into array of T values.
@@ -2009,6 +2390,7 @@ int xydata<T>::copy_ydata(size_t &bcount, size_t &icount, T *data) const
   bcount = n_values*sizeof(T);
   icount = n_values;
   memmove((void*)data, (void*)py, bcount);
+  return 0;
 }
 
 
@@ -2022,13 +2404,13 @@ int xydata<T>::copy_ydata(size_t &bcount, size_t &icount, T *data) const
 template <typename T>
 inline int xydata<T>::clear()
 {
-  if( !is_empty())
-    {
-      if(py!=NULL) free(py);
-      if(px!=NULL) free(px);
-      p_is_null = true;
-      n_values = 0;
-    }
+  release_storage();
+  px = NULL;
+  py = NULL;
+  p_is_null = true;
+  n_values = 0;
+  n_capacity = 0;
+  touch();
   return 0;
 }
 
@@ -2078,6 +2460,11 @@ inline int xydata<T>::print() const
 template <typename T>
 inline int xydata<T>::read_file (const std::string filename, bool append, size_t max_read)
 {
+  if(is_binary_file(filename))
+    {//whole file of the same type is not even copied:
+      if(!append && max_read == 0 && map_file(filename, true) == 0) return 0;
+      return read_binary(filename, append, max_read);
+    }
   size_t read_count = 0;
   size_t  count = 0;
   const int chunk_size = 1024;
@@ -2104,8 +2491,8 @@ inline int xydata<T>::read_file (const std::string filename, bool append, size_t
 	  read_count ++;
 	  good = stream.good();
 	}  while(good && read_count < chunk_size);
-      //push px,py to xydata<T>:
-      this->append((read_count-1), vx, vy);
+      //push px,py to xydata<T>, the last pair is incomplete if reading failed:
+      this->append(good? read_count : (read_count-1), vx, vy);
       count += read_count;
     }
   
@@ -2124,9 +2511,8 @@ inline int xydata<T>::read_file (const std::string filename, bool append, size_t
 template <typename T>
 inline int xydata<T>::write_file(const std::string filename, bool append, size_t max_write)
 {
-  int count      = 0;
-  int good_index = 0;
-  T v2[2];
+  size_t count   = 0;
+  T v2[2] = {0, 0};
 
   std::ofstream stream;
   if(append)
@@ -2140,18 +2526,164 @@ inline int xydata<T>::write_file(const std::string filename, bool append, size_t
       return -1;
     }
   size_t limit = (max_write > 0)? max_write : this->n_values;
-  do
+  //only the points which exist are written:
+  while(stream.good() && count < limit && at(count, &v2[0]) == 0)
     {
-      good_index = at(count, &v2[0]);
       stream << v2[0]<<'\t'<< v2[1]<<'\n';
       count ++;
-    }  while(stream.good() && count < limit && good_index == 0);
+    }
   
   stream.close();
   return 0;
 
 }
 
+/** Write header, X and Y arrays to the file,
+    X and Y arrays are aligned to XYDATA_BINARY_HEADER_SIZE.
+    \return 0 if ok, -1 if T is not float/double or file can't be written.
+*/
+template <typename T>
+inline int xydata<T>::write_binary(const std::string filename) const
+{
+  if(xydata_binary_type<T>::code == 0) return -1;
+  const size_t count = is_empty()? 0 : n_values;
+  const size_t bytes = count*sizeof(T);
+  const size_t padded = (bytes + XYDATA_BINARY_HEADER_SIZE - 1)
+    /XYDATA_BINARY_HEADER_SIZE*XYDATA_BINARY_HEADER_SIZE;
+  xydata_binary_header header;
+  memset((void*)&header, 0x00, sizeof(header));
+  memcpy(header.magic, XYDATA_BINARY_MAGIC, 8);
+  header.value_type = xydata_binary_type<T>::code;
+  header.flags = (user_x_values? XYDATA_BINARY_USER_X : 0)
+    | (host_is_big_endian()? XYDATA_BINARY_BIG_ENDIAN : 0);
+  header.count = count;
+  header.x_offset = XYDATA_BINARY_HEADER_SIZE;
+  header.y_offset = header.x_offset + padded;
+  
+  FILE *fp = fopen(filename.c_str(), "wb");
+  if(fp == NULL) return -1;
+  char zeros[XYDATA_BINARY_HEADER_SIZE];
+  memset(zeros, 0x00, sizeof(zeros));
+  bool good = (fwrite(&header, sizeof(header), 1, fp) == 1);
+  if(count > 0)
+    {
+      good = good && (fwrite(px, sizeof(T), count, fp) == count);
+      good = good && (fwrite(zeros, 1, padded - bytes, fp) == padded - bytes);
+      good = good && (fwrite(py, sizeof(T), count, fp) == count);
+    }
+  if(fclose(fp) != 0) good = false;
+  return good? 0 : -1;
+}
+
+template <typename T>
+inline bool xydata<T>::is_binary_file(const std::string filename)
+{
+  FILE *fp = fopen(filename.c_str(), "rb");
+  if(fp == NULL) return false;
+  char magic[8];
+  bool result = (fread(magic, 1, 8, fp) == 8 && memcmp(magic, XYDATA_BINARY_MAGIC, 8) == 0);
+  fclose(fp);
+  return result;
+}
+
+template <typename T>
+inline int xydata<T>::parse_binary_header(const mapped_file &file,
+					  xydata_binary_header &header)
+{
+  if(file.size() < sizeof(header)) return -1;
+  memcpy((void*)&header, file.begin(), sizeof(header));
+  if(memcmp(header.magic, XYDATA_BINARY_MAGIC, 8) != 0) return -1;
+  //byte swapping would need a copy anyway, such files are not supported:
+  if(((header.flags & XYDATA_BINARY_BIG_ENDIAN) != 0) != host_is_big_endian())
+    return -1;
+  size_t value_size = 0;
+  if(header.value_type == 1) value_size = sizeof(float);
+  if(header.value_type == 2) value_size = sizeof(double);
+  if(value_size == 0) return -1;
+  const unsigned long long bytes = header.count*value_size;
+  if(header.count > file.size()/value_size
+     || header.x_offset % value_size != 0 || header.y_offset % value_size != 0
+     || header.x_offset > file.size() || file.size() - header.x_offset < bytes
+     || header.y_offset > file.size() || file.size() - header.y_offset < bytes)
+    return -1;
+  return 0;
+}
+
+template <typename T>
+inline int xydata<T>::map_file(const std::string filename, const bool copy_on_write)
+{
+  if(xydata_binary_type<T>::code == 0) return -1;
+  mapped_file *file = new mapped_file;
+  xydata_binary_header header;
+  if(file->open(filename, copy_on_write? mapped_file::copy_on_write : mapped_file::random) != 0
+     || parse_binary_header(*file, header) != 0
+     || header.value_type != (unsigned)xydata_binary_type<T>::code)
+    {
+      delete file;
+      return -1;
+    }
+  clear();
+  if(header.count == 0)
+    {
+      delete file;
+      return 0;
+    }
+  char *base = copy_on_write? file->writable_data() : (char*)file->begin();
+  mapping = file;
+  px = (T*)(base + header.x_offset);
+  py = (T*)(base + header.y_offset);
+  n_values = header.count;
+  n_capacity = n_values;
+  user_x_values = (header.flags & XYDATA_BINARY_USER_X) != 0;
+  p_is_null = false;
+  touch();
+  return 0;
+}
+
+template <typename T>
+inline int xydata<T>::read_binary(const std::string filename, bool append, size_t max_read)
+{
+  mapped_file file;
+  xydata_binary_header header;
+  if(file.open(filename) != 0 || parse_binary_header(file, header) != 0)
+    return -1;
+  size_t count = header.count;
+  if(max_read > 0 && max_read < count) count = max_read;
+  if(!append) clear();
+  if(count == 0) return 0;
+  if(!append || is_empty()) reserve(count);
+  else reserve(n_values + count);
+
+  const char *x_start = file.begin() + header.x_offset;
+  const char *y_start = file.begin() + header.y_offset;
+  if(header.value_type == (unsigned)xydata_binary_type<T>::code)
+    return this->append(count, (const T*)x_start, (const T*)y_start);
+
+  //convert by chunks:
+  const size_t chunk_size = 1024;
+  T vx[chunk_size];
+  T vy[chunk_size];
+  for(size_t start = 0; start < count; start += chunk_size)
+    {
+      const size_t n = qMin(chunk_size, count - start);
+      for(size_t i = 0; i < n; i++)
+	{
+	  if(header.value_type == 1)
+	    {
+	      vx[i] = (T)((const float*)x_start)[start + i];
+	      vy[i] = (T)((const float*)y_start)[start + i];
+	    }
+	  else
+	    {
+	      vx[i] = (T)((const double*)x_start)[start + i];
+	      vy[i] = (T)((const double*)y_start)[start + i];
+	    }
+	}
+      if(this->append(n, vx, vy) != 0) return -1;
+    }
+  return 0;
+}
+
 /** Output tab-separated values of arrays to stream.
     \param stream
     reference of the stream.
@@ -2162,16 +2694,14 @@ inline int xydata<T>::write_file(const std::string filename, bool append, size_t
 template <typename T>
 inline std::ostream &operator<<(std::ostream &stream, const xydata<T> &data)
 {
-  int count      = 0;
-  int n_values   = data.length();
-  int good_index = 0;
-  T v2[2];
-  do
+  size_t count    = 0;
+  size_t n_values = data.length();
+  T v2[2] = {0, 0};
+  while(stream.good() && count < n_values && data.at(count, &v2[0]) == 0)
     {
-      good_index = data.at(count, &v2[0]);
       stream << v2[0]<< v2[1];
       count ++;
-    }  while(stream.good() && count < n_values && good_index == 0);
+    }
   return stream;
 }
 
@@ -2240,73 +2770,64 @@ inline const T* xydata<T>::get_ypointer(size_t &bytes_count, size_t &items_count
 template <typename T>
 xydata<T> * xydata<T>::make_Y_histogramm(bool &success)
 {
-  std::vector<T> values;
-  std::vector<T> events;
+  if(is_empty())
+    {
+      success = false;
+      return NULL;
+    }
+  return make_histogramm_of(py, n_values, success);
+}
 
+template<typename T>
+xydata<T> *xydata<T>::make_X_histogramm(bool &success)
+{
+  if(is_empty())
+    {
+      success = false;
+      return NULL;
+    }
+  return make_histogramm_of(px, n_values, success);
+}
+
+/** Sort a copy of the values, then count runs of equal values:
+    a run starts with it's smallest value and takes all values
+    fuzzy-equal to it, O(n*log(n)) in total.
+    The bins are in increasing order of the values.
+*/
+template<typename T>
+xydata<T> *xydata<T>::make_histogramm_of(const T *values, const size_t count, bool &success)
+{
   std::vector<T> temp;
-  //copy Y values to vector:
-  copy_data(temp);
-  
-  std::vector<size_t> remove_marks;
-  size_t max_cycle = 1e06;
-  size_t cycle_cnt = 0;
+  temp.reserve(count);
+  for(size_t cnt = 0; cnt < count; cnt++)
+    if(values[cnt] == values[cnt])//NaN is equal to nothing
+      temp.push_back(values[cnt]);
+  std::sort(temp.begin(), temp.end());
 
-  while(temp.size() > 0 && cycle_cnt < max_cycle)
+  std::vector<T> bins;
+  std::vector<T> events;
+  size_t cnt = 0;
+  while(cnt < temp.size())
     {
-      
-      T value = temp[0];
-      T event_count = 0;
-      for(size_t cnt = 0; cnt < temp.size(); cnt++)
-	{
-	  if(qFuzzyIsNull(qAbs(temp[cnt] - value)))
-	    {
-	      event_count++;
-	      remove_marks.push_back(cnt);
-	    }
-	}
+      const T value = temp[cnt];
+      size_t run_end = cnt + 1;
+      while(run_end < temp.size() && qFuzzyIsNull(qAbs(temp[run_end] - value)))
+	run_end++;
       //create new bin in histogramm:
-      values.push_back(value);
-      events.push_back(event_count);
-      
-      //this will help to less and get more:
-      //now clear out this value from temp vector:
-      for(size_t cnt = 0; cnt < remove_marks.size(); cnt++)
-	{
-	  typename std::vector<T>::iterator rm_iter = (temp.begin() + remove_marks[cnt] - cnt);
-	  if(rm_iter >= temp.begin() && rm_iter < temp.end())
-	    {
-	      temp.erase(rm_iter);
-	    }
-	}
-      remove_marks.clear();
-      //proceed to new value...
-      cycle_cnt++;
+      bins.push_back(value);
+      events.push_back((T)(run_end - cnt));
+      cnt = run_end;
     }
-  if(values.empty() || events.empty()) 
+  if(bins.empty())
     {
       success = false;
       return NULL;
     }
-  
-  xydata<T> *result = new xydata(values, events);
-  values.clear();
-  events.clear();
-  temp.clear();
+  xydata<T> *result = new xydata(bins, events);
+  success = true;
   return result;
 }
 
-template<typename T>
-xydata<T> *xydata<T>::make_X_histogramm(bool &success)
-{
-  xydata<T> *temp = new xydata<T>(this);
-  temp->swap_xy();
-  bool ok = false;
-  xydata<T> * xhisto = temp->make_Y_histogramm(ok);
-  delete temp;
-  success = (ok && xhisto != NULL);
-  return xhisto;
-}
-
 #ifndef d_item_by_xy
 #define d_item_by_xy
 template<typename T>
@@ -2342,6 +2863,7 @@ void xydata<T>::sort_ascending_x()
   for(size_t cnt = 0; cnt < n_values; cnt++)
     alldata.push_back( item_by_x<T>( px[cnt], py[cnt]) );
   sort(alldata.begin(), alldata.end());
+  if(make_writable() != 0) return;
   
   for(size_t cnt = 0; cnt < n_values; cnt++)
     {
@@ -2350,6 +2872,7 @@ void xydata<T>::sort_ascending_x()
       py[cnt] = item.v2;
     }
   alldata.clear();
+  touch();
 }
 
 template<typename T>
@@ -2360,6 +2883,7 @@ void xydata<T>::sort_ascending_y()
   for(size_t cnt = 0; cnt < n_values; cnt++)
     alldata.push_back( item_by_y<T>( px[cnt], py[cnt]) );
   sort(alldata.begin(), alldata.end());
+  if(make_writable() != 0) return;
   
   for(size_t cnt = 0; cnt < n_values; cnt++)
     {
@@ -2368,6 +2892,7 @@ void xydata<T>::sort_ascending_y()
       py[cnt] = item.v2;
     }
   alldata.clear();
+  touch();
 }
 
 
@@ -2404,6 +2929,7 @@ void xydata<T>::swap_xy()
   T *p = px;
   px = py;
   py = p;
+  touch();
 }
 
 
@@ -30,18 +30,20 @@
 #include "DetectorConstruction.hh"
 #include "PhysicsList.hh"
 
-#include "PrimaryGeneratorAction.hh"
+#include "ActionInitialization.hh"
 
+#ifdef G4MULTITHREADED
+#include "G4MTRunManager.hh"
+#else
 #include "G4RunManager.hh"
-#include "RunAction.hh"
-#include "EventAction.hh"
-#include "SteppingAction.hh"
+#endif
 #include "G4UImanager.hh"
 #include "G4VisExecutive.hh"
 #include "Randomize.hh"
 #include <ctime>
 #include "anyoption.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #define MAX_HIST 100e03 //kev
@@ -120,13 +122,23 @@ int main(int argc, char** argv)
   CLHEP::HepRandom::setTheSeed(time(NULL));
 
   // создание класса для управления моделированием
+#ifdef G4MULTITHREADED
+  /** Multithreaded mode: by default one worker per core,
+      the number of threads may be given after the mac-file name:
+      exgps run.mac 16
+   */
+  G4MTRunManager* runManager = new G4MTRunManager;
+  G4int n_threads = G4Threading::G4GetNumberOfCores();
+  if(argc > 2 && atoi(argv[2]) > 0)
+    n_threads = atoi(argv[2]);
+  runManager->SetNumberOfThreads(n_threads);
+#else
   G4RunManager* runManager = new G4RunManager;
+#endif
 
   // подключение обязательных классов: описание частиц, процессов, геометрии и источника
-  runManager->SetUserInitialization(new PhysicsList);
-
-  EventAction *userEventAction = new EventAction();
-  runManager->SetUserAction(userEventAction);
+  PhysicsList *physics_list = new PhysicsList;
+  runManager->SetUserInitialization(physics_list);
 
   DetectorConstruction *construction_unit = new DetectorConstruction();
 
@@ -138,37 +150,18 @@ int main(int argc, char** argv)
 
   construction_unit->set_histo(0,MAX_HIST,12500,1);
 
-  
-  PrimaryGeneratorAction *gen_action = new PrimaryGeneratorAction();
-  //set gen_action's configuration from the map with params:
-  //gen_action->read_parameters(str_double_map);
-  
+
   runManager->SetUserInitialization(construction_unit);
-  runManager->SetUserAction(gen_action);
   
-  /** Створюємо клас, який містить методи, які GEANT4 запускатиме на
-      початку та в кінці симуляції,
+  /** Створюємо клас, який створює для кожного потоку класи, що містять
+      методи, які GEANT4 запускатиме на початку та в кінці симуляції,
       див. RunAction::BeginOfRunAction(G4Run*) та 
-      RunAction::EndOfRunAction(G4Run*).
+      RunAction::EndOfRunAction(G4Run*), а також
+      PrimaryGeneratorAction, EventAction, SteppingAction.
    */
-  RunAction *userAction = new RunAction();
-  /**
-     assign pointer std::vector<DetectorSD*> *DSD_vector
-     from RunAction class to make histograms from detector data:
-  **/
-  userAction->DSD_vector = &construction_unit->vector_DetectorSD;
-  runManager->SetUserAction(userAction);
-  
-  SteppingAction *userSteppingAction = new SteppingAction();
-  /** Assign vector of special detection counters which only
-      track kinetic energy of incoming particles with no interaction:
-  **/
-  userSteppingAction->SetDetectorSD(&construction_unit->vector_DetectorSD);
-  runManager->SetUserAction(userSteppingAction);
-  
+  runManager->SetUserInitialization(new ActionInitialization(construction_unit,
+							  physics_list));
 
-
-  
   // создание и настройка класса для управления визуализацией
   G4VisManager* visManager = new G4VisExecutive;
   visManager->Initialize();
@@ -0,0 +1,65 @@
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+///*
+// Part of simulation for use with GEANT4 code.
+// Taras Schevchenko National University of Kyiv 2012
+//****************
+
+#ifndef ActionInitialization_h
+#define ActionInitialization_h 1
+
+#include "G4VUserActionInitialization.hh"
+
+class DetectorConstruction;
+class PhysicsList;
+
+class ActionInitialization : public G4VUserActionInitialization
+{
+  /**
+     Creates user actions for every thread.
+     In sequential mode Build() is called once, in multithreaded mode
+     every worker thread gets it's own set of actions and it's own
+     DetectorSD2 objects (see DetectorConstruction::ConstructSDandField()),
+     while the master thread only has a RunAction which merges
+     and saves the data collected by workers.
+   */
+public:
+  /** \param construction -- the detector construction.
+      \param physics -- the physics list, the master's RunAction stores
+      it's tables to the cache.*/
+  ActionInitialization(DetectorConstruction *construction, PhysicsList *physics);
+  ~ActionInitialization();
+
+  /** Create the actions of the master thread: only RunAction.*/
+  void BuildForMaster() const;
+
+  /** Create the actions of a worker thread(or sequential run manager).*/
+  void Build() const;
+
+private:
+  DetectorConstruction *construction_unit;
+  PhysicsList *physics_list;
+};
+
+#endif
@@ -0,0 +1,82 @@
+/* ========================================================== */
+// Part of simulation for use with GEANT4 code.
+// Pulse heights of the split histories in a detector.
+// Header only: the e-gamma simulation(other/egamma-ta-al-in)
+// includes it from here too.
+//
+// Taras Schevchenko National University of Kyiv, 2012.
+/* ========================================================== */
+
+#ifndef BranchDeposits_h
+#define BranchDeposits_h 1
+
+#include "G4Track.hh"
+#include "G4ParticleDefinition.hh"
+#include "globals.hh"
+#include <map>
+
+class BranchDeposits
+{
+  /**
+     With splitting the copies of one particle are alternatives of each
+     other, their deposits must not be summed per event. A branch is
+     a track which entered the detector together with it's descendants
+     born inside, it's deposit is scored with the weight the track had
+     when it entered. Tracks are added in the order Geant4 tracks them,
+     so the parent of a secondary born inside is always known already.
+   */
+public:
+  /** Energy of one branch.*/
+  struct branch
+  {
+    /** particle which entered the detector*/
+    const G4ParticleDefinition *definition;
+    double weight;
+    double energy;
+  };
+
+  typedef std::map<G4int, branch> branch_map;
+
+  /** Forget the branches, call it at the start of each event.*/
+  void clear()
+  {
+    if(track_branch.empty()) return;
+    track_branch.clear();
+    deposits.clear();
+  }
+
+  /** Add a deposit of the track's step to it's branch.*/
+  void add(const G4Track *track, const G4double edep)
+  {
+    const G4int id = track->GetTrackID();
+    std::map<G4int, G4int>::iterator found = track_branch.find(id);
+    if(found == track_branch.end())
+      {
+	std::map<G4int, G4int>::iterator parent = track_branch.find(track->GetParentID());
+	const G4int branch_id = (parent != track_branch.end())? parent->second : id;
+	found = track_branch.insert(std::pair<G4int, G4int>(id, branch_id)).first;
+	if(branch_id == id)
+	  {
+	    branch entered;
+	    entered.definition = track->GetDefinition();
+	    entered.weight = track->GetWeight();
+	    entered.energy = 0;
+	    deposits.insert(std::pair<G4int, branch>(id, entered));
+	  }
+      }
+    deposits[found->second].energy += edep;
+  }
+
+  /** \return the branches of the event by the ID of the entered track.*/
+  const branch_map& branches() const
+  {
+    return deposits;
+  }
+
+private:
+  /** track ID -> ID of the track which entered the detector*/
+  std::map<G4int, G4int> track_branch;
+  branch_map deposits;
+};
+
+#endif
@@ -10,6 +10,8 @@
 #define DetectorConstruction_H
 
 #include "DetectorSD2.hh"
+#include "WeightWindowGenerator.hh"
+#include "StackingAction.hh"
 
 #include "G4Material.hh"
 #include "G4Box.hh"
@@ -22,8 +24,10 @@
 #include "globals.hh"
 #include "G4VisAttributes.hh" 
 #include "G4SDManager.hh"
+#include "G4UserLimits.hh"
 
 #include <vector>
+#include <map>
 #include "G4VUserDetectorConstruction.hh"
 #include "DetectorSD.hh"
 #include "DetectorConstructionMessenger.hh"
@@ -36,6 +40,11 @@
         #define M_PI 3.141592653589793
 #endif
 
+/** Regions made by Construct(): the polyethylene box and the detectors,
+    the rest of the world is in the default region.*/
+#define REGION_SHIELD "SHIELD"
+#define REGION_DETECTORS "DETECTORS"
+
 class DetectorConstruction : public G4VUserDetectorConstruction
 {                 
   public:
@@ -43,13 +52,29 @@ class DetectorConstruction : public G4VUserDetectorConstruction
     ~DetectorConstruction();
   
   G4VPhysicalVolume* Construct();
+
+  /** Create sensitive detectors of the current thread and attach them
+      to the logical volumes made by Construct().
+      Called once in sequential mode and once per each worker thread
+      in multithreaded mode.
+   */
+  void ConstructSDandField();
   
   /** Vector of pointers to DetectorSD objects.
       It will be filled on this->Construct() method call.
       Address of this object may be passed to other places.
+      In multithreaded mode these are the master's detectors:
+      they don't get hits, but collect data merged from the worker threads.
    */
   std::vector<DetectorSD2*> vector_DetectorSD;
 
+  /** Vector of DetectorSD2 objects which get hits in the calling thread.
+      It's the vector_DetectorSD itself for the master(or sequential) thread,
+      and thread-local vector for the worker threads, it is
+      filled on this->ConstructSDandField() call.
+   */
+  std::vector<DetectorSD2*> *GetDetectorSDVector();
+
 
   /** 
       Read parameters values from a map<G4String, G4double>;
@@ -93,7 +118,9 @@ class DetectorConstruction : public G4VUserDetectorConstruction
    */
   void set_histo_bins(const G4int bins)
   {
+    if(bins <= 0) return;
     d_hist_bins = bins;
+    apply_histo();
   }
 
   /** Set number of histogram min value.
@@ -102,6 +129,7 @@ class DetectorConstruction : public G4VUserDetectorConstruction
   void set_histo_min(const G4double min)
   {
     d_hist_min = min;
+    apply_histo();
   }
 
   /** Set number of histogram max value.
@@ -110,8 +138,103 @@ class DetectorConstruction : public G4VUserDetectorConstruction
   void set_histo_max(const G4double max)
   {
     d_hist_max = max;
+    apply_histo();
+  }
+
+
+  /** Make histogram bins of equal width in log(E),
+      the histogram minimum must be positive then.*/
+  void set_histo_log(const G4bool log);
+
+  /** Set histogram bins by their edges.
+      \param ascending edges in units that are currently set, separated by spaces,
+      empty string -- back to bins of equal width.*/
+  void set_histo_edges(const G4String &edges);
+
+  /** Fill the detectors' histograms at hit time(enabled by default).*/
+  void set_histogramming(const G4bool enable);
+
+  /** Save every energy value to the raw files(disabled by default).*/
+  void set_raw_capture(const G4bool enable);
+
+  /** Set format of the detectors' raw energy files.
+      \param "text", "double" or "float", see DetectorSD2::set_raw_format().
+   */
+  void set_raw_format(const G4String &format);
+
+  /** Set importances of the layers of the polybox wall, see ImportanceProcess.
+      \param importances from the outer layer to the inner one separated
+      by spaces, empty string -- no splitting and roulette(default).*/
+  void set_importance_layers(const G4String &values);
+
+  /** Set importances of the layers: RATIO, RATIO^2, ... RATIO^N.
+      \param "N RATIO": quantity of layers and the ratio.*/
+  void set_importance_geometric(const G4String &values);
+
+  /** Make the map of weight windows by the next runs(pilot runs),
+      see WeightWindowGenerator.
+      \param file name of the map, empty string -- no map(default).*/
+  void set_ww_generate(const G4String &file_name)
+  {
+    WeightWindowGenerator::set_output(file_name);
+  }
+
+  /** Apply the weight windows from the map file, see WeightWindowProcess.
+      \param file name of the map, empty string -- no windows(default).*/
+  void set_ww_apply(const G4String &file_name);
+
+  /** Set the pilot run's mesh.
+      \param "NX NY NZ" boxes, optionally followed by the corners
+      "X1 Y1 Z1 X2 Y2 Z2" in cm(the world box by default).*/
+  void set_ww_mesh(const G4String &values);
+
+  /** Set the pilot run's energy bins(log scale).
+      \param "N EMIN EMAX", energies in keV.*/
+  void set_ww_energies(const G4String &values);
+
+  /** Set the detector which score the windows are made for.*/
+  void set_ww_target(const G4String &detector_name)
+  {
+    WeightWindowGenerator::set_target(detector_name);
   }
 
+  /** Set ratio of the upper bound of the generated windows to the lower one.*/
+  void set_ww_ratio(const G4double ratio);
+
+  /** Set production cut of a region, other regions keep the default one.
+      \param "REGION VALUE UNIT", e.g. "SHIELD 1 cm".*/
+  void set_region_cut(const G4String &values);
+
+  /** Limit steps of e-/e+ in a region, it limits the steps of
+      their multiple scattering too(G4StepLimiter of PhysicsList).
+      \param "REGION VALUE UNIT", value 0 -- no limit(default),
+      DETECTORS can't be limited, the histograms count steps there.*/
+  void set_region_step(const G4String &values);
+
+  /** Add a rule of StackingAction.
+      \param "PARTICLE EMAX UNIT REGION ACTION": tracks of the particle("*" -- any)
+      with kinetic energy below EMAX(0 -- any) born in the region("*" -- anywhere)
+      are classified by the ACTION: kill, waiting or urgent.*/
+  void set_stack_rule(const G4String &values);
+
+  /** Remove all rules of StackingAction.*/
+  void clear_stack_rules()
+  {
+    StackingAction::clear_rules();
+  }
+
+  /** Save raw energy files by the background thread or directly,
+      see DetectorSD2::set_async_writing().*/
+  void set_async_writing(const G4bool async)
+  {
+    DetectorSD2::set_async_writing(async);
+  }
+
+  /** Set number of batches waiting for the writer thread.*/
+  void set_writer_queue_size(const G4int size)
+  {
+    if(size > 0) DetectorSD2::set_writer_queue_size(size);
+  }
 
   /**Return value of energy units used.
      \return energy units used: case 0: eV, case 1: keV, case 2: MeV.
@@ -120,6 +243,18 @@ class DetectorConstruction : public G4VUserDetectorConstruction
   {
     return d_energy_units;
   }
+
+  /**Return value of energy units used, e.g. keV.*/
+  G4double hist_energy_unit_value()
+  {
+    switch(d_energy_units)
+      {
+      case 0:  return eV;
+      case 2:  return MeV;
+      default:
+	return keV;
+      }
+  }
   
 protected:
   /**
@@ -130,14 +265,44 @@ protected:
      
   */
   DetectorSD2 * new_detector_sensitive(const G4String name);
+
+  /** Pass histogram properties to the detectors made already.*/
+  void apply_histo();
   
 private:
 
   DetectorConstructionMessenger *messenger;
+
+  /** Logical volumes of the detectors, same order as vector_DetectorSD.*/
+  std::vector<G4LogicalVolume*> vector_detector_logical;
+
+  /** DetectorSD2 objects of a worker thread.*/
+  static G4ThreadLocal std::vector<DetectorSD2*> *thread_vector_DetectorSD;
   
   double d_hist_min, d_hist_max;
   unsigned d_hist_bins;
   unsigned  d_energy_units;
+  /** RAW_FORMAT_TEXT, RAW_FORMAT_DOUBLE or RAW_FORMAT_FLOAT*/
+  unsigned d_raw_format;
+  bool d_histogramming;
+  bool d_raw_capture;
+  bool d_hist_log;
+  std::vector<double> d_hist_edges;
+
+  /** Make a region of the volumes, apply the cut and the step limit
+      set for it before.*/
+  G4Region* make_region(const G4String &name, const std::vector<G4LogicalVolume*> &volumes);
+
+  /** Give the region it's own production cut.*/
+  void apply_region_cut(const G4String &name, const G4double cut);
+
+  /** production cuts and step limits by the regions' names,
+      the values are kept for the regions made later*/
+  std::map<G4String, G4double> region_cuts, region_steps;
+
+  /** step limits of the regions, shared by all threads;
+      workers only read them during a run*/
+  std::map<G4String, G4UserLimits*> region_limits;
 
 };
 
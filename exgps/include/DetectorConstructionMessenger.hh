@@ -37,11 +37,14 @@
 #include "G4UImessenger.hh"
 #include "G4UIcmdWithAnInteger.hh"
 #include "G4UIcmdWithADoubleAndUnit.hh"
+#include "G4UIcmdWithABool.hh"
+#include "G4UIcmdWithADouble.hh"
 class DetectorConstruction;
 class G4UIdirectory;
 class G4UIcmdWithAString;
 class G4UIcmdWithADoubleAndUnit;
 class G4UIcmdWithAnInteger;
+class G4UIcmdWithoutParameter;
 
 class DetectorConstructionMessenger: public G4UImessenger
 {
@@ -70,6 +73,63 @@ private:
 
   /** Set number of histogram max value.  */
   G4UIcmdWithADoubleAndUnit* cmd_histo_max;
+
+  /** Set format of the raw energy files: text, double or float.  */
+  G4UIcmdWithAString* cmd_raw_format;
+
+  /** Make histogram bins of equal width in log(E).  */
+  G4UIcmdWithABool* cmd_histo_log;
+
+  /** Set histogram bins by their edges.  */
+  G4UIcmdWithAString* cmd_histo_edges;
+
+  /** Enable or disable the histograms filled at hit time.  */
+  G4UIcmdWithABool* cmd_histogramming;
+
+  /** Enable or disable saving every energy value to the raw files.  */
+  G4UIcmdWithABool* cmd_raw_capture;
+
+  /** Enable or disable the raw files writer thread.  */
+  G4UIcmdWithABool* cmd_async_writer;
+
+  /** Set number of batches waiting for the writer thread.  */
+  G4UIcmdWithAnInteger* cmd_writer_queue;
+
+  /** Set importances of the layers of the polybox wall.  */
+  G4UIcmdWithAString* cmd_importance_layers;
+
+  /** Set importances of the layers growing by the same ratio.  */
+  G4UIcmdWithAString* cmd_importance_geometric;
+
+  /** Set the weight windows map made by the next runs.  */
+  G4UIcmdWithAString* cmd_ww_generate;
+
+  /** Load the weight windows map.  */
+  G4UIcmdWithAString* cmd_ww_apply;
+
+  /** Set boxes and corners of the weight windows mesh.  */
+  G4UIcmdWithAString* cmd_ww_mesh;
+
+  /** Set energy bins of the weight windows mesh.  */
+  G4UIcmdWithAString* cmd_ww_energies;
+
+  /** Set the detector which score the windows are made for.  */
+  G4UIcmdWithAString* cmd_ww_target;
+
+  /** Set ratio of the upper bound of the windows to the lower one.  */
+  G4UIcmdWithADouble* cmd_ww_ratio;
+
+  /** Set production cut of a region.  */
+  G4UIcmdWithAString* cmd_region_cut;
+
+  /** Limit steps of e-/e+ in a region.  */
+  G4UIcmdWithAString* cmd_region_step;
+
+  /** Add a rule of the stacking action.  */
+  G4UIcmdWithAString* cmd_stack_rule;
+
+  /** Remove all rules of the stacking action.  */
+  G4UIcmdWithoutParameter* cmd_stack_clear;
     
 
 };
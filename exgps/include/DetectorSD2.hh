@@ -9,16 +9,26 @@
 #ifndef DetectorSD2_h
 #define DetectorSD2_h 1
 #include "G4VSensitiveDetector.hh"
+#include "G4ParticleDefinition.hh"
+#include "Hist1i.h"
+#include "BranchDeposits.hh"
 #include <ios>
 #include <iostream>
 #include <fstream>
+#include <vector>
 #include <map>
-#include <utility>
 
 #define MAX_BATCH_SIZE 200000
 
+/** Formats of the raw energy files, see DetectorSD2::set_raw_format().*/
+#define RAW_FORMAT_TEXT   0
+#define RAW_FORMAT_DOUBLE 1
+#define RAW_FORMAT_FLOAT  2
+
 class G4Step;
 class RunAction;
+struct raw_write_job;
+class raw_writer;
 
 
 class DetectorSD2: public G4VSensitiveDetector 
@@ -26,6 +36,13 @@ class DetectorSD2: public G4VSensitiveDetector
   /**
      This sensitive detector class counts deposited particle's energy
      and it's initial kinetic enegy(without losses).
+     The energies are binned to the histograms of each particle species
+     (see set_histo()), the raw values are saved only
+     if enabled by set_raw_capture().
+     Histograms are filled with the particle's weights, they keep the
+     sums of squared weights once a weight other than 1 comes.
+     The sum of weights of the particles registered in each event
+     is a history score, see print_history_statistics().
    */
 public:
 
@@ -36,6 +53,10 @@ public:
    * May speedup the simulation.*/
   void DisableDepositedEnergyCount();
   void EnableDepositedEnergyCount();
+  G4bool IsDepositedEnergyCountEnabled() const
+  {
+    return d_deposited_count;
+  }
 
   void Initialize(G4HCofThisEvent*);
   G4bool ProcessHits(G4Step*, G4TouchableHistory*);
@@ -46,8 +67,10 @@ public:
   bool debug_output;
   
   /** Get known about particle type from given name
-      and add it's energy to certain histogram
-      \param Pointer to particle definition
+      and add it's energy to certain histogram.
+      Slow path: looks the particle up by name, prefer the
+      G4ParticleDefinition* overload for per-step scoring.
+      \param particle name
       \param energy value
       \param energy unit, case 0: eV, case 1: keV, case 2: MeV.
       
@@ -60,12 +83,15 @@ public:
       and add it's energy to certain histogram
       \param Pointer to particle definition
       \param Energy in keV units.
+      \param weight of the particle.
   */
-  void fill_hist(const G4ParticleDefinition *pdef, const double energy);
+  void fill_hist(const G4ParticleDefinition *pdef, const double energy,
+		 const double weight = 1.0);
 
   /** Get known about particle type from given name
       and add it's energy to certain histogram
-      \param Pointer to particle definition
+      Slow path: looks the particle up by name.
+      \param particle name
       \param energy value
       \param energy unit, case 0: eV, case 1: keV, case 2: MeV.
       
@@ -78,40 +104,257 @@ public:
       and add it's energy to certain histogram
       \param Pointer to particle definition
       \param Energy in keV units.
+      \param weight of the particle.
   */
-  void fill_hist_deposited(const G4ParticleDefinition *pdef, const double energy);
+  void fill_hist_deposited(const G4ParticleDefinition *pdef, const double energy,
+			   const double weight = 1.0);
   
   /** Make the detector save tracked kinetic energies of certain particles to the files.
-      \param iterator of map<G4String, std::vector<double>>
+      \param index of the particle species, see species_index().
       \param optional : whether clear vector after saving[YES, by default]
   */
-  void save_Ekinetic(std::map<G4String, std::vector<double> >::iterator &named_particle_iterator, bool noclear = false);
+  void save_Ekinetic(const size_t species, bool noclear = false);
 
   /** Make the detector save deposited  energies of certain particles to the files.
-      \param iterator of map<G4String, std::vector<double>>
+      \param index of the particle species, see species_index().
       \param optional : whether clear vector after saving[YES, by default]
   */
-  void save_Edeposited(std::map<G4String, std::vector <double> >::iterator &named_particle_iterator, bool noclear = false);
+  void save_Edeposited(const size_t species, bool noclear = false);
 
   /** Save all data vectors to files. Call this at the end of work.*/
   void save_all();
-private:
+
+  /** Set histogram properties, the values are in the detector's energy units.
+      Existing histograms are cleared.
+      \param minimum value of range.
+      \param maximum value of range.
+      \param quantity of bins.
+  */
+  void set_histo(const double min, const double max, const unsigned n_bins);
+
+  /** Make bins of equal width in log(E), set_histo()'s minimum must be positive.
+      Existing histograms are cleared.*/
+  void set_histo_log(const bool log);
+
+  /** Set bins by their edges(in the detector's energy units),
+      they override set_histo() and set_histo_log() settings.
+      Existing histograms are cleared.
+      \param ascending edges, empty vector -- back to set_histo()'s bins.*/
+  void set_histo_edges(const std::vector<double> &edges);
+
+  /** Set energy units of the histograms and raw values.
+      \param case 0: eV, case 1: keV, case 2: MeV.*/
+  void set_energy_units(const unsigned EUNIT);
+
+  /** Fill the histograms at hit time(enabled by default).*/
+  void set_histogramming(const bool enable)
+  {
+    d_histogramming = enable;
+  }
+  bool is_histogramming() const
+  {
+    return d_histogramming;
+  }
+
+  /** Keep every energy value and save them to the raw files
+      (disabled by default).*/
+  void set_raw_capture(const bool enable)
+  {
+    d_raw_capture = enable;
+  }
+  bool is_raw_capture() const
+  {
+    return d_raw_capture;
+  }
+
+  /** Copy all settings(histogram, raw files, deposited energy count)
+      of other detector, e.g. of the master's copy of this detector.*/
+  void copy_settings(const DetectorSD2 *other);
+
+  /** Register particle species, so it's histograms/files
+      are made even when no such particle hits the detector.
+      \param particle name.*/
+  void add_species(const G4String &pname)
+  {
+    species_index_by_name(pname);
+  }
+
+  /** Save histograms of all species to files like
+      DET.NAME_kinetic_e-_keV_unit_hist.dat, histograms are not cleared.*/
+  void save_histograms();
+
+  /** Set format of the raw energy files.
+      \param RAW_FORMAT_TEXT -- "%f" lines in *_unit.raw files(default),
+      RAW_FORMAT_DOUBLE or RAW_FORMAT_FLOAT -- packed values
+      with a header in *_unit.bin files, see raw_file.h.
+  */
+  void set_raw_format(const unsigned format);
+  unsigned get_raw_format() const
+  {
+    return d_raw_format;
+  }
+
+  /** Close all binary raw files opened by all detectors and write
+      the event counters to their headers. Call this after save_all().
+      \param number of events simulated in the run.
+  */
+  static void close_raw_files(const unsigned long long events);
+
+  /** Write raw files by the background thread(default), or directly by
+      the thread which fills the detector.
+      The setting is common for all detectors.*/
+  static void set_async_writing(const bool async);
+  static bool is_async_writing();
+
+  /** Set number of batches that may wait for the background thread,
+      the event loop waits when the queue is full.*/
+  static void set_writer_queue_size(const unsigned size);
+
+  /** Wait until the background thread writes all batches and stop it.
+      close_raw_files() calls this too.*/
+  static void drain_writer();
+
+  /** \return seconds that the event loop(all threads together) has
+      spent saving the raw data.
+      \param whether to reset the counter.*/
+  static double get_flush_stall_time(const bool reset = false);
+
+  /** Weighted scoring(variance reduction is on): deposited energy is
+      summed per particle which entered the detector(with all of it's
+      secondaries) instead of per event, because the split copies of a
+      particle are alternatives of each other. Raw files keep no weights.
+      The setting is common for all detectors, the master sets it
+      at the beginning of run.*/
+  static void set_weighted_scoring(const bool weighted);
+  static bool is_weighted_scoring();
+
+  /** Clear the history scores, the master does it at the beginning of run.*/
+  void reset_history_statistics();
+
+  /** Print the number of histories, mean score per history, it's
+      relative error R and the figure of merit 1/(R^2*T).
+      \param T -- time of the run in seconds.*/
+  void print_history_statistics(const double seconds) const;
+
+  /** Move the data collected by other detector(e.g. a worker thread's copy
+      of this detector) into this one, the other's vectors get cleared.
+      Safe to be called from several threads at once.
+      \param pointer to other DetectorSD2 object.
+  */
+  void merge(DetectorSD2 *other);
+
+  /** Return index of the particle species in this detector's buffers,
+      a new species is added when the particle meets first time.
+      Looked up by G4ParticleDefinition::GetParticleDefinitionID(),
+      a dense index of all particles, no strings or lists searched.
+      \param Pointer to particle definition.
+  */
+  inline size_t species_index(const G4ParticleDefinition *pdef);
   
+private:
+
+  /** Per-species buffers, the name is only used for output files.
+      The histograms are made on the first fill.*/
+  struct species_buffers
+  {
+    const G4ParticleDefinition *definition;
+    G4String name;
+    std::vector<double> Ekin;
+    std::vector<double> Edep;
+    Hist1i *Ekin_hist;
+    Hist1i *Edep_hist;
+  };
+
+  /** Store the energy value(in detector's units) to the
+      histogram and to the raw buffer, if they're enabled.
+      \param index of the particle species.
+      \param true -- deposited energy, false -- kinetic.
+      \param energy value.*/
+  inline void store_value(const size_t species, const bool deposited,
+			  const double value, const double weight = 1.0);
+
+  /** Make a histogram with the detector's properties.*/
+  Hist1i *new_histogram() const;
+
+  /** Set the detector's bins to the histogram, counts are cleared.*/
+  void configure_histogram(Hist1i *hist) const;
+
+  /** configure_histogram() for all existing histograms.*/
+  void configure_histograms();
+
+  /** Add counts of other detector's histogram to own one
+      and clear the other's histogram, it's kept if the bins differ.*/
+  void merge_histogram(Hist1i *&to, Hist1i *from) const;
+
+  /** Add a new species to the buffers.
+      \return index of the species.*/
+  size_t add_species(const G4ParticleDefinition *pdef, const G4String &pname);
+
+  /** Find species by the definition(slow) and index it by the ID,
+      add it if not found.
+      \return index of the species.*/
+  size_t find_species(const G4ParticleDefinition *pdef);
+
+  /** Find species by name(slow), add it if not found.
+      \return index of the species.*/
+  size_t species_index_by_name(const G4String &pname);
+
+  /** Make output file name without extension like: DET.NAME_kinetic_e-_keV_unit
+      \param "kinetic" or "deposited"
+      \param index of the particle species.
+  */
+  G4String output_basename(const char *kind, const size_t species) const;
+
+  /** Make output file name like: DET.NAME_kinetic_e-_keV_unit.raw
+      or DET.NAME_kinetic_e-_keV_unit.bin for the binary formats.
+      \param "kinetic" or "deposited"
+      \param index of the particle species.
+  */
+  G4String output_filename(const char *kind, const size_t species) const;
+
+  /** Write the data to the raw file in the current format.
+      \param "kinetic" or "deposited"
+      \param index of the particle species.
+      \param the data.
+  */
+  void save_vector(const char *kind, const size_t species,
+		   std::vector<double> &vector, bool noclear) const;
+
+  /** Write one batch to it's file, may be called by the writer thread.*/
+  static void write_raw_job(raw_write_job &job);
+
+  /** The background writer thread common for all detectors.*/
+  static raw_writer &writer();
+
+  /** Append the data to the binary file, it stays open
+      until close_raw_files() is called.*/
+  static void dump_binary(raw_write_job &job);
+
   /** clear the vectors with raw spectra.*/
   void clear_raw_data();
   
   /** Dump the data from vector to file.*/
-  void dump_vector(const char *filename,
-		   std::vector<double> &vector,
-		   bool append = true ) const;
+  static void dump_vector(const char *filename,
+			  const std::vector<double> &vector,
+			  bool append = true );
 private:
   bool d_deposited_count;
+  bool d_histogramming;
+  bool d_raw_capture;
+  unsigned d_raw_format;
+  double d_hist_min, d_hist_max;
+  unsigned d_hist_bins;
+  bool d_hist_log;
+  std::vector<double> d_hist_edges;
   unsigned  d_energy_units;
-  
-  std::map<G4String, std::vector <double> > named_vector_map_Ekin;
-  std::map<G4String, std::vector <double> > named_vector_map_Edep;
-  std::map<G4String, std::vector <double> >::iterator the_iterator;
-  
+  /** energy values are divided by this before they're stored: eV, keV or MeV*/
+  double d_energy_unit_value;
+
+  /** Buffers of all particle species that have hit the detector.*/
+  std::vector<species_buffers> d_species;
+
+  /** species index by the particle definition ID, -1 -- not met yet*/
+  std::vector<int> d_species_by_id;
   
 private:
   unsigned long temp_count;
@@ -121,10 +364,60 @@ private:
       processed track via 'G4Step* step->GetTrack()' method*/
   G4Track *track;
   
-  /** Name of the currenlty processed track's particle,
+  /** Definition of the currenlty processed track's particle,
       like "gamma","neutron" ... etc.*/
-  G4String particle_name;
+  const G4ParticleDefinition *particle_definition;
   G4double detEnergy;
+
+  /** deposits of the current event per split copy which entered
+      the detector, weighted scoring(importances or weight windows) only*/
+  BranchDeposits branch_deposits;
+
+  /** sum of weights of the kinetic energy records of the current event*/
+  double d_event_score;
+  /** histories, sum of their scores and of squared scores*/
+  unsigned long long d_histories;
+  double d_score_sum, d_score_sum2;
 };
 
+inline size_t DetectorSD2::species_index(const G4ParticleDefinition *pdef)
+{
+  if(pdef != NULL)
+    {
+      const G4int id = pdef->GetParticleDefinitionID();
+      if(id >= 0 && (size_t)id < d_species_by_id.size() && d_species_by_id[id] >= 0)
+	return d_species_by_id[id];
+    }
+  return find_species(pdef);
+}
+
+inline void DetectorSD2::store_value(const size_t species, const bool deposited,
+				     const double value, const double weight)
+{
+  species_buffers &buffers = d_species[species];
+  if(!deposited)
+    d_event_score += weight;
+  if(d_histogramming)
+    {
+      Hist1i *&hist = (deposited)? buffers.Edep_hist : buffers.Ekin_hist;
+      if(hist == NULL)
+	hist = new_histogram();
+      if(weight != 1.0 && !hist->has_sumw2())
+	hist->sumw2();
+      hist->fill(value, weight);
+    }
+  if(d_raw_capture)
+    {
+      std::vector<double> &values = (deposited)? buffers.Edep : buffers.Ekin;
+      values.push_back(value);
+      if(values.size() > MAX_BATCH_SIZE)
+	{
+	  if(deposited)
+	    save_Edeposited(species);
+	  else
+	    save_Ekinetic(species);
+	}
+    }
+}
+
 #endif
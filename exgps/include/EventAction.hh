@@ -29,6 +29,7 @@
 #include "G4UserEventAction.hh"
 
 class G4Event;
+class WeightWindowGenerator;
 
 
 class EventAction : public G4UserEventAction
@@ -38,6 +39,10 @@ class EventAction : public G4UserEventAction
    ~EventAction();
 
   long long count;
+
+  /** weight windows generator of the thread, it forgets the tracks
+      of the previous event, NULL -- none(default)*/
+  WeightWindowGenerator *ww_generator;
   
   public:
     void BeginOfEventAction(const G4Event*);
@@ -10,16 +10,53 @@
 #define Hist1i_H 1
 
 #include <string>
+#include <vector>
+#include <cmath>
 
 class Hist1i
 {
+  /**
+     Histogram with weighted entries(plain fill(x) has weight 1),
+     bin contents are doubles, so counts are exact up to 2^53.
+     Bins may be uniform(default), uniform in log(x) -- see set_log(),
+     or given by their edges -- see set_edges().
+     Values below min or above max go to underflow or overflow,
+     x == max belongs to the last bin.
+     Mean and rms of the entries in [min, max] are kept on fill,
+     so statistics() doesn't scan the bins.
+   */
   public:
     Hist1i(double, double, int);
+    /** Histogram with the given bin edges, see set_edges().*/
+    Hist1i(const std::vector<double> &bin_edges);
     ~Hist1i();
+
+    enum binning { linear, logarithmic, variable };
     
     void fill(double);
+    /** Add an entry with weight.
+	\param value
+	\param weight of the entry.*/
+    inline void fill(double x, double w);
+
+    /** Save bins with non-zero content to fname.dat: "center content",
+	or "center content error" if sumw2() is enabled.
+	The banner, quantity of entries, underflow and overflow,
+	mean and rms are saved to fname.stat.
+     */
     void save(std::string, std::string);
+
+    /** Mean and rms of the entries in [min, max],
+	they're computed from the filled values, not from the bins.*/
     void statistics(double& mean, double& rms);
+
+    /** Keep sum of squared weights of each bin for error bars.
+	Must be enabled before filling, fill(x) keeps it too.*/
+    void sumw2(const bool enable = true);
+    bool has_sumw2() const
+    {
+      return track_w2;
+    }
     
     /** Set histogram properties.
 	\param minimum value
@@ -27,15 +64,170 @@ class Hist1i
 	\param quantity of bins.
      */
     void set(const double a_min, const double a_max, const int a_bins);
+
+    /** Set bins of equal width in log(x), counts are cleared.
+	\param minimum value, must be positive.
+	\param maximum value
+	\param quantity of bins.
+	\return false if the range is not positive, histogram is unchanged then.
+     */
+    bool set_log(const double a_min, const double a_max, const int a_bins);
+
+    /** Set bins by their edges, counts are cleared.
+	\param ascending edges, bin i is [edge[i], edge[i+1]).
+	\return false if less than 2 edges or they're not ascending,
+	histogram is unchanged then.
+     */
+    bool set_edges(const std::vector<double> &bin_edges);
+
+    binning get_binning() const
+    {
+      return mode;
+    }
     
     void clear();
+
+    /** Add counts of other histogram to this one.
+	\param histogram with the same range and quantity of bins.
+	\return false if the histograms differ.
+     */
+    bool add(const Hist1i &other);
+
+    /** Add other histogram multiplied by factor to this one.
+	\return false if the histograms differ.
+     */
+    bool add(const Hist1i &other, const double factor);
+
+    /** Sum of weights in bin i.*/
+    double bin_content(const int i) const
+    {
+      return hist[i];
+    }
+    /** Statistical error of bin i: sqrt(sum of w^2),
+	sqrt(content) if sumw2() is disabled.*/
+    double bin_error(const int i) const;
+
+    double underflow() const
+    {
+      return under;
+    }
+    double overflow() const
+    {
+      return over;
+    }
+    /** Number of fill() calls with values in [min, max].*/
+    unsigned long long entries() const
+    {
+      return n_entries;
+    }
+    /** Sum of weights in [min, max].*/
+    double sum_of_weights() const
+    {
+      return sum_w;
+    }
+    int bins() const
+    {
+      return nbins;
+    }
     
   private:
-    inline double bin(int);
+    /** \return index of the bin with value x from [min, max].*/
+    inline int find_bin(double x) const;
+    /** Allocate and clear the bins array.*/
+    void allocate();
+    /** Build the lookup table of variable bins.*/
+    void make_lookup();
+
+    double bin(int);
     double min, max, h;
     int nbins;
-    int* hist;
+    /** sums of weights*/
+    std::vector<double> hist;
+    /** sums of squared weights, empty if sumw2() is disabled*/
+    std::vector<double> hist_w2;
+    bool track_w2;
+    double under, over;
+    double under_w2, over_w2;
+
+    /** running moments of the entries in [min, max]*/
+    unsigned long long n_entries;
+    double sum_w, sum_wx, sum_wx2;
+
+    binning mode;
+    /** 1/h of linear bins or 1/(width in log(x)) of logarithmic bins*/
+    double inv_h;
+    double log_min;
+
+    /** Edges of variable bins, nbins+1 values.*/
+    std::vector<double> edges;
+    /** Variable bins lookup: [min, max] is divided into uniform cells,
+	lookup[c] is the bin which contains the lower bound of cell c,
+	so the bin of x is searched among lookup[c]..lookup[c+1] only.*/
+    std::vector<int> lookup;
+    double inv_cell;
 };
 
+inline int Hist1i::find_bin(double x) const
+{
+  int i;
+  switch(mode)
+    {
+    case logarithmic:
+      i = int((std::log(x) - log_min)*inv_h);
+      break;
+    case variable:
+      {
+	int cell = int((x - min)*inv_cell);
+	if(cell >= int(lookup.size()) - 1) cell = lookup.size() - 2;
+	//branch-free binary search of the last edge <= x:
+	const double *base = &edges[lookup[cell]];
+	int n = lookup[cell + 1] - lookup[cell] + 1;
+	while(n > 1)
+	  {
+	    const int half = n/2;
+	    base = (base[half] <= x)? base + half : base;
+	    n -= half;
+	  }
+	i = base - &edges[0];
+	//(x - min)*inv_cell may round across an edge near the cell bound:
+	if(x < edges[i] && i > 0) i--;
+	else if(i + 1 < nbins && edges[i + 1] <= x) i++;
+	break;
+      }
+    default:
+      i = int((x - min)/h);
+      break;
+    }
+  //rounding may put x==max out of the last bin:
+  if(i >= nbins) i = nbins - 1;
+  if(i < 0) i = 0;
+  return i;
+}
+
+inline void Hist1i::fill(double x, double w)
+{
+  if (x < min)
+    {
+      under += w;
+      under_w2 += w*w;
+      return;
+    }
+  if (x > max)
+    {
+      over += w;
+      over_w2 += w*w;
+      return;
+    }
+  if (x != x) return;//NaN
+
+  const int i = find_bin(x);
+  hist[i] += w;
+  if (track_w2) hist_w2[i] += w*w;
+  n_entries++;
+  sum_w += w;
+  sum_wx += w*x;
+  sum_wx2 += w*x*x;
+}
+
 #endif
 
@@ -0,0 +1,84 @@
+/* ========================================================== */
+// Part of simulation for use with GEANT4 code.
+// Importance splitting and russian roulette in the layers of the shield.
+//
+// Taras Schevchenko National University of Kyiv, 2012.
+/* ========================================================== */
+
+#ifndef ImportanceProcess_h
+#define ImportanceProcess_h 1
+
+#include "SplitRoulette.hh"
+#include "G4ThreeVector.hh"
+#include "globals.hh"
+#include <vector>
+
+class ImportanceProcess : public SplitRoulette
+{
+  /**
+     Importance cells are nested shells of the box with a hole
+     (see make_box_with_hole()): the wall between the outer surface and
+     the hole is divided into layers of equal thickness along each axis.
+     Cell 0 is everything outside of the box(importance 1),
+     cells 1..N are the layers from outside inwards,
+     cell N+1 is the hole, it has the importance of the innermost layer.
+
+     When a step takes a particle from a cell of importance I1 into
+     a cell of importance I2, it's split into n copies of weight w/n
+     if I2 > I1(n is I2/I1 rounded up or down at random, so that
+     it's I2/I1 on average), or it survives
+     the russian roulette with probability I2/I1 and gets weight w*I1/I2
+     (SplitRoulette with the window of zero width at w*I1/I2).
+     The cells are not volumes, so the step is not limited on their
+     boundaries: the particle is split where it's step ends.
+   */
+public:
+  ImportanceProcess();
+  ~ImportanceProcess();
+
+  /** Set the box of the cells, DetectorConstruction calls it.
+      \param center of the box.
+      \param half sizes of the box.
+      \param half sizes of the hole.
+  */
+  static void set_box(const G4ThreeVector &center, const G4ThreeVector &outer,
+		      const G4ThreeVector &hole);
+
+  /** Set importances of the layers.
+      \param importances from the outer layer to the inner one,
+      empty vector disables the splitting.
+      \return false if an importance is not positive, nothing is changed then.
+  */
+  static bool set_importances(const std::vector<double> &layers);
+
+  /** \return importances of the layers, outer one first.*/
+  static const std::vector<double>& get_importances()
+  {
+    return importances;
+  }
+
+  static bool is_enabled()
+  {
+    return !importances.empty() && box_is_set;
+  }
+
+  /** \return index of the cell with this point.*/
+  static size_t cell(const G4ThreeVector &position);
+
+  /** \return importance of the cell.*/
+  static double importance(const size_t cell);
+
+protected:
+  bool is_active() const
+  {
+    return is_enabled();
+  }
+  void bias(const G4Track &track, const G4Step &step);
+
+private:
+  static std::vector<double> importances;
+  static G4ThreeVector box_center, box_outer, box_hole;
+  static bool box_is_set;
+};
+
+#endif
@@ -11,6 +11,7 @@
 
 #include "G4VUserPhysicsList.hh"
 #include "globals.hh"
+#include "PhysicsTableCache.hh"
 
 class PhysicsList: public G4VUserPhysicsList
 {
@@ -18,6 +19,13 @@ class PhysicsList: public G4VUserPhysicsList
     PhysicsList();
    ~PhysicsList();
 
+    /** Store the physics tables to the cache if they were built,
+        called by the master at the beginning of each run.*/
+    void update_table_cache()
+    {
+      table_cache.update(this);
+    }
+
   protected:
     // Construct particle and physics
     void ConstructParticle();
@@ -26,6 +34,11 @@ class PhysicsList: public G4VUserPhysicsList
 
     // these methods Construct physics processes and register them
     void ConstructEM();
+    void ConstructImportance();
+
+  private:
+    /** tables are retrieved from it instead of being built, if possible*/
+    PhysicsTableCache table_cache;
 };
 
 #endif
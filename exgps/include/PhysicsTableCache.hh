@@ -0,0 +1,102 @@
+/* ========================================================== */
+// Part of simulation for use with GEANT4 code.
+// Cache of the physics tables between runs of the program.
+//
+// Taras Schevchenko National University of Kyiv, 2012.
+/* ========================================================== */
+
+#ifndef PhysicsTableCache_h
+#define PhysicsTableCache_h 1
+
+#include "globals.hh"
+
+class G4VUserPhysicsList;
+
+/** Environment variable with the cache directory, the cache is
+    off if it's not set, empty or "off".*/
+#define PHYSICS_CACHE_ENV "PHYSICS_CACHE"
+
+/** File with the full key inside of each cache entry.*/
+#define PHYSICS_CACHE_KEY_FILE "exgps_cache_key.txt"
+
+/** File with the models of the processes the entry's tables are built by.*/
+#define PHYSICS_CACHE_MODELS_FILE "exgps_cache_models.txt"
+
+/** Increment it when the key or the layout of entries changes.*/
+#define PHYSICS_CACHE_VERSION 3
+
+/** G4EmParameters and it's operator<< are needed for the key.*/
+#define PHYSICS_CACHE_MIN_G4VERSION 1020
+
+class PhysicsTableCache
+{
+  /**
+     Physics tables stored by G4VUserPhysicsList::StorePhysicsTable()
+     in PHYSICS_CACHE/<hash of the key>/ and retrieved by the later runs.
+     The key is a text made of the Geant4 version, the materials,
+     production cuts of all regions, the EM parameters(G4EmParameters)
+     and processes of all particles;
+     an entry is used only if the key stored in it is the same
+     character for character. An entry is written to a temporary
+     directory and renamed when complete, so concurrent jobs
+     never see a half-written one.
+
+     The EM processes get their default models when the tables are
+     built, after the entry is chosen, so the models and their energy
+     limits(make_models()) are the second part of the key, checked
+     by update(): an entry made by other models is removed and the run
+     is aborted.
+     update() also makes the key again, a change of it after SetCuts()
+     (e.g. /construction/region_cut after /run/initialize) is reported.
+     Geant4 older than 10.2 has no G4EmParameters, the cache is off there.
+   */
+public:
+  PhysicsTableCache();
+
+  /** Called from SetCuts() of the master: if there is an entry for the
+      current key, the physics list is told to retrieve tables from it.*/
+  void prepare(G4VUserPhysicsList *physics);
+
+  /** Called at the beginning of run of the master, after the tables are
+      built: reports whether they were retrieved, stores them otherwise.*/
+  void update(G4VUserPhysicsList *physics);
+
+  G4bool is_enabled() const
+  {
+    return !root.empty();
+  }
+
+  /** \return the key of the current materials, cuts and processes.*/
+  static G4String make_key();
+
+  /** \return names and energy limits of the models of each EM process,
+      complete once the tables are built.*/
+  static G4String make_models();
+
+private:
+  /** \return directory of the key's entry.*/
+  G4String entry_directory(const G4String &key) const;
+
+  /** \return true if the entry has got the same key.*/
+  G4bool is_valid_entry(const G4String &dir, const G4String &key) const;
+
+  /** \return the models file of the entry, empty if there is none.*/
+  G4String read_models(const G4String &dir) const;
+
+  /** Store the tables to the entry of the key.*/
+  G4bool store(G4VUserPhysicsList *physics, const G4String &key,
+	       const G4String &models);
+
+  G4String root;
+
+  /** key made by prepare(), the entry is looked up by it*/
+  G4String prepared_key;
+
+  /** key of the entry set to be retrieved by prepare(), empty if none*/
+  G4String retrieve_key;
+
+  /** key of the tables which are stored or retrieved already*/
+  G4String done_key;
+};
+
+#endif
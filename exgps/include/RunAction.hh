@@ -31,11 +31,14 @@
 #define RunAction_h 1
 
 class Hist1i;
+class WeightWindowGenerator;
+class PhysicsList;
 
 #include "G4UserRunAction.hh"
 #include "globals.hh"
 #include "DetectorSD2.hh"
 #include <vector>
+#include <chrono>
 
 class G4Run;
 
@@ -68,6 +71,25 @@ public:
 
    */
   std::vector<DetectorSD2*> *DSD_vector;
+
+  /** Vector of pointers to the master's DetectorSD2 objects.
+      Set only for the worker threads in multithreaded mode:
+      at the end of run a worker merges data of it's own detectors
+      (DSD_vector) into these ones, then the master saves them.
+      NULL by default.
+   */
+  std::vector<DetectorSD2*> *master_DSD_vector;
+
+  /** Weight windows generator of the thread, it's deleted with the action.
+      At the end of run it's counts are merged into the master ones,
+      the master writes the map. NULL by default(the master's action).
+   */
+  WeightWindowGenerator *ww_generator;
+
+  /** Physics list, the master stores it's tables to the cache at
+      the beginning of run. NULL by default(the workers' actions).
+   */
+  PhysicsList *physics_list;
   
   /** 
       Method RunAction::EndOfRunAction(G4Run*)
@@ -76,6 +98,7 @@ public:
       and call 
       DetectorSD::reset_histo() which will make all 
       DetectorSD objects ready to start capturing events.;
+      Worker threads copy the settings of master_DSD_vector first.
   */
   void BeginOfRunAction(const G4Run*);
 
@@ -86,9 +109,14 @@ public:
       and call 
       DetectorSD::save_histo() which will write all 
       histograms created by DetectorSD objects to files.;
+      Worker threads merge their data into master_DSD_vector instead.
   */
   void EndOfRunAction(const G4Run*);
 
+private:
+  /** start of the master's run, for the figure of merit*/
+  std::chrono::steady_clock::time_point run_start;
+
   
   
 };
@@ -0,0 +1,100 @@
+/* ========================================================== */
+// Part of simulation for use with GEANT4 code.
+// Splitting and russian roulette of a track, common for
+// ImportanceProcess and WeightWindowProcess.
+//
+// Taras Schevchenko National University of Kyiv, 2012.
+/* ========================================================== */
+
+#ifndef SplitRoulette_h
+#define SplitRoulette_h 1
+
+#include "G4VProcess.hh"
+#include "G4ParticleChange.hh"
+#include "globals.hh"
+
+class G4Track;
+class G4Step;
+
+class SplitRoulette : public G4VProcess
+{
+  /**
+     Base of the processes which change the weights of the tracks.
+     It's invoked after every step while is_active() and never limits
+     the step; the derived class chooses a window for the step in bias()
+     and calls apply(), which brings the weight of the track into it:
+     a lighter track plays the russian roulette, it survives with
+     probability weight/target and gets the weight target;
+     a heavier one is split into weight/target copies(rounded randomly,
+     so that their mean number is exact), at most max_split.
+     The track itself is one of the copies, the others are secondaries
+     made by this process. Both keep the expected weight, so the scores
+     are not biased.
+
+     The settings of the derived processes are statics shared by all
+     threads, only the messenger changes them, when no run is going.
+     One of them may be enabled at a time, see check_exclusive().
+   */
+public:
+  SplitRoulette(const G4String &name);
+  virtual ~SplitRoulette();
+
+  G4double PostStepGetPhysicalInteractionLength(const G4Track &track,
+						G4double previous_step,
+						G4ForceCondition *condition);
+
+  G4VParticleChange* PostStepDoIt(const G4Track &track, const G4Step &step);
+
+  G4double AlongStepGetPhysicalInteractionLength(const G4Track&, G4double, G4double,
+						 G4double&, G4GPILSelection*)
+  {
+    return -1.0;
+  }
+  G4double AtRestGetPhysicalInteractionLength(const G4Track&, G4ForceCondition*)
+  {
+    return -1.0;
+  }
+  G4VParticleChange* AtRestDoIt(const G4Track&, const G4Step&)
+  {
+    return NULL;
+  }
+  G4VParticleChange* AlongStepDoIt(const G4Track&, const G4Step&)
+  {
+    return NULL;
+  }
+
+  /** \return true if the track is a copy made by splitting.*/
+  static bool is_copy(const G4Track &track);
+
+  /** Importances and weight windows must not be applied together:
+      each one expects the weights to be changed by itself only.
+      \param enabling -- what is going to be enabled, for the message.
+      \param other_enabled -- the other process is enabled.
+      \return false if the other one is enabled, G4Exception is raised then.
+  */
+  static bool check_exclusive(const G4String &enabling, const bool other_enabled);
+
+  /** copies made of one particle at most, a window much lower than
+      the particle's weight should not fill the memory*/
+  static const int max_split = 100;
+
+protected:
+  /** \return false if the process does nothing now.*/
+  virtual bool is_active() const = 0;
+
+  /** Change the weight of the alive track after the step.*/
+  virtual void bias(const G4Track &track, const G4Step &step) = 0;
+
+  /** \param track -- the track.
+      \param lower -- lower bound of the window.
+      \param upper -- upper bound of the window.
+      \param target -- weight of the survivors and of the copies.
+  */
+  void apply(const G4Track &track, const double lower, const double upper,
+	     const double target);
+
+private:
+  G4ParticleChange particle_change;
+};
+
+#endif
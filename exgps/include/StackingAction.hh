@@ -43,31 +43,100 @@
 
 #include "G4UserStackingAction.hh"
 #include "globals.hh"
+#include <map>
+#include <vector>
+#include <iostream>
 
-class HistoManager;
 class G4Track;
+class G4ParticleDefinition;
+class G4Region;
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
 class StackingAction : public G4UserStackingAction
 {
+  /**
+     Secondaries are classified by the table of rules: a rule matches
+     the particle, the kinetic energy below the threshold and the region
+     where the track is born, the first matching rule gives fKill,
+     fWaiting or fUrgent. Tracks matching no rule, primaries and copies
+     made by ImportanceProcess or WeightWindowProcess are urgent.
+     All threads share one table, stack_rule and stack_clear edit it
+     while no run is going; each thread resolves the names to
+     the particle and region pointers once after a change.
+   */
 public:
 
   StackingAction();
   virtual ~StackingAction();
    
   void SetKillStatus(G4bool value)    {killSecondary = value;};
-  void SetKill(const G4String& name)  {pname = name;};
+
+  /** Kill all secondaries of this particle, same as the rule
+      "NAME 0 keV * kill".*/
+  void SetKill(const G4String& name);
      
   G4ClassificationOfNewTrack ClassifyNewTrack(const G4Track*);
+
+  /** Add a rule to the end of the table.
+      \param name of the particle, "*" -- any.
+      \param threshold: the rule matches tracks with lower kinetic energy,
+      0 -- any energy.
+      \param region where the track is born, "*" -- anywhere.
+      \param classification given to the matching tracks.
+      \return false if there is no such particle, the rule is not added then.
+  */
+  static bool add_rule(const G4String &particle, const G4double threshold,
+		       const G4String &region, const G4ClassificationOfNewTrack classification);
+
+  /** Remove all rules.*/
+  static void clear_rules();
+
+  /** Print the table of rules.*/
+  static void print_rules(std::ostream &stream);
     
 private:
 
-  HistoManager*       histoManager;    
-  
-  G4String            pname;
+  /** A rule as it's set by the user.*/
+  struct rule
+  {
+    G4String particle, region;
+    G4double threshold;
+    G4ClassificationOfNewTrack classification;
+  };
+
+  /** A rule of this thread with the names resolved.*/
+  struct resolved_rule
+  {
+    /** NULL -- any region*/
+    const G4Region *region;
+    G4double threshold;
+    G4ClassificationOfNewTrack classification;
+  };
+
+  /** Build particle_rules from the table.*/
+  void resolve_rules();
+
   G4bool              killSecondary;
 
+  /** the rules by the particle definitions, each list has the rules of
+      the particle and the rules of any particle in the table's order*/
+  std::map<const G4ParticleDefinition*, std::vector<resolved_rule> > particle_rules;
+
+  /** rules of any particle for the particles without rules of their own*/
+  std::vector<resolved_rule> any_particle_rules;
+
+  /** rules_version at the moment of the last resolve_rules() call*/
+  unsigned resolved_version;
+
+  /** The last looked up particle and it's rules,
+      secondaries of the same kind often come in a row.*/
+  const G4ParticleDefinition *last_particle;
+  const std::vector<resolved_rule> *last_rules;
+
+  static std::vector<rule> rules;
+  /** changed by every change of the table*/
+  static unsigned rules_version;
 };
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -41,12 +41,15 @@
 
 #include "G4UserSteppingAction.hh"
 #include "DetectorSD2.hh"
+#include "WeightWindowGenerator.hh"
 #include "G4Event.hh"
 #include "G4EventManager.hh"
 #include "G4ios.hh"
 #include "globals.hh"
+#include <vector>
 
 class G4Step;
+class G4VSensitiveDetector;
 
 
 class SteppingAction : public G4UserSteppingAction
@@ -63,6 +66,14 @@ public:
       to make histograms from DUMB detector data.
   */
   void SetDetectorSD(std::vector <DetectorSD2*> *vector);
+
+  /** Pass every step and the target's scores to the pilot run's generator.
+      \param generator of the thread, NULL -- none(default).
+  */
+  void set_weight_window_generator(WeightWindowGenerator *generator)
+  {
+    ww_generator = generator;
+  }
   
 private:
   /** Vector of pointers to DetectorSD objects.
@@ -82,5 +93,30 @@ private:
   */
   std::vector <DetectorSD2*> *DSD_vector;
 
+  /** DetectorSD2 object of the step point's sensitive detector:
+      every DetectorSD2 of the thread is in DSD_vector, so one type
+      check is enough, no strings or lists searched.
+      \return NULL if the sensitive detector is not a DetectorSD2.
+   */
+  inline DetectorSD2 *find_detector(G4VSensitiveDetector *sens_detector);
+
+  /** The last looked up sensitive detector and it's DetectorSD2,
+      a track usually makes several steps in the same volume.*/
+  const G4VSensitiveDetector *last_sensitive;
+  DetectorSD2 *last_detector;
+
+  /** weight windows generator of the thread, owned by RunAction*/
+  WeightWindowGenerator *ww_generator;
+
 };
+
+inline DetectorSD2 *SteppingAction::find_detector(G4VSensitiveDetector *sens_detector)
+{
+  if(sens_detector != last_sensitive)
+    {
+      last_sensitive = sens_detector;
+      last_detector = dynamic_cast<DetectorSD2*>(sens_detector);
+    }
+  return last_detector;
+}
 #endif
@@ -0,0 +1,147 @@
+/* ========================================================== */
+// Part of simulation for use with GEANT4 code.
+// Weight windows generator: importances of the mesh bins from a pilot run.
+//
+// Taras Schevchenko National University of Kyiv, 2012.
+/* ========================================================== */
+
+#ifndef WeightWindowGenerator_h
+#define WeightWindowGenerator_h 1
+
+#include "WeightWindowMesh.hh"
+#include "globals.hh"
+#include <map>
+#include <vector>
+
+class G4Step;
+class G4Track;
+class DetectorSD2;
+
+/** Detector which score the windows are made for if no other one is chosen.*/
+#define WW_DEFAULT_TARGET "DET.INSIDE"
+
+class WeightWindowGenerator
+{
+  /**
+     Pilot run: each thread has one generator, which counts the weight
+     of particles entering each bin of the mesh(a box and an energy bin,
+     also the bin where a particle is born) and the score these particles
+     and their secondaries make later in the target detector.
+     The importance of a bin is (score)/(entered weight), the master adds
+     the counts of all threads and writes the map of the windows:
+     lower bound of a bin is 2/(1+R) * I0/I, where I0 is the score per
+     history, so a source particle of weight 1 is in the middle of
+     the window where I = I0. Bins never entered or never contributing
+     get no window(0).
+
+     The map is read by WeightWindowProcess in production runs,
+     one pilot run may be used by many jobs. The mesh, the target and
+     the ratio are statics of all threads, the /construction/ ww_*
+     commands set them before the pilot run.
+   */
+public:
+  WeightWindowGenerator();
+  ~WeightWindowGenerator();
+
+  /** Find the target among the thread's detectors and prepare the counts.*/
+  void begin_run(const std::vector<DetectorSD2*> *detectors);
+
+  /** Forget tracks of the previous event.*/
+  void begin_event();
+
+  /** Count the particle if it entered another bin during the step.*/
+  void step(const G4Step *step);
+
+  /** \return true if the detector is the target one.*/
+  bool is_target(const DetectorSD2 *detector) const
+  {
+    return detector == target;
+  }
+
+  /** Add score of the particle to all bins entered by it and it's ancestors
+      before.
+      \param track -- the scored particle.
+      \param weight -- it's score.
+  */
+  void score(const G4Track *track, const double weight);
+
+  /** Add counts of this thread to the master ones and clear them.*/
+  void merge();
+
+  /** Clear the master counts, it's done at the beginning of run.*/
+  static void reset_master();
+
+  /** Write the master counts as a map of windows to the output file.
+      \param number of histories of the run.
+      \return false if the file can't be written.
+   */
+  static bool write_master(const G4int histories);
+
+  /** Set the map file of the pilot run.
+      \param file name, empty string disables the generator(default).
+      \return false if the mesh has one bin(the default one), nothing is
+      changed then: one window for the whole world is no map.
+  */
+  static bool set_output(const G4String &file_name);
+
+  static bool is_enabled()
+  {
+    return !output_name.empty();
+  }
+
+  static void set_target(const G4String &detector_name)
+  {
+    target_name = detector_name;
+  }
+
+  /** Set ratio of the upper bound of the windows to the lower one.
+      \return false if it's not greater than 1.
+  */
+  static bool set_ratio(const double value);
+
+  /** Mesh of the windows, DetectorConstruction sets it's box
+      to the world's one.*/
+  static WeightWindowMesh& get_mesh()
+  {
+    return mesh;
+  }
+
+private:
+  /** A bin entered by a particle.*/
+  struct entry
+  {
+    long bin;
+    double time;
+  };
+
+  /** The bins entered by a particle, in order.*/
+  struct lineage
+  {
+    G4int parent;
+    /** global time of the birth, older entries of the parent are
+	the parent's contribution to the scores of this particle*/
+    double born;
+    long last_bin;
+    std::vector<entry> entries;
+  };
+
+  /** tracks of the current event by their ID*/
+  std::map<G4int, lineage> tracks;
+
+  /** the target of this thread*/
+  const DetectorSD2 *target;
+
+  /** entered weight and score of each mesh bin*/
+  std::vector<double> weight_sum, score_sum;
+  double total_score;
+
+  static WeightWindowMesh mesh;
+  static G4String output_name;
+  static G4String target_name;
+  static double ratio;
+
+  static std::vector<double> master_weight_sum, master_score_sum;
+  static double master_total_score;
+};
+
+#endif
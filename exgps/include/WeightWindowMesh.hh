@@ -0,0 +1,79 @@
+/* ========================================================== */
+// Part of simulation for use with GEANT4 code.
+// Spatial-energy mesh of the weight windows.
+//
+// Taras Schevchenko National University of Kyiv, 2012.
+/* ========================================================== */
+
+#ifndef WeightWindowMesh_h
+#define WeightWindowMesh_h 1
+
+#include "G4ThreeVector.hh"
+#include "globals.hh"
+#include <iostream>
+
+class WeightWindowMesh
+{
+  /**
+     Regular mesh of NX*NY*NZ boxes between two corners, each box is
+     divided into NE energy bins of equal width in log(E).
+     Energies below the first bin or above the last one go to that bin,
+     points outside of the corners are out of the mesh.
+     Units are Geant4 internal ones: mm and MeV, the map files keep them.
+   */
+public:
+  WeightWindowMesh();
+
+  /** Set corners of the mesh.
+      \param low -- corner with the smallest coordinates.
+      \param high -- opposite corner.
+  */
+  void set_box(const G4ThreeVector &low, const G4ThreeVector &high);
+
+  /** \return false if the corners are not set yet.*/
+  bool has_box() const
+  {
+    return high[0] > low[0] && high[1] > low[1] && high[2] > low[2];
+  }
+
+  /** Set number of the boxes along each axis.
+      \return false if one of them is not positive, nothing is changed then.
+  */
+  bool set_cells(const int nx, const int ny, const int nz);
+
+  /** Set energy bins.
+      \return false if bins are wrong(n < 1 or 0 < e_min < e_max is false).
+  */
+  bool set_energies(const int n, const double e_min, const double e_max);
+
+  /** \return index of the mesh bin of the point and energy, -1 if the
+      point is out of the mesh.*/
+  long index(const G4ThreeVector &position, const double energy) const;
+
+  /** \return number of the mesh bins(boxes times energy bins).*/
+  size_t size() const
+  {
+    return (size_t)n_cells[0]*n_cells[1]*n_cells[2]*n_energies;
+  }
+
+  /** Write the "mesh" and "energy" lines of the map file.*/
+  void write_header(std::ostream &stream) const;
+
+  /** Read the lines written by write_header().
+      \return false if the lines are not found or wrong, the mesh is not
+      changed then.*/
+  bool read_header(std::istream &stream);
+
+  /** Print the mesh in one line.*/
+  void print(std::ostream &stream) const;
+
+private:
+  G4ThreeVector low, high;
+  int n_cells[3];
+  int n_energies;
+  double energy_min, energy_max;
+  /** log(energy_max/energy_min), cached by set_energies()*/
+  double log_range;
+};
+
+#endif
@@ -0,0 +1,65 @@
+/* ========================================================== */
+// Part of simulation for use with GEANT4 code.
+// Splitting and russian roulette by the weight windows map.
+//
+// Taras Schevchenko National University of Kyiv, 2012.
+/* ========================================================== */
+
+#ifndef WeightWindowProcess_h
+#define WeightWindowProcess_h 1
+
+#include "SplitRoulette.hh"
+#include "WeightWindowMesh.hh"
+#include "globals.hh"
+#include <vector>
+
+class WeightWindowProcess : public SplitRoulette
+{
+  /**
+     Applies the weight windows made by a pilot run(see WeightWindowGenerator).
+     Each bin of the mesh has a window [W, R*W]: after every step a particle
+     heavier than R*W is split into copies of weight about (1+R)*W/2,
+     a particle lighter than W plays the russian roulette and survives
+     with weight (1+R)*W/2(see SplitRoulette). Bins with W = 0 and points
+     out of the mesh have no window.
+   */
+public:
+  WeightWindowProcess();
+  ~WeightWindowProcess();
+
+  /** Load the map of weight windows.
+      \param file name, empty string disables the windows.
+      \return false if the file can't be read, the map in use is kept then.
+  */
+  static bool load(const G4String &file_name);
+
+  static bool is_enabled()
+  {
+    return !lower_bounds.empty();
+  }
+
+  static const G4String& get_file_name()
+  {
+    return map_file_name;
+  }
+
+  /** Print the loaded map in one line.*/
+  static void print(std::ostream &stream);
+
+protected:
+  bool is_active() const
+  {
+    return is_enabled();
+  }
+  void bias(const G4Track &track, const G4Step &step);
+
+private:
+  static WeightWindowMesh mesh;
+  /** lower bounds of the windows for each mesh bin*/
+  static std::vector<double> lower_bounds;
+  /** ratio of the upper bound to the lower one*/
+  static double ratio;
+  static G4String map_file_name;
+};
+
+#endif
@@ -0,0 +1,134 @@
+/* ========================================================== */
+// Part of simulation for use with GEANT4 code.
+// Binary raw-energy files written by DetectorSD2,
+// does not depend on GEANT4, so the converter tools may use it too.
+//
+// Taras Schevchenko National University of Kyiv, 2012.
+/* ========================================================== */
+
+#ifndef RAW_FILE_H
+#define RAW_FILE_H 1
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+/** First 8 bytes of every binary raw file.*/
+#define RAW_FILE_MAGIC "G4RAWBIN"
+#define RAW_FILE_VERSION 1
+
+/** Size of the buffer of the persistent file handle.*/
+#define RAW_FILE_BUFFER_SIZE (1 << 20)
+
+/**
+   Header of the binary raw-energy file.
+   On disk, all numbers are little-endian:
+
+   char     magic[8]        "G4RAWBIN"
+   uint32   version         1
+   uint32   value_size      4 -- float values, 8 -- double values
+   uint32   energy_units    0 -- eV, 1 -- keV, 2 -- MeV
+   uint32   name_length     length of the detector name
+   uint32   species_length  length of the particle name
+   uint32   quantity_length length of the quantity name
+   uint64   event_count     events simulated while the file was written
+   uint64   value_count     number of values after the header
+   char     detector name, particle name, quantity("kinetic"/"deposited")
+
+   followed by value_count packed values.
+*/
+struct raw_file_header
+{
+  raw_file_header()
+  {
+    value_size = sizeof(double);
+    energy_units = 1;
+    event_count = 0;
+    value_count = 0;
+  }
+  unsigned value_size;
+  unsigned energy_units;
+  unsigned long long event_count;
+  unsigned long long value_count;
+  std::string detector_name;
+  std::string species;
+  std::string quantity;
+
+  /** \return "eV", "keV" or "MeV".*/
+  const char *unit_name() const;
+};
+
+class raw_file
+{
+  /**
+     One binary raw-energy file. Writing goes through a single
+     buffered FILE* which stays open until close() is called,
+     the counters in the header are updated on close().
+   */
+public:
+  raw_file();
+  ~raw_file();
+
+  /** Open file for writing. If the file already exists and has the same
+      detector, species, quantity, value size and units -- the values will
+      be appended to it, otherwise the file is recreated.
+      \param file name.
+      \param header to be written, it's counters are ignored.
+      \return 0 on success, -1 if the file can not be opened.
+  */
+  int open_write(const std::string &filename, const raw_file_header &header);
+
+  /** Append values to the file, they're stored as
+      floats or doubles according to the header.
+      \return 0 on success, -1 on write error.
+  */
+  int write(const double *values, const size_t n_values);
+
+  /** Open file for reading and read it's header.
+      \return 0 on success, -1 if the file is not a binary raw file.
+  */
+  int open_read(const std::string &filename);
+
+  /** Read up to n_values values, converted to double.
+      \return number of values read, 0 at the end of file.
+  */
+  size_t read(double *values, const size_t n_values);
+
+  /** Update the header counters and close the file.
+      \param number of events to be added to header's event counter.
+      \return 0 on success.
+  */
+  int close(const unsigned long long add_events = 0);
+
+  bool is_open() const
+  {
+    return fp != NULL;
+  }
+
+  const raw_file_header &header() const
+  {
+    return d_header;
+  }
+
+  /** \return true if the file starts with RAW_FILE_MAGIC.*/
+  static bool is_binary(const std::string &filename);
+
+private:
+  /** Read header from the current position of fp.*/
+  int read_header(raw_file_header &header);
+
+  /** Write header to the current position of fp.*/
+  int write_header(const raw_file_header &header);
+
+  FILE *fp;
+  bool writing;
+  raw_file_header d_header;
+
+  /** values are converted here before writing/after reading.*/
+  std::vector<unsigned char> d_buffer;
+
+  /** buffer of the FILE* handle*/
+  std::vector<char> d_stream_buffer;
+};
+
+#endif
@@ -0,0 +1,98 @@
+/* ========================================================== */
+// Part of simulation for use with GEANT4 code.
+// Background thread which writes raw-energy batches of DetectorSD2,
+// so the event loop doesn't wait for the disk.
+//
+// Taras Schevchenko National University of Kyiv, 2012.
+/* ========================================================== */
+
+#ifndef RAW_WRITER_H
+#define RAW_WRITER_H 1
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+/** Default number of batches waiting in the writer's queue.*/
+#define RAW_WRITER_QUEUE_SIZE 8
+
+/** One batch of values to be written to a raw file.*/
+struct raw_write_job
+{
+  std::string filename;
+  /** RAW_FORMAT_TEXT, RAW_FORMAT_DOUBLE or RAW_FORMAT_FLOAT*/
+  unsigned format;
+  unsigned energy_units;
+  std::string detector_name;
+  std::string species;
+  /** "kinetic" or "deposited"*/
+  std::string quantity;
+  std::vector<double> values;
+};
+
+class raw_writer
+{
+  /**
+     Writes batches in the order they were submitted, by a single
+     thread, which is started on the first submit() and stopped by finish().
+     The queue is bounded: when the disk falls behind, submit() waits
+     until the thread takes a batch from the queue.
+     Emptied vectors are kept and given back to the callers, so
+     the per-species buffers don't get reallocated after each flush;
+     the spare vectors are allocated with the writer, so the first
+     flushes get them too.
+     Batches submitted while finish() stops the thread are written
+     by finish() itself, none is lost.
+   */
+public:
+  typedef void (*write_function)(raw_write_job &job);
+
+  /** \param function which does the actual writing.
+      \param maximum number of batches in the queue.
+      \param capacity of the spare vectors, values of one batch.*/
+  raw_writer(write_function function, const size_t max_jobs = RAW_WRITER_QUEUE_SIZE,
+	     const size_t batch_capacity = 0);
+  ~raw_writer();
+
+  /** Put the batch into the queue. The values are moved
+      from the buffer to the job, the buffer gets an empty vector
+      of the same capacity(if there's one to spare).
+      \param job with the file description, it's values are ignored.
+      \param buffer with the values, it's empty on return.
+  */
+  void submit(raw_write_job &job, std::vector<double> &buffer);
+
+  /** Wait until all submitted batches are written.*/
+  void drain();
+
+  /** Write all batches and stop the thread.*/
+  void finish();
+
+  void set_queue_size(const size_t max_jobs);
+
+private:
+  void run();
+
+  write_function d_function;
+  size_t d_max_jobs;
+  bool d_running;
+  bool d_stop;
+  /** number of jobs taken by the thread, but not written yet.*/
+  size_t d_busy;
+
+  std::deque<raw_write_job> d_queue;
+  /** written out vectors, ready to be given back to submit()'s callers*/
+  std::vector<std::vector<double> > d_spare;
+
+  std::thread d_thread;
+  std::mutex d_mutex;
+  /** signalled when a job is added or the thread is told to stop*/
+  std::condition_variable d_job_added;
+  /** signalled when a job is taken from the queue or written*/
+  std::condition_variable d_job_done;
+};
+
+#endif
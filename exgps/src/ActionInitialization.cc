@@ -0,0 +1,99 @@
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+///*
+// Part of simulation for use with GEANT4 code.
+// Taras Schevchenko National University of Kyiv 2012
+//****************
+
+#include "ActionInitialization.hh"
+#include "DetectorConstruction.hh"
+#include "PrimaryGeneratorAction.hh"
+#include "RunAction.hh"
+#include "EventAction.hh"
+#include "SteppingAction.hh"
+#include "StackingAction.hh"
+#include "WeightWindowGenerator.hh"
+
+ActionInitialization::ActionInitialization(DetectorConstruction *construction,
+					   PhysicsList *physics)
+  : G4VUserActionInitialization(), construction_unit(construction), physics_list(physics)
+{
+
+}
+
+ActionInitialization::~ActionInitialization()
+{
+
+}
+
+void ActionInitialization::BuildForMaster() const
+{
+  RunAction *userAction = new RunAction();
+  /** the master saves the data merged from all worker threads:*/
+  userAction->DSD_vector = &construction_unit->vector_DetectorSD;
+  userAction->physics_list = physics_list;
+  SetUserAction(userAction);
+}
+
+void ActionInitialization::Build() const
+{
+  /**
+     The vector is filled later in DetectorConstruction::ConstructSDandField()
+     which is called from the same thread, we only pass it's address here.
+  **/
+  std::vector<DetectorSD2*> *thread_vector = construction_unit->GetDetectorSDVector();
+
+  /** pilot run's counts of the thread, RunAction deletes it:*/
+  WeightWindowGenerator *generator = new WeightWindowGenerator();
+
+  SetUserAction(new PrimaryGeneratorAction());
+  EventAction *userEventAction = new EventAction();
+  userEventAction->ww_generator = generator;
+  SetUserAction(userEventAction);
+
+  RunAction *userAction = new RunAction();
+  /**
+     assign pointer std::vector<DetectorSD*> *DSD_vector
+     from RunAction class to make histograms from detector data:
+  **/
+  userAction->DSD_vector = thread_vector;
+  /** Worker threads merge their data into the master's detectors:*/
+  if(thread_vector != &construction_unit->vector_DetectorSD)
+    userAction->master_DSD_vector = &construction_unit->vector_DetectorSD;
+  else /** sequential mode: this action is the master's one*/
+    userAction->physics_list = physics_list;
+  userAction->ww_generator = generator;
+  SetUserAction(userAction);
+
+  SteppingAction *userSteppingAction = new SteppingAction();
+  /** Assign vector of special detection counters which only
+      track kinetic energy of incoming particles with no interaction:
+  **/
+  userSteppingAction->SetDetectorSD(thread_vector);
+  userSteppingAction->set_weight_window_generator(generator);
+  SetUserAction(userSteppingAction);
+
+  /** classifies new secondaries by the rules of /construction/stack_rule:*/
+  SetUserAction(new StackingAction());
+}
@@ -29,15 +29,35 @@
 
 #include "DetectorConstruction.hh"
 #include "quick_geom.hh"
+#include "ImportanceProcess.hh"
+#include "WeightWindowGenerator.hh"
+#include "WeightWindowProcess.hh"
+#include "G4Threading.hh"
+#include "G4Region.hh"
+#include "G4RegionStore.hh"
+#include "G4ProductionCuts.hh"
+#include "G4UIcommand.hh"
+#include <sstream>
+#include <float.h>
+
+G4ThreadLocal std::vector<DetectorSD2*> *DetectorConstruction::thread_vector_DetectorSD = NULL;
 
 DetectorConstruction::DetectorConstruction()
 {
-
+  messenger = new DetectorConstructionMessenger(this);
+  d_hist_min=0;
+  d_hist_max=100000;
+  d_hist_bins = 200000;
+  d_energy_units=1;
+  d_raw_format = RAW_FORMAT_TEXT;
+  d_histogramming = true;
+  d_raw_capture = false;
+  d_hist_log = false;
 }
 
 DetectorConstruction::~DetectorConstruction() 
 {
-  
+  delete messenger;
 }
 
 /**
@@ -55,12 +75,16 @@ DetectorSD2 * DetectorConstruction::new_detector_sensitive(const G4String name)
   //now pull out the pointer:
   std::vector<DetectorSD2*>::iterator iter = 
     vector_DetectorSD.end()-1;
-  (*iter)->fill_hist("e-", 0);
-  (*iter)->fill_hist("e+", 0);
-  (*iter)->fill_hist("gamma", 0);
-  (*iter)->fill_hist_deposited("e-", 0);
-  (*iter)->fill_hist_deposited("e+", 0);
-  (*iter)->fill_hist_deposited("gamma", 0);
+  (*iter)->set_raw_format(d_raw_format);
+  (*iter)->set_histogramming(d_histogramming);
+  (*iter)->set_raw_capture(d_raw_capture);
+  (*iter)->set_energy_units(d_energy_units);
+  (*iter)->set_histo_log(d_hist_log);
+  (*iter)->set_histo_edges(d_hist_edges);
+  (*iter)->set_histo(d_hist_min, d_hist_max, d_hist_bins);
+  (*iter)->add_species("e-");
+  (*iter)->add_species("e+");
+  (*iter)->add_species("gamma");
   return (*iter);
 }
 
@@ -126,15 +150,307 @@ void DetectorConstruction::set_histo(const double min,
     }
   d_hist_bins = n_bins;
   d_energy_units = E_units;
+  for(size_t i = 0; i < vector_DetectorSD.size(); i++)
+    vector_DetectorSD[i]->set_energy_units(d_energy_units);
+  apply_histo();
+}
+
+/** Pass histogram properties to the detectors made already.*/
+void DetectorConstruction::apply_histo()
+{
+  for(size_t i = 0; i < vector_DetectorSD.size(); i++)
+    vector_DetectorSD[i]->set_histo(d_hist_min, d_hist_max, d_hist_bins);
+}
+
+void DetectorConstruction::set_histo_log(const G4bool log)
+{
+  d_hist_log = log;
+  for(size_t i = 0; i < vector_DetectorSD.size(); i++)
+    vector_DetectorSD[i]->set_histo_log(log);
+}
+
+/** Set histogram bins by their edges.
+    \param ascending edges separated by spaces.
+*/
+void DetectorConstruction::set_histo_edges(const G4String &edges)
+{
+  d_hist_edges.clear();
+  std::istringstream stream(edges);
+  double value;
+  while(stream >> value)
+    d_hist_edges.push_back(value);
+  for(size_t i = 1; i < d_hist_edges.size(); i++)
+    if(!(d_hist_edges[i-1] < d_hist_edges[i]))
+      {
+	G4cerr << "DetectorConstruction: histogram edges must be ascending, "
+	       << "bins of equal width are used.\n";
+	d_hist_edges.clear();
+	break;
+      }
+  for(size_t i = 0; i < vector_DetectorSD.size(); i++)
+    vector_DetectorSD[i]->set_histo_edges(d_hist_edges);
+}
+
+void DetectorConstruction::set_histogramming(const G4bool enable)
+{
+  d_histogramming = enable;
+  for(size_t i = 0; i < vector_DetectorSD.size(); i++)
+    vector_DetectorSD[i]->set_histogramming(enable);
+}
+
+void DetectorConstruction::set_raw_capture(const G4bool enable)
+{
+  d_raw_capture = enable;
+  for(size_t i = 0; i < vector_DetectorSD.size(); i++)
+    vector_DetectorSD[i]->set_raw_capture(enable);
+}
+
+/** Set importances of the layers of the polybox wall.
+    \param importances from the outer layer to the inner one separated by spaces.
+*/
+void DetectorConstruction::set_importance_layers(const G4String &values)
+{
+  std::vector<double> layers;
+  std::istringstream stream(values);
+  double value;
+  while(stream >> value)
+    layers.push_back(value);
+  if(!layers.empty()
+     && !SplitRoulette::check_exclusive("importances", WeightWindowProcess::is_enabled()))
+    return;
+  if(!ImportanceProcess::set_importances(layers))
+    G4cerr << "DetectorConstruction: importances must be positive, "
+	   << "they're not changed.\n";
+}
+
+/** Set importances growing by the same ratio from layer to layer.
+    \param "N RATIO": quantity of layers and the ratio.
+*/
+void DetectorConstruction::set_importance_geometric(const G4String &values)
+{
+  std::istringstream stream(values);
+  int n_layers = 0;
+  double ratio = 0;
+  if(!(stream >> n_layers >> ratio) || n_layers < 0 || !(ratio > 0))
+    {
+      G4cerr << "DetectorConstruction: \"N RATIO\" expected, importances are not changed.\n";
+      return;
+    }
+  std::vector<double> layers;
+  double importance = 1;
+  for(int i = 0; i < n_layers; i++)
+    {
+      importance *= ratio;
+      layers.push_back(importance);
+    }
+  if(!layers.empty()
+     && !SplitRoulette::check_exclusive("importances", WeightWindowProcess::is_enabled()))
+    return;
+  ImportanceProcess::set_importances(layers);
+}
+
+/** Set production cut of a region.
+    \param "REGION VALUE UNIT", e.g. "SHIELD 1 cm".
+*/
+void DetectorConstruction::set_region_cut(const G4String &values)
+{
+  std::istringstream stream(values);
+  std::string name, unit;
+  G4double value = 0;
+  if(!(stream >> name >> value >> unit) || !(value > 0))
+    {
+      G4cerr << "DetectorConstruction: \"REGION VALUE UNIT\" expected, cuts are not changed.\n";
+      return;
+    }
+  const G4double cut = value*G4UIcommand::ValueOf(unit.c_str());
+  region_cuts[name] = cut;
+  //the regions are made already after /run/initialize:
+  if(G4RegionStore::GetInstance()->GetRegion(name, false) != NULL)
+    apply_region_cut(name, cut);
+}
+
+/** Limit steps of e-/e+ in a region.
+    \param "REGION VALUE UNIT", value 0 -- no limit.
+*/
+void DetectorConstruction::set_region_step(const G4String &values)
+{
+  std::istringstream stream(values);
+  std::string name, unit;
+  G4double value = -1;
+  if(!(stream >> name >> value >> unit) || value < 0)
+    {
+      G4cerr << "DetectorConstruction: \"REGION VALUE UNIT\" expected, steps are not changed.\n";
+      return;
+    }
+  //SteppingAction fills the histograms on each step ending in a detector,
+  //shorter steps there would count the same particle many times:
+  if(name == REGION_DETECTORS && value > 0)
+    {
+      G4cerr << "DetectorConstruction: steps can't be limited in the region \""
+	     << name << "\", the detectors count steps.\n";
+      return;
+    }
+  const G4double step = (value > 0)? value*G4UIcommand::ValueOf(unit.c_str()) : DBL_MAX;
+  region_steps[name] = step;
+  std::map<G4String, G4UserLimits*>::iterator limits = region_limits.find(name);
+  if(limits != region_limits.end())
+    limits->second->SetMaxAllowedStep(step);
+  else if(G4RegionStore::GetInstance()->GetRegion(name, false) == NULL)
+    G4cout << "DetectorConstruction: there is no region \"" << name
+	   << "\" yet, the step limit is kept for it.\n";
+}
+
+/** Make a region of the volumes with the cut and the step limit set before.*/
+G4Region* DetectorConstruction::make_region(const G4String &name,
+					     const std::vector<G4LogicalVolume*> &volumes)
+{
+  G4Region *region = new G4Region(name);
+  std::map<G4String, G4double>::const_iterator step = region_steps.find(name);
+  //the volumes share one object, it's changed by set_region_step():
+  G4UserLimits *limits = new G4UserLimits((step != region_steps.end())? step->second : DBL_MAX);
+  region_limits[name] = limits;
+  region->SetUserLimits(limits);
+  for(size_t i = 0; i < volumes.size(); i++)
+    {
+      region->AddRootLogicalVolume(volumes[i]);
+      volumes[i]->SetUserLimits(limits);
+    }
+  std::map<G4String, G4double>::const_iterator cut = region_cuts.find(name);
+  if(cut != region_cuts.end())
+    apply_region_cut(name, cut->second);
+  return region;
+}
+
+void DetectorConstruction::apply_region_cut(const G4String &name, const G4double cut)
+{
+  G4Region *region = G4RegionStore::GetInstance()->GetRegion(name, false);
+  if(region == NULL)
+    {
+      G4cerr << "DetectorConstruction: there is no region \"" << name << "\".\n";
+      return;
+    }
+  //after /run/initialize a region without cuts of it's own shares the
+  //object of the world's region, changing it would change the world:
+  G4Region *world = G4RegionStore::GetInstance()->GetRegion("DefaultRegionForTheWorld", false);
+  G4ProductionCuts *world_cuts = (world != NULL)? world->GetProductionCuts() : NULL;
+  G4ProductionCuts *cuts = region->GetProductionCuts();
+  if(cuts == NULL || cuts == world_cuts)
+    {
+      cuts = (world_cuts != NULL)? new G4ProductionCuts(*world_cuts) : new G4ProductionCuts();
+      region->SetProductionCuts(cuts);
+    }
+  cuts->SetProductionCut(cut);
+}
+
+/** Add a rule of StackingAction.
+    \param "PARTICLE EMAX UNIT REGION ACTION", e.g. "e- 1 MeV SHIELD kill".
+*/
+void DetectorConstruction::set_stack_rule(const G4String &values)
+{
+  std::istringstream stream(values);
+  std::string particle, unit, region, action;
+  G4double threshold = -1;
+  if(!(stream >> particle >> threshold >> unit >> region >> action) || threshold < 0)
+    {
+      G4cerr << "DetectorConstruction: \"PARTICLE EMAX UNIT REGION ACTION\" expected, "
+	     << "the rule is not added.\n";
+      return;
+    }
+  G4ClassificationOfNewTrack classification;
+  if(action == "kill")
+    classification = fKill;
+  else if(action == "waiting")
+    classification = fWaiting;
+  else if(action == "urgent")
+    classification = fUrgent;
+  else
+    {
+      G4cerr << "DetectorConstruction: unknown action \"" << action
+	     << "\"(kill, waiting or urgent), the rule is not added.\n";
+      return;
+    }
+  StackingAction::add_rule(particle, threshold*G4UIcommand::ValueOf(unit.c_str()),
+			   region, classification);
+}
+
+/** Load the weight windows map for the next runs.
+    \param file name, empty string disables the windows.
+*/
+void DetectorConstruction::set_ww_apply(const G4String &file_name)
+{
+  if(!file_name.empty()
+     && !SplitRoulette::check_exclusive("weight windows",
+					!ImportanceProcess::get_importances().empty()))
+    return;
+  if(WeightWindowProcess::load(file_name) && WeightWindowProcess::is_enabled())
+    WeightWindowProcess::print(G4cout);
+}
+
+/** Set boxes of the pilot run's mesh and optionally it's corners.
+    \param "NX NY NZ" or "NX NY NZ X1 Y1 Z1 X2 Y2 Z2", corners in cm.
+*/
+void DetectorConstruction::set_ww_mesh(const G4String &values)
+{
+  std::istringstream stream(values);
+  int n[3];
+  if(!(stream >> n[0] >> n[1] >> n[2])
+     || !WeightWindowGenerator::get_mesh().set_cells(n[0], n[1], n[2]))
+    {
+      G4cerr << "DetectorConstruction: \"NX NY NZ\" expected, the mesh is not changed.\n";
+      return;
+    }
+  double corners[6];
+  for(int i = 0; i < 6; i++)
+    if(!(stream >> corners[i]))
+      return;
+  if(!(corners[3] > corners[0] && corners[4] > corners[1] && corners[5] > corners[2]))
+    {
+      G4cerr << "DetectorConstruction: wrong corners of the mesh, they're not changed.\n";
+      return;
+    }
+  WeightWindowGenerator::get_mesh().set_box(G4ThreeVector(corners[0], corners[1], corners[2])*cm,
+					    G4ThreeVector(corners[3], corners[4], corners[5])*cm);
+}
+
+/** Set energy bins of the pilot run's mesh.
+    \param "N EMIN EMAX", energies in keV.
+*/
+void DetectorConstruction::set_ww_energies(const G4String &values)
+{
+  std::istringstream stream(values);
+  int n = 0;
+  double e_min = 0, e_max = 0;
+  if(!(stream >> n >> e_min >> e_max)
+     || !WeightWindowGenerator::get_mesh().set_energies(n, e_min*keV, e_max*keV))
+    G4cerr << "DetectorConstruction: \"N EMIN EMAX\" expected, energy bins are not changed.\n";
+}
+
+/** Set ratio of the upper bound of the generated windows to the lower one.*/
+void DetectorConstruction::set_ww_ratio(const G4double ratio)
+{
+  if(!WeightWindowGenerator::set_ratio(ratio))
+    G4cerr << "DetectorConstruction: the ratio must be greater than 1.\n";
+}
+
+/** Set format of the detectors' raw energy files.
+    \param "text", "double" or "float".
+*/
+void DetectorConstruction::set_raw_format(const G4String &format)
+{
+  if(format == "double")
+    d_raw_format = RAW_FORMAT_DOUBLE;
+  else if(format == "float")
+    d_raw_format = RAW_FORMAT_FLOAT;
+  else
+    d_raw_format = RAW_FORMAT_TEXT;
+  //the detectors may be constructed already:
+  for(size_t i = 0; i < vector_DetectorSD.size(); i++)
+    vector_DetectorSD[i]->set_raw_format(d_raw_format);
 }
   
 
 G4VPhysicalVolume* DetectorConstruction::Construct()
 {
- 
-  //get pointer to sensitive detector manager:
-  G4SDManager *det_manager = G4SDManager::GetSDMpointer();
-
   // --- materials ---
   // создаем материалы
   // первый способ:
@@ -197,20 +513,40 @@ G4VPhysicalVolume* DetectorConstruction::Construct()
   
 
   G4ThreeVector polyboxCenter = G4ThreeVector(0,0, -10.15 *m);
+  G4ThreeVector polyboxSize = G4ThreeVector(900*cm, 900*cm, 900*cm);
+  G4ThreeVector polyboxHole = G4ThreeVector(170*cm, 170*cm, 170*cm);
+  std::vector< g4solid_object<G4Box>* > polyboxParts;
   /** This function makes a box with a hole*/
   make_box_with_hole( world_logical_volume,
 		      "polybox",
 		      Poly_material,
 		      polyboxCenter /*box center*/,
-		      G4ThreeVector(900*cm, 900*cm, 900*cm) /*box dimensions(width, height, depth)*/,
-		      G4ThreeVector(170*cm, 170*cm, 170*cm)/*hole dimensions(width, height, depth)*/,
-		      NULL, NULL);
+		      polyboxSize /*box dimensions(width, height, depth)*/,
+		      polyboxHole /*hole dimensions(width, height, depth)*/,
+		      &polyboxParts, NULL);
+  /* the shield's bulk has it's own production cut and step limit */
+  std::vector<G4LogicalVolume*> shieldVolumes;
+  for(size_t i = 0; i < polyboxParts.size(); i++)
+    shieldVolumes.push_back(polyboxParts[i]->get_logical());
+  make_region(REGION_SHIELD, shieldVolumes);
+  /* importance cells are the layers of the box's wall */
+  ImportanceProcess::set_box(polyboxCenter, polyboxSize, polyboxHole);
+  /* weight windows mesh covers the world unless it's set from the macro */
+  if(!WeightWindowGenerator::get_mesh().has_box())
+    {
+      const G4ThreeVector world_half(world_box->GetXHalfLength(),
+				     world_box->GetYHalfLength(),
+				     world_box->GetZHalfLength());
+      WeightWindowGenerator::get_mesh().set_box(-world_half, world_half);
+    }
 
   DetectorSD2  *sd2Pointer;
   G4LogicalVolume *detectorLogicalPointer;
   g4solid_object<G4Tubs> *detectorCylinder;
 
-/** This macros adds new sensitive detector.**/
+/** This macros adds new sensitive detector.
+    Only the master's DetectorSD2 object is made here, it's registered
+    and attached to the volume in ConstructSDandField().**/
 #define ADD_NEW_DETECTOR(_NAME_, _MATERIAL_, _PLACEMENT_, _DIAMETER_, _HEIGHT_)	\
 									\
   detectorCylinder =   make_cylinder(world_logical_volume,		\
@@ -218,10 +554,8 @@ G4VPhysicalVolume* DetectorConstruction::Construct()
 				     _MATERIAL_,  _PLACEMENT_, _DIAMETER_, _HEIGHT_); \
 									\
   sd2Pointer = new_detector_sensitive(_NAME_);				\
-  det_manager->AddNewDetector(sd2Pointer);				\
   detectorLogicalPointer = detectorCylinder->get_logical();		\
-  detectorLogicalPointer->SetSensitiveDetector(sd2Pointer);		\
-  vector_DetectorSD.push_back(sd2Pointer);
+  vector_detector_logical.push_back(detectorLogicalPointer);
 
   /* Detector inside the box. */
   ADD_NEW_DETECTOR("DET.INSIDE", void_dumb_material, G4ThreeVector(0,0,-10.15*m), 1.3*m, 10*cm);
@@ -233,6 +567,43 @@ G4VPhysicalVolume* DetectorConstruction::Construct()
   /* Make detector virtual (counts onyl kinetic energy)*/
   sd2Pointer->DisableDepositedEnergyCount();
 
+  /* neighbourhood of the detectors: their volumes */
+  make_region(REGION_DETECTORS, vector_detector_logical);
+
   return world_physical_volume;
 }
 
+
+/** Vector of DetectorSD2 objects which get hits in the calling thread.*/
+std::vector<DetectorSD2*> *DetectorConstruction::GetDetectorSDVector()
+{
+  if(G4Threading::IsMasterThread())
+    return &vector_DetectorSD;
+  if(thread_vector_DetectorSD == NULL)
+    thread_vector_DetectorSD = new std::vector<DetectorSD2*>;
+  return thread_vector_DetectorSD;
+}
+
+void DetectorConstruction::ConstructSDandField()
+{
+  //get pointer to sensitive detector manager:
+  G4SDManager *det_manager = G4SDManager::GetSDMpointer();
+  std::vector<DetectorSD2*> *thread_vector = GetDetectorSDVector();
+  bool make_copies = (thread_vector != &vector_DetectorSD);
+  //this worker thread already has got it's detectors:
+  if(make_copies && !thread_vector->empty()) return;
+
+  for(size_t i = 0; i < vector_DetectorSD.size(); i++)
+    {
+      DetectorSD2 *sd2Pointer = vector_DetectorSD[i];
+      if(make_copies)
+	{//worker thread: make it's own copy of the master's detector
+	  DetectorSD2 *master_detector = sd2Pointer;
+	  sd2Pointer = new DetectorSD2(master_detector->GetName());
+	  sd2Pointer->copy_settings(master_detector);
+	  thread_vector->push_back(sd2Pointer);
+	}
+      det_manager->AddNewDetector(sd2Pointer);
+      vector_detector_logical[i]->SetSensitiveDetector(sd2Pointer);
+    }
+}
@@ -35,6 +35,7 @@
 #include "G4UIdirectory.hh"
 #include "G4UIcmdWithAString.hh"
 #include "G4UIcmdWithADoubleAndUnit.hh"
+#include "G4UIcmdWithoutParameter.hh"
 
 DetectorConstructionMessenger::DetectorConstructionMessenger(DetectorConstruction* Det): detector(Det)
 { 
@@ -46,22 +47,140 @@ DetectorConstructionMessenger::DetectorConstructionMessenger(DetectorConstructio
   cmd_histo_bins =  new G4UIcmdWithAnInteger("/construction/hist_bins",this);
   cmd_histo_bins -> SetGuidance("number of histogramm bins."); 
   cmd_histo_bins -> SetParameterName("Number",true);
-  cmd_histo_bins -> SetRange("Size>=0.");
+  cmd_histo_bins -> SetRange("Number>0");
   cmd_histo_bins -> AvailableForStates(G4State_Idle); 
 
   cmd_histo_min =  new G4UIcmdWithADoubleAndUnit("/construction/hist_min",this);
   cmd_histo_min -> SetGuidance("min value of energy histogramms"); 
   cmd_histo_min -> SetParameterName("Size",true);
   cmd_histo_min -> SetRange("Size>=0.");
-  cmd_histo_min -> SetUnitCategory("Length");
+  cmd_histo_min -> SetUnitCategory("Energy");
   cmd_histo_min -> AvailableForStates(G4State_Idle); 
 
   cmd_histo_max =  new G4UIcmdWithADoubleAndUnit("/construction/hist_max",this);
   cmd_histo_max -> SetGuidance("max value of energy histogramms"); 
   cmd_histo_max -> SetParameterName("Size",true);
   cmd_histo_max -> SetRange("Size>=0.");
-  cmd_histo_max -> SetUnitCategory("Length");
+  cmd_histo_max -> SetUnitCategory("Energy");
   cmd_histo_max -> AvailableForStates(G4State_Idle); 
+
+  cmd_histo_log =  new G4UIcmdWithABool("/construction/hist_log",this);
+  cmd_histo_log -> SetGuidance("bins of equal width in log(E), hist_min must be positive.");
+  cmd_histo_log -> SetParameterName("Enable",true);
+  cmd_histo_log -> SetDefaultValue(true);
+  cmd_histo_log -> AvailableForStates(G4State_PreInit, G4State_Idle); 
+
+  cmd_histo_edges =  new G4UIcmdWithAString("/construction/hist_edges",this);
+  cmd_histo_edges -> SetGuidance("ascending bin edges in histogramm energy units(keV by default),");
+  cmd_histo_edges -> SetGuidance("e.g. \"0 10 50 100 1000 44000\", empty string resets the edges.");
+  cmd_histo_edges -> SetParameterName("Edges",true);
+  cmd_histo_edges -> SetDefaultValue("");
+  cmd_histo_edges -> AvailableForStates(G4State_PreInit, G4State_Idle); 
+
+  cmd_histogramming =  new G4UIcmdWithABool("/construction/histogramming",this);
+  cmd_histogramming -> SetGuidance("fill energy histogramms at hit time(default: true).");
+  cmd_histogramming -> SetParameterName("Enable",true);
+  cmd_histogramming -> SetDefaultValue(true);
+  cmd_histogramming -> AvailableForStates(G4State_PreInit, G4State_Idle); 
+
+  cmd_raw_capture =  new G4UIcmdWithABool("/construction/raw_capture",this);
+  cmd_raw_capture -> SetGuidance("save every energy value to raw files(default: false).");
+  cmd_raw_capture -> SetParameterName("Enable",true);
+  cmd_raw_capture -> SetDefaultValue(true);
+  cmd_raw_capture -> AvailableForStates(G4State_PreInit, G4State_Idle); 
+
+  cmd_raw_format =  new G4UIcmdWithAString("/construction/raw_format",this);
+  cmd_raw_format -> SetGuidance("format of the raw energy files:");
+  cmd_raw_format -> SetGuidance("text -- *_unit.raw text files,");
+  cmd_raw_format -> SetGuidance("double, float -- *_unit.bin binary files.");
+  cmd_raw_format -> SetParameterName("Format",false);
+  cmd_raw_format -> SetCandidates("text double float");
+  cmd_raw_format -> AvailableForStates(G4State_PreInit, G4State_Idle); 
+
+  cmd_async_writer =  new G4UIcmdWithABool("/construction/async_writer",this);
+  cmd_async_writer -> SetGuidance("write raw energy files by a separate thread(default: true).");
+  cmd_async_writer -> SetParameterName("Enable",true);
+  cmd_async_writer -> SetDefaultValue(true);
+  cmd_async_writer -> AvailableForStates(G4State_PreInit, G4State_Idle); 
+
+  cmd_writer_queue =  new G4UIcmdWithAnInteger("/construction/writer_queue",this);
+  cmd_writer_queue -> SetGuidance("number of batches waiting for the writer thread."); 
+  cmd_writer_queue -> SetParameterName("Number",false);
+  cmd_writer_queue -> SetRange("Number>0");
+  cmd_writer_queue -> AvailableForStates(G4State_PreInit, G4State_Idle); 
+
+  cmd_importance_layers =  new G4UIcmdWithAString("/construction/importance_layers",this);
+  cmd_importance_layers -> SetGuidance("importances of the polybox layers from the outer one to the inner one,");
+  cmd_importance_layers -> SetGuidance("e.g. \"2 4 8 16\", empty string disables splitting and roulette.");
+  cmd_importance_layers -> SetParameterName("Importances",true);
+  cmd_importance_layers -> SetDefaultValue("");
+  cmd_importance_layers -> AvailableForStates(G4State_PreInit, G4State_Idle); 
+
+  cmd_importance_geometric =  new G4UIcmdWithAString("/construction/importance_geometric",this);
+  cmd_importance_geometric -> SetGuidance("\"N RATIO\": N polybox layers of importances RATIO, RATIO^2, ... RATIO^N,");
+  cmd_importance_geometric -> SetGuidance("\"0 1\" disables splitting and roulette.");
+  cmd_importance_geometric -> SetParameterName("Layers",false);
+  cmd_importance_geometric -> AvailableForStates(G4State_PreInit, G4State_Idle); 
+
+  cmd_ww_generate =  new G4UIcmdWithAString("/construction/ww_generate",this);
+  cmd_ww_generate -> SetGuidance("pilot run: write weight windows for the target detector to the file");
+  cmd_ww_generate -> SetGuidance("at the end of each run, empty string disables it(default).");
+  cmd_ww_generate -> SetParameterName("File",true);
+  cmd_ww_generate -> SetDefaultValue("");
+  cmd_ww_generate -> AvailableForStates(G4State_PreInit, G4State_Idle); 
+
+  cmd_ww_apply =  new G4UIcmdWithAString("/construction/ww_apply",this);
+  cmd_ww_apply -> SetGuidance("split and roulette particles by the weight windows from the file,");
+  cmd_ww_apply -> SetGuidance("empty string disables it(default).");
+  cmd_ww_apply -> SetParameterName("File",true);
+  cmd_ww_apply -> SetDefaultValue("");
+  cmd_ww_apply -> AvailableForStates(G4State_PreInit, G4State_Idle); 
+
+  cmd_ww_mesh =  new G4UIcmdWithAString("/construction/ww_mesh",this);
+  cmd_ww_mesh -> SetGuidance("\"NX NY NZ\" boxes of the weight windows mesh, optionally followed by");
+  cmd_ww_mesh -> SetGuidance("it's corners \"X1 Y1 Z1 X2 Y2 Z2\" in cm(default: the world box).");
+  cmd_ww_mesh -> SetParameterName("Mesh",false);
+  cmd_ww_mesh -> AvailableForStates(G4State_PreInit, G4State_Idle); 
+
+  cmd_ww_energies =  new G4UIcmdWithAString("/construction/ww_energies",this);
+  cmd_ww_energies -> SetGuidance("\"N EMIN EMAX\" energy bins of the weight windows mesh(log scale, keV).");
+  cmd_ww_energies -> SetParameterName("Bins",false);
+  cmd_ww_energies -> AvailableForStates(G4State_PreInit, G4State_Idle); 
+
+  cmd_ww_target =  new G4UIcmdWithAString("/construction/ww_target",this);
+  cmd_ww_target -> SetGuidance("detector which score the weight windows are made for(default: " WW_DEFAULT_TARGET ").");
+  cmd_ww_target -> SetParameterName("Detector",false);
+  cmd_ww_target -> AvailableForStates(G4State_PreInit, G4State_Idle); 
+
+  cmd_ww_ratio =  new G4UIcmdWithADouble("/construction/ww_ratio",this);
+  cmd_ww_ratio -> SetGuidance("ratio of the upper bound of the generated windows to the lower one(default: 5).");
+  cmd_ww_ratio -> SetParameterName("Ratio",false);
+  cmd_ww_ratio -> SetRange("Ratio>1");
+  cmd_ww_ratio -> AvailableForStates(G4State_PreInit, G4State_Idle); 
+
+  cmd_region_cut =  new G4UIcmdWithAString("/construction/region_cut",this);
+  cmd_region_cut -> SetGuidance("\"REGION VALUE UNIT\" production cut of a region, e.g. \"SHIELD 1 cm\",");
+  cmd_region_cut -> SetGuidance("regions: " REGION_SHIELD ", " REGION_DETECTORS ", others get the default cut.");
+  cmd_region_cut -> SetParameterName("Cut",false);
+  cmd_region_cut -> AvailableForStates(G4State_PreInit, G4State_Idle); 
+
+  cmd_region_step =  new G4UIcmdWithAString("/construction/region_step",this);
+  cmd_region_step -> SetGuidance("\"REGION VALUE UNIT\" step limit of e-/e+ in a region, it limits");
+  cmd_region_step -> SetGuidance("their multiple scattering steps too, 0 -- no limit(default).");
+  cmd_region_step -> SetGuidance("Not for " REGION_DETECTORS ": the detectors count steps.");
+  cmd_region_step -> SetParameterName("Step",false);
+  cmd_region_step -> AvailableForStates(G4State_PreInit, G4State_Idle); 
+
+  cmd_stack_rule =  new G4UIcmdWithAString("/construction/stack_rule",this);
+  cmd_stack_rule -> SetGuidance("\"PARTICLE EMAX UNIT REGION ACTION\" rule of new secondaries: particle(* -- any)");
+  cmd_stack_rule -> SetGuidance("below EMAX(0 -- any energy) born in the region(* -- anywhere) gets ACTION:");
+  cmd_stack_rule -> SetGuidance("kill, waiting or urgent. The first matching rule is used, e.g. \"e- 1 MeV SHIELD kill\".");
+  cmd_stack_rule -> SetParameterName("Rule",false);
+  cmd_stack_rule -> AvailableForStates(G4State_PreInit, G4State_Idle); 
+
+  cmd_stack_clear =  new G4UIcmdWithoutParameter("/construction/stack_clear",this);
+  cmd_stack_clear -> SetGuidance("remove all stacking rules, all secondaries are tracked.");
+  cmd_stack_clear -> AvailableForStates(G4State_PreInit, G4State_Idle); 
     
   
 }
@@ -71,6 +190,25 @@ DetectorConstructionMessenger::~DetectorConstructionMessenger()
   delete cmd_histo_bins;
   delete cmd_histo_min;
   delete cmd_histo_max;
+  delete cmd_histo_log;
+  delete cmd_histo_edges;
+  delete cmd_histogramming;
+  delete cmd_raw_capture;
+  delete cmd_raw_format;
+  delete cmd_async_writer;
+  delete cmd_writer_queue;
+  delete cmd_importance_layers;
+  delete cmd_importance_geometric;
+  delete cmd_ww_generate;
+  delete cmd_ww_apply;
+  delete cmd_ww_mesh;
+  delete cmd_ww_energies;
+  delete cmd_ww_target;
+  delete cmd_ww_ratio;
+  delete cmd_region_cut;
+  delete cmd_region_step;
+  delete cmd_stack_rule;
+  delete cmd_stack_clear;
 
   delete valueDir;
 }
@@ -84,10 +222,54 @@ void DetectorConstructionMessenger::SetNewValue(G4UIcommand* command,G4String ne
   
   if(command == cmd_histo_min)
     detector -> set_histo_min
-      (cmd_histo_min -> GetNewDoubleValue(newValue));
+      (cmd_histo_min -> GetNewDoubleValue(newValue)/detector->hist_energy_unit_value());
   if(command == cmd_histo_max)
     detector -> set_histo_max
-      (cmd_histo_max -> GetNewDoubleValue(newValue));
+      (cmd_histo_max -> GetNewDoubleValue(newValue)/detector->hist_energy_unit_value());
+  if(command == cmd_histo_log)
+    detector -> set_histo_log
+      (cmd_histo_log -> GetNewBoolValue(newValue));
+  if(command == cmd_importance_layers)
+    detector -> set_importance_layers(newValue);
+  if(command == cmd_importance_geometric)
+    detector -> set_importance_geometric(newValue);
+  if(command == cmd_ww_generate)
+    detector -> set_ww_generate(newValue);
+  if(command == cmd_ww_apply)
+    detector -> set_ww_apply(newValue);
+  if(command == cmd_ww_mesh)
+    detector -> set_ww_mesh(newValue);
+  if(command == cmd_ww_energies)
+    detector -> set_ww_energies(newValue);
+  if(command == cmd_ww_target)
+    detector -> set_ww_target(newValue);
+  if(command == cmd_ww_ratio)
+    detector -> set_ww_ratio
+      (cmd_ww_ratio -> GetNewDoubleValue(newValue));
+  if(command == cmd_region_cut)
+    detector -> set_region_cut(newValue);
+  if(command == cmd_region_step)
+    detector -> set_region_step(newValue);
+  if(command == cmd_stack_rule)
+    detector -> set_stack_rule(newValue);
+  if(command == cmd_stack_clear)
+    detector -> clear_stack_rules();
+  if(command == cmd_histo_edges)
+    detector -> set_histo_edges(newValue);
+  if(command == cmd_histogramming)
+    detector -> set_histogramming
+      (cmd_histogramming -> GetNewBoolValue(newValue));
+  if(command == cmd_raw_capture)
+    detector -> set_raw_capture
+      (cmd_raw_capture -> GetNewBoolValue(newValue));
+  if(command == cmd_raw_format)
+    detector -> set_raw_format(newValue);
+  if(command == cmd_async_writer)
+    detector -> set_async_writing
+      (cmd_async_writer -> GetNewBoolValue(newValue));
+  if(command == cmd_writer_queue)
+    detector -> set_writer_queue_size
+      (cmd_writer_queue -> GetNewIntValue(newValue));
   
 }
 
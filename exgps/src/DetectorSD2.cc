@@ -30,31 +30,76 @@
 
 #include "DetectorSD2.hh"
 #include "RunAction.hh"
+#include "raw_file.h"
+#include "raw_writer.h"
 
 #include "G4RunManager.hh"
 #include "G4Step.hh"
+#include "G4ParticleTable.hh"
+#include "G4AutoLock.hh"
 #include <stdio.h>
 #include <stdlib.h>
+#include <math.h>
+#include <map>
+#include <string>
+#include <chrono>
 
 using namespace std;
 
+namespace
+{
+  /** serializes merging of worker threads' data into the master's detectors*/
+  G4Mutex mergeMutex = G4MUTEX_INITIALIZER;
+  /** serializes writing to the output files shared by all threads*/
+  G4Mutex fileMutex = G4MUTEX_INITIALIZER;
+
+  /** binary raw files stay open during the run, one per file name,
+      they're shared by all detectors and threads(guarded by fileMutex).*/
+  std::map<std::string, raw_file*> raw_files;
+
+  /** whether the batches go to the background writer thread*/
+  bool async_writing = true;
+
+  /** time spent by the event loop in save_vector(), guarded by statsMutex*/
+  G4Mutex statsMutex = G4MUTEX_INITIALIZER;
+  double flush_stall_time = 0;
+
+  /** deposited energy is summed per entered particle, see set_weighted_scoring()*/
+  bool weighted_scoring = false;
+}
+
 DetectorSD2::DetectorSD2(G4String name): G4VSensitiveDetector(name)
 {
   // получаем указатель на класс RunAction
   // мы будем вызывать его метод RunAction::FillHist
   // для заполнения гистограммы спектра поглощенной энергии
   runAction = (RunAction*) G4RunManager::GetRunManager()->GetUserRunAction();
-  d_energy_units=1;
+  set_energy_units(1);
   debug_output = false;
   temp_count = 0;
+  particle_definition = NULL;
   
   d_deposited_count = true;
+  d_histogramming = true;
+  d_raw_capture = false;
+  d_raw_format = RAW_FORMAT_TEXT;
+  d_hist_min = 0;
+  d_hist_max = 100000;
+  d_hist_bins = 200000;
+  d_hist_log = false;
+  d_event_score = 0;
+  reset_history_statistics();
 }
 
 DetectorSD2::~DetectorSD2() 
 {
-  named_vector_map_Ekin.clear();
-  named_vector_map_Edep.clear();
+  for(size_t i = 0; i < d_species.size(); i++)
+    {
+      if(d_species[i].Ekin_hist!=NULL) delete d_species[i].Ekin_hist;
+      if(d_species[i].Edep_hist!=NULL) delete d_species[i].Edep_hist;
+    }
+  d_species.clear();
+  d_species_by_id.clear();
 }
 
 void DetectorSD2::DisableDepositedEnergyCount()
@@ -68,10 +113,115 @@ void DetectorSD2::EnableDepositedEnergyCount()
   d_deposited_count = true;
 }
 
+/** Set histogram properties, the values are in the detector's energy units.*/
+void DetectorSD2::set_histo(const double min, const double max, const unsigned n_bins)
+{
+  d_hist_min = min;
+  d_hist_max = max;
+  if(d_hist_max < d_hist_min)
+    {
+      d_hist_max = min;  d_hist_min = max;
+    }
+  d_hist_bins = (n_bins > 0)? n_bins : 1;
+  configure_histograms();
+}
+
+void DetectorSD2::set_histo_log(const bool log)
+{
+  d_hist_log = log;
+  configure_histograms();
+}
+
+void DetectorSD2::set_histo_edges(const std::vector<double> &edges)
+{
+  d_hist_edges = edges;
+  configure_histograms();
+}
+
+/** Set the detector's bins to the histogram, counts are cleared.*/
+void DetectorSD2::configure_histogram(Hist1i *hist) const
+{
+  if(!d_hist_edges.empty() && hist->set_edges(d_hist_edges))
+    return;
+  if(d_hist_log && hist->set_log(d_hist_min, d_hist_max, d_hist_bins))
+    return;
+  hist->set(d_hist_min, d_hist_max, d_hist_bins);
+}
+
+/** configure_histogram() for all existing histograms.*/
+void DetectorSD2::configure_histograms()
+{
+  for(size_t i = 0; i < d_species.size(); i++)
+    {
+      if(d_species[i].Ekin_hist!=NULL)
+	configure_histogram(d_species[i].Ekin_hist);
+      if(d_species[i].Edep_hist!=NULL)
+	configure_histogram(d_species[i].Edep_hist);
+    }
+}
+
+/** Make a histogram with the detector's properties.*/
+Hist1i *DetectorSD2::new_histogram() const
+{
+  Hist1i *hist = new Hist1i(d_hist_min, d_hist_max, d_hist_bins);
+  if(!d_hist_edges.empty() || d_hist_log)
+    configure_histogram(hist);
+  return hist;
+}
+
+/** Add counts of other detector's histogram to own one.*/
+void DetectorSD2::merge_histogram(Hist1i *&to, Hist1i *from) const
+{
+  if(from == NULL) return;
+  if(to == NULL)
+    to = new_histogram();
+  if(from->has_sumw2() && !to->has_sumw2())
+    to->sumw2();
+  if(!to->add(*from))
+    {//the counts are kept, they're lost if cleared:
+      G4cerr << "DetectorSD2: " << G4VSensitiveDetector::SensitiveDetectorName
+	     << " histograms with different bins can't be merged, "
+	     << "the thread keeps it's counts\n";
+      return;
+    }
+  from->clear();
+}
+
+/** Copy all settings of other detector.*/
+void DetectorSD2::copy_settings(const DetectorSD2 *other)
+{
+  if(other == NULL || other == this) return;
+  d_deposited_count = other->d_deposited_count;
+  d_histogramming = other->d_histogramming;
+  d_raw_capture = other->d_raw_capture;
+  d_raw_format = other->d_raw_format;
+  debug_output = other->debug_output;
+  set_energy_units(other->d_energy_units);
+  d_hist_log = other->d_hist_log;
+  d_hist_edges = other->d_hist_edges;
+  set_histo(other->d_hist_min, other->d_hist_max, other->d_hist_bins);
+  //same species order:
+  for(size_t i = 0; i < other->d_species.size(); i++)
+    {
+      if(other->d_species[i].definition != NULL)
+	species_index(other->d_species[i].definition);
+      else
+	species_index_by_name(other->d_species[i].name);
+    }
+}
+
+void DetectorSD2::set_raw_format(const unsigned format)
+{
+  if(format <= RAW_FORMAT_FLOAT)
+    d_raw_format = format;
+}
+
 void DetectorSD2::Initialize(G4HCofThisEvent*)
 {
   // в начале события сбрасываем энергию поглощенную детектором
   detEnergy = 0;
+  d_event_score = 0;
+  branch_deposits.clear();
 }
 
 G4bool DetectorSD2::ProcessHits(G4Step* step, G4TouchableHistory*)
@@ -81,15 +231,22 @@ G4bool DetectorSD2::ProcessHits(G4Step* step, G4TouchableHistory*)
   // добавляем энергию потерянную частицей
   // к счетчику энергии детектора
   track = step->GetTrack();
-  this->particle_name = track->GetDefinition()->GetParticleName();  
+  this->particle_definition = track->GetDefinition();
   G4double edep = step->GetTotalEnergyDeposit();
   detEnergy += edep;
 
+  //Importance cells end at the hole, so nothing is split inside
+  //the detectors. Weight windows may split there, the copies add to
+  //their parent's branch with it's entered weight, so the pulse
+  //heights are not exact with windows over the detectors.
+  if(weighted_scoring)
+    branch_deposits.add(track, edep);
+
   if(debug_output)
     {
       G4cout<< "\n---\n"
 	    << G4VSensitiveDetector::SensitiveDetectorName
-	    << particle_name
+	    << particle_definition->GetParticleName()
 	    << " track Deposit energy: "<< edep/keV
 	    <<" part. kinetic energy(kev):" << track->GetKineticEnergy()/keV
 	    <<"\n";
@@ -102,31 +259,159 @@ void DetectorSD2::EndOfEvent(G4HCofThisEvent*)
 {
   // сохраняем энергию накопленную за событие в детекторе
   // в гистограмму
+  d_histories++;
+  d_score_sum += d_event_score;
+  d_score_sum2 += d_event_score*d_event_score;
+  d_event_score = 0;
+  if(weighted_scoring)
+    {
+      BranchDeposits::branch_map::const_iterator iter;
+      for(iter = branch_deposits.branches().begin();
+	  iter != branch_deposits.branches().end(); iter++)
+	if(iter->second.energy > 0)
+	  fill_hist_deposited(iter->second.definition, iter->second.energy,
+			      iter->second.weight);
+      return;
+    }
   if(detEnergy > 0)
-    fill_hist_deposited(particle_name, detEnergy);
+    fill_hist_deposited(particle_definition, detEnergy);
 }
 
+void DetectorSD2::set_weighted_scoring(const bool weighted)
+{
+  weighted_scoring = weighted;
+}
+
+bool DetectorSD2::is_weighted_scoring()
+{
+  return weighted_scoring;
+}
+
+void DetectorSD2::reset_history_statistics()
+{
+  d_histories = 0;
+  d_score_sum = 0;
+  d_score_sum2 = 0;
+}
+
+/** Print the statistics of the history scores and the figure of merit.*/
+void DetectorSD2::print_history_statistics(const double seconds) const
+{
+  G4cout << G4VSensitiveDetector::SensitiveDetectorName << ": " << d_histories
+	 << " histories, score per history ";
+  if(d_histories < 2 || d_score_sum <= 0)
+    {
+      G4cout << d_score_sum << "\n";
+      return;
+    }
+  const double n = d_histories;
+  const double mean = d_score_sum/n;
+  //variance of the mean, divided by mean^2:
+  double r2 = (d_score_sum2/n - mean*mean)/(n - 1)/(mean*mean);
+  if(r2 < 0) r2 = 0;
+  G4cout << mean << " +- " << 100*sqrt(r2) << "%";
+  if(seconds > 0 && r2 > 0)
+    G4cout << ", figure of merit 1/(R^2*T) = " << 1/(r2*seconds) << " 1/s";
+  G4cout << "\n";
+}
+
+/** Set energy units and the divider for energy values.*/
+void DetectorSD2::set_energy_units(const unsigned EUNIT)
+{
+  d_energy_units = EUNIT;
+  switch(d_energy_units)
+    {
+    case 0:  d_energy_unit_value = eV; break;
+    case 1:  d_energy_unit_value = keV; break;
+    case 2:  d_energy_unit_value = MeV; break;
+    default:
+      d_energy_unit_value = keV; break;
+    }
+}
+
+/** Add a new species to the buffers.
+    \return index of the species.*/
+size_t DetectorSD2::add_species(const G4ParticleDefinition *pdef, const G4String &pname)
+{
+  species_buffers new_species;
+  new_species.definition = pdef;
+  new_species.name = pname;
+  new_species.Ekin_hist = NULL;
+  new_species.Edep_hist = NULL;
+  d_species.push_back(new_species);
+  if(debug_output)
+    {
+      G4cout << G4VSensitiveDetector::SensitiveDetectorName.data() << "\t" << temp_count << "\t";
+      G4cout << "particle NOT FOUND [" << pname << "]\n";
+      G4cout << "Adding new species: " << pname.data() << "\n";
+    }
+  return d_species.size() - 1;
+}
+
+size_t DetectorSD2::find_species(const G4ParticleDefinition *pdef)
+{
+  size_t species = 0;
+  while(species < d_species.size() && d_species[species].definition != pdef)
+    species++;
+  if(species == d_species.size())
+    species = add_species(pdef, (pdef)? pdef->GetParticleName() : G4String("unknown"));
+  //IDs are given to the particles as they're made, so they're dense:
+  const G4int id = (pdef != NULL)? pdef->GetParticleDefinitionID() : -1;
+  if(id >= 0)
+    {
+      if((size_t)id >= d_species_by_id.size())
+	d_species_by_id.resize(id + 1, -1);
+      d_species_by_id[id] = species;
+    }
+  return species;
+}
+
+/** Find species by name(slow), add it if not found.
+    \return index of the species.*/
+size_t DetectorSD2::species_index_by_name(const G4String &pname)
+{
+  for(size_t i = 0; i < d_species.size(); i++)
+    if(d_species[i].name == pname) return i;
+  G4ParticleDefinition *pdef = G4ParticleTable::GetParticleTable()->FindParticle(pname);
+  if(pdef != NULL)
+    return species_index(pdef);
+  return add_species(NULL, pname);
+}
 
 /** Get known about particle type from given definition
     and add it's energy to certain histogram
     \param Pointer to particle definition
     \param Energy in keV units.
+    \param weight of the particle.
 */
-void DetectorSD2::fill_hist(const G4ParticleDefinition *pdef, const double energy)
+void DetectorSD2::fill_hist(const G4ParticleDefinition *pdef, const double energy,
+			    const double weight)
 {
   if(!pdef || energy < 0) return;
-  fill_hist(pdef->GetParticleName(), energy);
+  const size_t species = species_index(pdef);
+  const double value = energy/d_energy_unit_value;
+  if(debug_output)
+    {
+      G4cout << G4VSensitiveDetector::SensitiveDetectorName.data() << "\t" << temp_count << "\t";
+      G4cout << "fill_hist: particle found [" << d_species[species].name << "]\t";
+      G4cout << "Ekin value: " << value << "\n";
+    }
+  store_value(species, false, value, weight);
+  temp_count ++;
 }
 
 /** Get known about particle type from given definition
     and add it's energy to certain histogram
     \param Pointer to particle definition
     \param Energy in keV units.
+    \param weight of the particle.
 */
-void DetectorSD2::fill_hist_deposited(const G4ParticleDefinition *pdef, const double energy)
+void DetectorSD2::fill_hist_deposited(const G4ParticleDefinition *pdef, const double energy,
+				      const double weight)
 {
   if(!pdef || energy < 0) return;
-  fill_hist_deposited(pdef->GetParticleName(), energy);
+  const size_t species = species_index(pdef);
+  store_value(species, true, energy/d_energy_unit_value, weight);
 }
 
 /** Get known about particle type from given name
@@ -136,57 +421,10 @@ void DetectorSD2::fill_hist_deposited(const G4ParticleDefinition *pdef, const do
 */
 void DetectorSD2::fill_hist(const G4String &pname, const double energy, const unsigned EUNIT)
 {
-  if(EUNIT <= 2) d_energy_units = EUNIT;
+  if(EUNIT <= 2) set_energy_units(EUNIT);
   if(energy < 0) return;
-  double value = -1;
-  switch(d_energy_units)
-    {
-    case 0:  value = energy; break;
-    case 1:  value = (energy/keV); break;
-    case 2:  value = (energy/MeV); break;
-    default:
-      value = (energy/keV); break;
-    }
-  
-  the_iterator = named_vector_map_Ekin.find(pname);
-  if(the_iterator != named_vector_map_Ekin.end())
-    {//if the given particle name has been found:
-      if(debug_output)
-	{
-	
-	  G4cout << G4VSensitiveDetector::SensitiveDetectorName.data() << "\t" << temp_count << "\t";
-	  G4cout << "fill_hist: particle found [" << the_iterator->first << "]\t";
-	  G4cout << "Ekin value: " << value << "\n";
-	  G4cout << "vector size: "
-		 << the_iterator->second.size() << "\n";
-	}
-      the_iterator->second.push_back(value);
-      if(the_iterator->second.size() > MAX_BATCH_SIZE)
-	{
-	  save_Ekinetic(the_iterator);
-	}
-    }
-  else
-    {
-      std::vector <double> new_vec;
-      new_vec.push_back(value);
-      named_vector_map_Ekin.insert(pair<G4String, std::vector <double> >(pname, new_vec));
-
-      if(debug_output)
-	{
-	  G4cout << G4VSensitiveDetector::SensitiveDetectorName.data() << "\t" << temp_count << "\t";
-	  G4cout << "fill_hist: particle NOT FOUND [" << pname << "]\n";
-	  G4cout << "Adding new key: " << pname.data();
-	  G4cout << "\tEkin  value: " << value << "\n";
-	  the_iterator = named_vector_map_Ekin.find(pname);
-	  if(the_iterator != named_vector_map_Ekin.end())
-	    G4cout << "vector size: "
-		   << the_iterator->second.size() << "\n";
-	}
-      //if this type of particle meets first time
-      // -- then create a key and new vector for that
-    }
-  
+  const size_t species = species_index_by_name(pname);
+  store_value(species, false, energy/d_energy_unit_value);
   temp_count ++;
 }
 
@@ -199,51 +437,29 @@ void DetectorSD2::fill_hist_deposited(const G4String &pname,
 				      const double energy,
 				      const unsigned EUNIT)
 {
-  if(EUNIT <= 2) d_energy_units = EUNIT;
+  if(EUNIT <= 2) set_energy_units(EUNIT);
   if(energy < 0) return;
-  double value;
-  switch(d_energy_units)
-    {
-    case 0:  value = energy; break;
-    case 1:  value = (energy/keV); break;
-    case 2:  value = (energy/MeV); break;
-    default:
-      value = (energy/keV); break;
-    }
-  
-  the_iterator = named_vector_map_Edep.find(pname);
-  if(the_iterator != named_vector_map_Edep.end())
-    {//if the given particle name has been found:
-      the_iterator->second.push_back(value);
-      if(the_iterator->second.size() > MAX_BATCH_SIZE)
-	{
-	  save_Edeposited(the_iterator);
-	}
-    }
-  else
-    {
-      //if this type of particle meets first time
-      // -- then create a key and new vector for that
-      std::vector <double> new_vec;
-      new_vec.push_back(value);
-      named_vector_map_Edep.insert(pair<G4String, std::vector <double> >(pname, new_vec));
-    }
-			      
+  const size_t species = species_index_by_name(pname);
+  store_value(species, true, energy/d_energy_unit_value);
 }
   
 /** clear the vectors with raw spectra.*/
 void DetectorSD2::clear_raw_data()
 {
-  named_vector_map_Ekin.clear();
-  named_vector_map_Edep.clear();
+  for(size_t i = 0; i < d_species.size(); i++)
+    {
+      d_species[i].Ekin.clear();
+      d_species[i].Edep.clear();
+    }
 }
 
 /** Dump the data from vector to file.*/
 void DetectorSD2::dump_vector(const char *filename,
-			      std::vector<double> &vector, bool append ) const
+			      const std::vector<double> &vector, bool append )
 {
   if(filename!=NULL && (!vector.empty()))
     {
+      G4AutoLock lock(&fileMutex);
       char mode[3]; mode[2] = 0x00;
       memmove((void*)mode, (void*)((append)? "a+" : "w+"), 2);
       FILE *fp = fopen(filename, "a+");
@@ -256,87 +472,257 @@ void DetectorSD2::dump_vector(const char *filename,
     }
 }
 
-void DetectorSD2::save_Ekinetic(std::map<G4String, std::vector <double> >::iterator &named_particle_iterator, bool noclear)
+/** Append the data to the binary file, it stays open
+    until close_raw_files() is called.*/
+void DetectorSD2::dump_binary(raw_write_job &job)
 {
-  if(named_particle_iterator != (this->named_vector_map_Ekin.end())
-     && !named_vector_map_Ekin.empty())
+  if(job.values.empty()) return;
+  G4AutoLock lock(&fileMutex);
+  raw_file *&file = raw_files[job.filename];
+  if(file == NULL)
     {
-      G4String filename;
-      G4String sensDetName = G4VSensitiveDetector::SensitiveDetectorName;
-      //make filename:
-      filename += sensDetName + "_kinetic_" + named_particle_iterator->first;
-      
-      switch(d_energy_units)
+      raw_file_header header;
+      header.value_size = (job.format == RAW_FORMAT_FLOAT)?
+	sizeof(float) : sizeof(double);
+      header.energy_units = job.energy_units;
+      header.detector_name = job.detector_name;
+      header.species = job.species;
+      header.quantity = job.quantity;
+      file = new raw_file;
+      if(file->open_write(job.filename, header) != 0)
 	{
-	case 0:  filename += "_eV_unit.raw"; break;
-	case 1:  filename += "_keV_unit.raw"; break;
-	case 2:  filename +=  "_MeV_unit.raw"; break;
-	default:
-	  filename += "_keV_unit.raw"; break;
+	  G4cerr << "DetectorSD2: can't open file " << job.filename << "\n";
+	  delete file;
+	  file = NULL;
+	  raw_files.erase(job.filename);
+	  return;
 	}
+    }
+  if(file->write(&job.values[0], job.values.size()) != 0)
+    G4cerr << "DetectorSD2: write error in file " << job.filename << "\n";
+}
+
+/** Close all binary raw files and write the event counters.*/
+void DetectorSD2::close_raw_files(const unsigned long long events)
+{
+  drain_writer();
+  G4AutoLock lock(&fileMutex);
+  std::map<std::string, raw_file*>::iterator iter;
+  for(iter = raw_files.begin(); iter != raw_files.end(); iter++)
+    {
+      if(iter->second->close(events) != 0)
+	G4cerr << "DetectorSD2: error closing file " << iter->first << "\n";
+      delete iter->second;
+    }
+  raw_files.clear();
+}
+
+/** Write one batch to it's file, may be called by the writer thread.*/
+void DetectorSD2::write_raw_job(raw_write_job &job)
+{
+  if(job.format == RAW_FORMAT_TEXT)
+    dump_vector(job.filename.c_str(), job.values, true);
+  else
+    dump_binary(job);
+}
+
+/** The background writer thread common for all detectors.*/
+raw_writer &DetectorSD2::writer()
+{
+  static raw_writer the_writer(&DetectorSD2::write_raw_job, RAW_WRITER_QUEUE_SIZE,
+			       MAX_BATCH_SIZE + 1);
+  return the_writer;
+}
+
+void DetectorSD2::set_async_writing(const bool async)
+{
+  if(!async) drain_writer();
+  async_writing = async;
+}
+
+bool DetectorSD2::is_async_writing()
+{
+  return async_writing;
+}
+
+void DetectorSD2::set_writer_queue_size(const unsigned size)
+{
+  writer().set_queue_size(size);
+}
+
+void DetectorSD2::drain_writer()
+{
+  writer().finish();
+}
+
+double DetectorSD2::get_flush_stall_time(const bool reset)
+{
+  G4AutoLock lock(&statsMutex);
+  double result = flush_stall_time;
+  if(reset) flush_stall_time = 0;
+  return result;
+}
+
+/** Write the data to the raw file in the current format.*/
+void DetectorSD2::save_vector(const char *kind, const size_t species,
+			      std::vector<double> &vector, bool noclear) const
+{
+  if(vector.empty()) return;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  raw_write_job job;
+  job.filename = output_filename(kind, species).data();
+  job.format = d_raw_format;
+  job.energy_units = d_energy_units;
+  job.detector_name = G4VSensitiveDetector::SensitiveDetectorName.data();
+  job.species = d_species[species].name.data();
+  job.quantity = kind;
+  if(async_writing)
+    {
+      if(noclear)
+	{
+	  std::vector<double> copy(vector);
+	  writer().submit(job, copy);
+	}
+      else//tracking goes on into the spare buffer:
+	writer().submit(job, vector);
+    }
+  else
+    {
+      job.values.swap(vector);
+      write_raw_job(job);
+      job.values.swap(vector);
+      if(!noclear)
+	vector.clear();
+    }
+  std::chrono::duration<double> stall = std::chrono::steady_clock::now() - start;
+  G4AutoLock lock(&statsMutex);
+  flush_stall_time += stall.count();
+}
+
+/** Make output file name like: DET.NAME_kinetic_e-_keV_unit.raw
+    \param "kinetic" or "deposited"
+    \param index of the particle species.
+*/
+G4String DetectorSD2::output_basename(const char *kind, const size_t species) const
+{
+  G4String filename;
+  G4String sensDetName = G4VSensitiveDetector::SensitiveDetectorName;
+  //make filename:
+  filename += sensDetName + "_" + kind + "_" + d_species[species].name;
+      
+  switch(d_energy_units)
+    {
+    case 0:  filename += "_eV_unit"; break;
+    case 1:  filename += "_keV_unit"; break;
+    case 2:  filename +=  "_MeV_unit"; break;
+    default:
+      filename += "_keV_unit"; break;
+    }
+  return filename;
+}
+
+/** Make output file name like: DET.NAME_kinetic_e-_keV_unit.raw
+    \param "kinetic" or "deposited"
+    \param index of the particle species.
+*/
+G4String DetectorSD2::output_filename(const char *kind, const size_t species) const
+{
+  G4String filename = output_basename(kind, species);
+  filename += (d_raw_format == RAW_FORMAT_TEXT)? ".raw" : ".bin";
+  return filename;
+}
+
+void DetectorSD2::save_Ekinetic(const size_t species, bool noclear)
+{
+  if(species < d_species.size())
+    {
+      std::vector<double> &values = d_species[species].Ekin;
       if(debug_output)
 	{
 	  G4cout << "SAVING KINETIC ENERGY VEC:\n"
-		 << sensDetName.data()
+		 << G4VSensitiveDetector::SensitiveDetectorName.data()
 		 << "\tparticle category: " 
-		 << named_particle_iterator->first.data()
+		 << d_species[species].name.data()
 		 << "\t N values: "
-		 << named_particle_iterator->second.size() << "\n------\n";
+		 << values.size() << "\n------\n";
 	}
       //--write raw particle's energies
-      dump_vector(filename, named_particle_iterator->second, true);
-      //clear vector:
-      if( !noclear)
-	named_particle_iterator->second.clear();
+      save_vector("kinetic", species, values, noclear);
     }
 
 }
 
-void DetectorSD2::save_Edeposited(std::map<G4String, std::vector <double> >::iterator &named_particle_iterator, bool noclear)
+void DetectorSD2::save_Edeposited(const size_t species, bool noclear)
 {
-  if(named_particle_iterator != this->named_vector_map_Edep.end()
-     && !named_vector_map_Edep.empty())
+  if(species < d_species.size())
     {
-      G4String filename;
-      G4String sensDetName = G4VSensitiveDetector::SensitiveDetectorName;
-      //make filename:
-      filename += sensDetName + "_deposited_" + named_particle_iterator->first;
-      
-      switch(d_energy_units)
-	{
-	case 0:  filename += "_eV_unit.raw"; break;
-	case 1:  filename += "_keV_unit.raw"; break;
-	case 2:  filename +=  "_MeV_unit.raw"; break;
-	default:
-	  filename += "_keV_unit.raw"; break;
-	}
+      std::vector<double> &values = d_species[species].Edep;
       if(debug_output)
 	{
 	  G4cout << "SAVING DEPOSITED ENERGY VEC:\n"
-		 << sensDetName.data()
+		 << G4VSensitiveDetector::SensitiveDetectorName.data()
 		 << "\tparticle category: " 
-		 << named_particle_iterator->first.data()
+		 << d_species[species].name.data()
 		 << "\t N values: "
-		 << named_particle_iterator->second.size() << "\n------\n";
+		 << values.size() << "\n------\n";
 	}
       //--write raw particle's energies
-      dump_vector(filename, named_particle_iterator->second, true);
-      if( !noclear)
-	named_particle_iterator->second.clear();
+      save_vector("deposited", species, values, noclear);
     }
 }
 
 
-void DetectorSD2::save_all()
+/** Save histograms of all species.*/
+void DetectorSD2::save_histograms()
 {
-  for(the_iterator = named_vector_map_Ekin.begin(); 
-      the_iterator != named_vector_map_Ekin.end(); the_iterator++)
+  for(size_t i = 0; i < d_species.size(); i++)
     {
-      save_Ekinetic(the_iterator);
+      G4String banner = G4VSensitiveDetector::SensitiveDetectorName + " "
+	+ d_species[i].name;
+      if(d_species[i].Ekin_hist!=NULL)
+	d_species[i].Ekin_hist->save(output_basename("kinetic", i) + "_hist",
+				     banner + " kinetic");
+      if(d_species[i].Edep_hist!=NULL)
+	d_species[i].Edep_hist->save(output_basename("deposited", i) + "_hist",
+				     banner + " deposited");
     }
-  for(the_iterator = named_vector_map_Edep.begin(); 
-      the_iterator != named_vector_map_Edep.end(); the_iterator++)
+}
+
+void DetectorSD2::save_all()
+{
+  for(size_t i = 0; i < d_species.size(); i++)
+    save_Ekinetic(i);
+  for(size_t i = 0; i < d_species.size(); i++)
+    save_Edeposited(i);
+  save_histograms();
+}
+
+/** Move the data collected by other detector into this one.*/
+void DetectorSD2::merge(DetectorSD2 *other)
+{
+  if(other == NULL || other == this) return;
+  G4AutoLock lock(&mergeMutex);
+  d_histories += other->d_histories;
+  d_score_sum += other->d_score_sum;
+  d_score_sum2 += other->d_score_sum2;
+  other->reset_history_statistics();
+  for(size_t i = 0; i < other->d_species.size(); i++)
     {
-      save_Edeposited(the_iterator);
+      species_buffers &from = other->d_species[i];
+      //particle definitions are shared by all threads:
+      const size_t species = (from.definition != NULL)?
+	species_index(from.definition) : species_index_by_name(from.name);
+      std::vector<double> &Ekin = d_species[species].Ekin;
+      std::vector<double> &Edep = d_species[species].Edep;
+      Ekin.insert(Ekin.end(), from.Ekin.begin(), from.Ekin.end());
+      Edep.insert(Edep.end(), from.Edep.begin(), from.Edep.end());
+      from.Ekin.clear();
+      from.Edep.clear();
+      merge_histogram(d_species[species].Ekin_hist, from.Ekin_hist);
+      merge_histogram(d_species[species].Edep_hist, from.Edep_hist);
+      if(Ekin.size() > MAX_BATCH_SIZE)
+	save_Ekinetic(species);
+      if(Edep.size() > MAX_BATCH_SIZE)
+	save_Edeposited(species);
     }
 }
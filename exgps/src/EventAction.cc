@@ -30,6 +30,7 @@
 #include "EventAction.hh"
 #include "G4Event.hh"
 #include "G4EventManager.hh"
+#include "WeightWindowGenerator.hh"
 
 
 #include "G4TrajectoryContainer.hh"
@@ -40,6 +41,7 @@
 EventAction::EventAction() : G4UserEventAction()
 {
   count = 0;
+  ww_generator = NULL;
 }
 
  
@@ -48,7 +50,10 @@ EventAction::~EventAction()
 
  
 void EventAction::BeginOfEventAction(const G4Event*)
-{}
+{
+  if(ww_generator != NULL)
+    ww_generator->begin_event();
+}
 
  
 void EventAction::EndOfEventAction(const G4Event* evt)
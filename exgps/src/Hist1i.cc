@@ -35,9 +35,40 @@ using namespace std;
 Hist1i::Hist1i(double mi, double ma, int n)
 : min(mi), max(ma), nbins(n)
 {
+  mode = linear;
   h = (max-min)/nbins;
-  hist = new int[nbins];
-  for (int i=0; i<nbins; i++) hist[i] = 0;
+  inv_h = 1./h;
+  log_min = 0;
+  inv_cell = 0;
+  track_w2 = false;
+  allocate();
+}
+
+/** Histogram with the given bin edges, see set_edges().*/
+Hist1i::Hist1i(const vector<double> &bin_edges)
+: min(0), max(1), nbins(1)
+{
+  mode = linear;
+  h = 1;
+  inv_h = 1;
+  log_min = 0;
+  inv_cell = 0;
+  track_w2 = false;
+  if(!set_edges(bin_edges))
+    allocate();
+}
+
+/** Allocate and clear the bins array.*/
+void Hist1i::allocate()
+{
+  hist.assign((nbins > 0)? nbins : 0, 0.);
+  hist_w2.clear();
+  if(track_w2)
+    hist_w2.assign(hist.size(), 0.);
+  under = over = 0;
+  under_w2 = over_w2 = 0;
+  n_entries = 0;
+  sum_w = sum_wx = sum_wx2 = 0;
 }
 
 /** Set histogram properties.
@@ -53,72 +84,195 @@ void Hist1i::set(const double a_min, const double a_max, const int a_bins)
   
   if(max<min){max = a_min; min = a_max;}
   
+  mode = linear;
   h = (max-min)/nbins;
-  if(hist!=NULL && nbins>0)
-    delete hist;
-  else
-    return;
-  
-  hist = new int[nbins];
-  for (int i=0; i<nbins; i++) hist[i] = 0;
-  
+  inv_h = 1./h;
+  edges.clear();
+  lookup.clear();
+  allocate();
+}
+
+/** Set bins of equal width in log(x).*/
+bool Hist1i::set_log(const double a_min, const double a_max, const int a_bins)
+{
+  double lo = (a_min < a_max)? a_min : a_max;
+  double hi = (a_min < a_max)? a_max : a_min;
+  if(lo <= 0 || a_bins <= 0)
+    return false;
+  min = lo;
+  max = hi;
+  nbins = a_bins;
+  mode = logarithmic;
+  log_min = log(min);
+  h = (log(max) - log_min)/nbins;
+  inv_h = 1./h;
+  edges.clear();
+  lookup.clear();
+  allocate();
+  return true;
+}
+
+/** Set bins by their edges.*/
+bool Hist1i::set_edges(const vector<double> &bin_edges)
+{
+  if(bin_edges.size() < 2)
+    return false;
+  for(size_t i = 1; i < bin_edges.size(); i++)
+    if(!(bin_edges[i-1] < bin_edges[i]))
+      return false;
+  edges = bin_edges;
+  nbins = edges.size() - 1;
+  min = edges.front();
+  max = edges.back();
+  mode = variable;
+  h = (max-min)/nbins;
+  inv_h = 1./h;
+  make_lookup();
+  allocate();
+  return true;
+}
+
+/** Build the lookup table of variable bins.*/
+void Hist1i::make_lookup()
+{
+  //few cells per bin, so that mostly one or two edges are searched:
+  const int n_cells = 4*nbins;
+  const double cell = (max-min)/n_cells;
+  inv_cell = 1./cell;
+  lookup.resize(n_cells + 1);
+  int i = 0;
+  for(int c = 0; c < n_cells; c++)
+    {
+      const double x = min + c*cell;
+      while(i+1 < nbins && edges[i+1] <= x) i++;
+      lookup[c] = i;
+    }
+  lookup[n_cells] = nbins - 1;
+}
+
+void Hist1i::sumw2(const bool enable)
+{
+  track_w2 = enable;
+  if(!track_w2)
+    hist_w2.clear();
+  else if(hist_w2.size() != hist.size())
+    hist_w2 = hist;//entries made so far had weight 1(hopefully)
 }
 
 void Hist1i::clear()
 {
-  if(hist!=NULL)
-    for (int i=0; i<nbins; i++) hist[i] = 0;
+  allocate();
+}
+
+bool Hist1i::add(const Hist1i &other)
+{
+  return add(other, 1.);
+}
+
+bool Hist1i::add(const Hist1i &other, const double factor)
+{
+  if(other.nbins != nbins || other.min != min || other.max != max
+     || other.mode != mode || other.edges != edges
+     || hist.size() != other.hist.size())
+    return false;
+  const double factor2 = factor*factor;
+  for (size_t i=0; i<hist.size(); i++) hist[i] += factor*other.hist[i];
+  if(track_w2)
+    {
+      if(other.track_w2)
+	for (size_t i=0; i<hist_w2.size(); i++) hist_w2[i] += factor2*other.hist_w2[i];
+      else
+	for (size_t i=0; i<hist_w2.size(); i++) hist_w2[i] += factor2*other.hist[i];
+    }
+  under += factor*other.under;
+  over += factor*other.over;
+  under_w2 += factor2*other.under_w2;
+  over_w2 += factor2*other.over_w2;
+  n_entries += other.n_entries;
+  sum_w += factor*other.sum_w;
+  sum_wx += factor*other.sum_wx;
+  sum_wx2 += factor*other.sum_wx2;
+  return true;
 }
 
 Hist1i::~Hist1i()
 {
-  if(hist!=NULL) delete [] hist;
 }
 
 void Hist1i::fill(double x)
 {
-  if ((min<=x)&&(x<=max)) {
-    int i = int((x - min)/h);
-    hist[i]++;
-  }
+  fill(x, 1.);
+}
+
+double Hist1i::bin_error(const int i) const
+{
+  return sqrt((track_w2)? hist_w2[i] : fabs(hist[i]));
 }
 
 void Hist1i::save(string fname, string banner)
 {
-  // ofstream f(fname.data());
-  // f << banner << "\n";
-  // for (int i=0; i<nbins; i++)
-  //   f << bin(i) << "\t" << hist[i] << "\n";
-  // f.close();
-  
   string dat_name = fname;
   dat_name.append(".dat");
   ofstream fdat;
   fdat.open(dat_name.c_str(), std::iostream::out);
   for (int i=0; i<nbins; i++)
-    if(hist[i]>0)
-      fdat << bin(i) << "\t" << hist[i] << "\n";
+    if(hist[i]!=0)
+      {
+	fdat << bin(i) << "\t";
+	//whole counts are written like integers, even the large ones:
+	if(hist[i] == floor(hist[i]) && fabs(hist[i]) < 9.0e15)
+	  fdat << (long long)hist[i];
+	else
+	  {
+	    fdat.precision(15);
+	    fdat << hist[i];
+	    fdat.precision(6);
+	  }
+	if(track_w2)
+	  fdat << "\t" << bin_error(i);
+	fdat << "\n";
+      }
   fdat.close();
-    
+
+  string stat_name = fname;
+  stat_name.append(".stat");
+  ofstream fstat;
+  fstat.open(stat_name.c_str(), std::iostream::out);
+  double mean, rms;
+  statistics(mean, rms);
+  fstat.precision(15);
+  fstat << banner << "\n"
+	<< "entries\t" << n_entries << "\n"
+	<< "sum_of_weights\t" << sum_w << "\n"
+	<< "underflow\t" << under << "\n"
+	<< "overflow\t" << over << "\n"
+	<< "mean\t" << mean << "\n"
+	<< "rms\t" << rms << "\n";
+  fstat.close();
 }
 
 void Hist1i::statistics(double& mean, double& rms)
 {
-  double N = 0.;
-  double Sx = 0.;
-  double Sx2 = 0.;
-  for (int i=0; i<nbins; i++) {
-    N   += hist[i];
-    Sx  += hist[i]*bin(i);
-    Sx2 += hist[i]*bin(i)*bin(i);
-  }
-	
-  mean = Sx/N;
-  rms = sqrt(Sx2/N - mean*mean);
+  if(sum_w == 0)
+    {
+      mean = rms = 0;
+      return;
+    }
+  mean = sum_wx/sum_w;
+  const double variance = sum_wx2/sum_w - mean*mean;
+  rms = (variance > 0)? sqrt(variance) : 0;
 }
 
+/** \return center of the bin, geometric one for logarithmic bins.*/
 double Hist1i::bin(int i)
 {
-  return min + (i + .5)*h;
+  switch(mode)
+    {
+    case logarithmic:
+      return exp(log_min + (i + .5)*h);
+    case variable:
+      return .5*(edges[i] + edges[i+1]);
+    default:
+      return min + (i + .5)*h;
+    }
 }
-
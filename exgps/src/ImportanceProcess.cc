@@ -0,0 +1,81 @@
+/* ========================================================== */
+// Part of simulation for use with GEANT4 code.
+// Importance splitting and russian roulette in the layers of the shield.
+//
+// Taras Schevchenko National University of Kyiv, 2012.
+/* ========================================================== */
+
+#include "ImportanceProcess.hh"
+
+#include "G4Track.hh"
+#include "G4Step.hh"
+#include "G4StepPoint.hh"
+
+#include <math.h>
+
+std::vector<double> ImportanceProcess::importances;
+G4ThreeVector ImportanceProcess::box_center;
+G4ThreeVector ImportanceProcess::box_outer;
+G4ThreeVector ImportanceProcess::box_hole;
+bool ImportanceProcess::box_is_set = false;
+
+ImportanceProcess::ImportanceProcess(): SplitRoulette("importance")
+{
+}
+
+ImportanceProcess::~ImportanceProcess()
+{
+}
+
+void ImportanceProcess::set_box(const G4ThreeVector &center, const G4ThreeVector &outer,
+				const G4ThreeVector &hole)
+{
+  box_center = center;
+  box_outer = outer;
+  box_hole = hole;
+  box_is_set = true;
+}
+
+bool ImportanceProcess::set_importances(const std::vector<double> &layers)
+{
+  for(size_t i = 0; i < layers.size(); i++)
+    if(!(layers[i] > 0)) return false;
+  importances = layers;
+  return true;
+}
+
+size_t ImportanceProcess::cell(const G4ThreeVector &position)
+{
+  const G4ThreeVector r = position - box_center;
+  //depth of the point in the wall: 0 on the hole's surface, 1 on the outer one
+  double depth = -1;
+  for(int axis = 0; axis < 3; axis++)
+    {
+      const double wall = box_outer[axis] - box_hole[axis];
+      const double q = (fabs(r[axis]) - box_hole[axis])/wall;
+      if(q > depth) depth = q;
+    }
+  const size_t n_layers = importances.size();
+  if(depth < 0) return n_layers + 1;
+  if(depth >= 1) return 0;
+  const size_t from_hole = (size_t)(depth*n_layers);
+  return n_layers - ((from_hole < n_layers)? from_hole : n_layers - 1);
+}
+
+double ImportanceProcess::importance(const size_t cell)
+{
+  if(cell == 0 || importances.empty()) return 1.0;
+  if(cell > importances.size()) return importances.back();
+  return importances[cell - 1];
+}
+
+void ImportanceProcess::bias(const G4Track &track, const G4Step &step)
+{
+  const size_t from = cell(step.GetPreStepPoint()->GetPosition());
+  const size_t to = cell(step.GetPostStepPoint()->GetPosition());
+  if(from == to)
+    return;
+  //the window is the weight the particle should have in the new cell:
+  const double weight = track.GetWeight()*importance(from)/importance(to);
+  apply(track, weight, weight, weight);
+}
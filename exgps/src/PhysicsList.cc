@@ -12,6 +12,7 @@
 #include "G4ParticleTypes.hh"
 #include "G4ParticleDefinition.hh"
 #include "globals.hh"
+#include "G4Threading.hh"
 
 PhysicsList::PhysicsList(): G4VUserPhysicsList()
 {
@@ -38,6 +39,8 @@ void PhysicsList::ConstructProcess()
   AddTransportation();
   // электромагнитные взаимодействия (создаем сами)
   ConstructEM();
+  // расщепление и рулетка в слоях защиты
+  ConstructImportance();
 }
 
 // standart EM
@@ -52,6 +55,7 @@ void PhysicsList::ConstructProcess()
 #include "G4eMultipleScattering.hh"
 
 #include "G4UrbanMscModel93.hh"
+#include "G4StepLimiter.hh"
 
 void PhysicsList::ConstructEM()
 {
@@ -75,6 +79,8 @@ void PhysicsList::ConstructEM()
       pmanager->AddProcess(msc,                     -1, 1, 1);      
       pmanager->AddProcess(new G4eIonisation,       -1, 2,2);
       pmanager->AddProcess(new G4eBremsstrahlung,   -1, 3,3);      
+      // ограничение шага в регионах(DetectorConstruction::set_region_step)
+      pmanager->AddDiscreteProcess(new G4StepLimiter);
 
     } else if (particleName == "e+") {
       G4eMultipleScattering* msc = new G4eMultipleScattering();
@@ -84,13 +90,35 @@ void PhysicsList::ConstructEM()
       pmanager->AddProcess(new G4eIonisation,       -1, 2,2);
       pmanager->AddProcess(new G4eBremsstrahlung,   -1, 3,3);
       pmanager->AddProcess(new G4eplusAnnihilation,  0,-1,4);
+      pmanager->AddDiscreteProcess(new G4StepLimiter);
     }
   }
 }
 
+#include "ImportanceProcess.hh"
+#include "WeightWindowProcess.hh"
+
+/** Every particle gets it's own ImportanceProcess and WeightWindowProcess,
+    they do nothing until the importances or the windows are set.*/
+void PhysicsList::ConstructImportance()
+{
+  theParticleIterator->reset();
+  while ( (*theParticleIterator)() ) {
+    G4ProcessManager* pmanager = theParticleIterator->value()->GetProcessManager();
+    if (pmanager != NULL)
+      {
+	pmanager->AddDiscreteProcess(new ImportanceProcess);
+	pmanager->AddDiscreteProcess(new WeightWindowProcess);
+      }
+  }
+}
+
 void PhysicsList::SetCuts()
 {
   // default cut value for all particle types 
   SetCutsWithDefault();
+  // materials, cuts and processes are known now, look for their tables:
+  if(G4Threading::IsMasterThread())
+    table_cache.prepare(this);
 }
 
@@ -0,0 +1,324 @@
+/* ========================================================== */
+// Part of simulation for use with GEANT4 code.
+// Cache of the physics tables between runs of the program.
+//
+// Taras Schevchenko National University of Kyiv, 2012.
+/* ========================================================== */
+
+#include "PhysicsTableCache.hh"
+
+#include "G4VUserPhysicsList.hh"
+#include "G4Material.hh"
+#include "G4Element.hh"
+#include "G4RegionStore.hh"
+#include "G4Region.hh"
+#include "G4ProductionCuts.hh"
+#include "G4ProductionCutsTable.hh"
+#include "G4ParticleTable.hh"
+#include "G4ParticleDefinition.hh"
+#include "G4ProcessManager.hh"
+#include "G4ProcessVector.hh"
+#include "G4VProcess.hh"
+#include "G4VEmProcess.hh"
+#include "G4VEnergyLossProcess.hh"
+#include "G4VMultipleScattering.hh"
+#include "G4VEmModel.hh"
+#include "G4Version.hh"
+#if G4VERSION_NUMBER >= PHYSICS_CACHE_MIN_G4VERSION
+#include "G4EmParameters.hh"
+#endif
+
+#include <sstream>
+#include <fstream>
+#include <iomanip>
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+namespace
+{
+  /** FNV-1a hash of the key, it only names the directory:
+      the key itself is compared when an entry is used.*/
+  unsigned long long key_hash(const G4String &key)
+  {
+    unsigned long long hash = 14695981039346656037ULL;
+    for(size_t i = 0; i < key.size(); i++)
+      {
+	hash ^= (unsigned char)key[i];
+	hash *= 1099511628211ULL;
+      }
+    return hash;
+  }
+
+  G4bool is_directory(const G4String &path)
+  {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+  }
+
+  /** Remove the directory with the files in it, entries have no subdirectories.*/
+  void remove_directory(const G4String &path)
+  {
+    DIR *dir = opendir(path.c_str());
+    if(dir == NULL) return;
+    struct dirent *entry;
+    while((entry = readdir(dir)) != NULL)
+      {
+	const G4String name = entry->d_name;
+	if(name == "." || name == "..") continue;
+	unlink((path + "/" + name).c_str());
+      }
+    closedir(dir);
+    rmdir(path.c_str());
+  }
+}
+
+PhysicsTableCache::PhysicsTableCache()
+{
+  //the user chooses the directory, nothing is written without it:
+  const char *path = getenv(PHYSICS_CACHE_ENV);
+  if(path != NULL)
+    root = path;
+  if(root == "off")
+    root = "";
+#if G4VERSION_NUMBER < PHYSICS_CACHE_MIN_G4VERSION
+  if(!root.empty())
+    G4cout << "Physics table cache: (warning) needs Geant4 10.2 or newer, it's off.\n";
+  root = "";
+#endif
+}
+
+G4String PhysicsTableCache::make_key()
+{
+  std::ostringstream key;
+  key << std::setprecision(17);
+  key << "exgps physics table cache " << PHYSICS_CACHE_VERSION << "\n";
+  key << "geant4 " << G4Version << "\n";
+
+  const G4MaterialTable *materials = G4Material::GetMaterialTable();
+  for(size_t i = 0; i < materials->size(); i++)
+    {
+      const G4Material *material = (*materials)[i];
+      key << "material " << material->GetName()
+	  << " density " << material->GetDensity()
+	  << " state " << (int)material->GetState()
+	  << " temperature " << material->GetTemperature()
+	  << " pressure " << material->GetPressure() << "\n";
+      const G4double *fractions = material->GetFractionVector();
+      for(size_t k = 0; k < material->GetNumberOfElements(); k++)
+	{
+	  const G4Element *element = material->GetElement(k);
+	  key << "  element " << element->GetName() << " Z " << element->GetZ()
+	      << " A " << element->GetA() << " fraction " << fractions[k] << "\n";
+	}
+    }
+
+  const G4ProductionCutsTable *cuts_table = G4ProductionCutsTable::GetProductionCutsTable();
+  key << "cuts energy range " << cuts_table->GetLowEdgeEnergy()
+      << " " << cuts_table->GetHighEdgeEnergy() << "\n";
+  const G4RegionStore *regions = G4RegionStore::GetInstance();
+  for(size_t i = 0; i < regions->size(); i++)
+    {
+      const G4Region *region = (*regions)[i];
+      key << "region " << region->GetName();
+      const G4ProductionCuts *cuts = region->GetProductionCuts();
+      if(cuts != NULL)
+	for(G4int k = 0; k < 4; k++)
+	  key << " " << cuts->GetProductionCut(k);
+      key << "\n";
+    }
+
+#if G4VERSION_NUMBER >= PHYSICS_CACHE_MIN_G4VERSION
+  //msc range factor, energy limits, fluctuations etc. change the tables:
+  key << "em parameters\n" << *G4EmParameters::Instance() << "\n";
+#endif
+
+  G4ParticleTable *particles = G4ParticleTable::GetParticleTable();
+  for(G4int i = 0; i < particles->entries(); i++)
+    {
+      const G4ParticleDefinition *particle = particles->GetParticle(i);
+      const G4ProcessManager *manager = particle->GetProcessManager();
+      if(manager == NULL) continue;
+      const G4ProcessVector *processes = manager->GetProcessList();
+      key << "particle " << particle->GetParticleName() << ":";
+      for(G4int k = 0; k < processes->entries(); k++)
+	key << " " << (*processes)[k]->GetProcessName();
+      key << "\n";
+    }
+  return key.str();
+}
+
+G4String PhysicsTableCache::make_models()
+{
+  std::ostringstream models;
+  models << std::setprecision(17);
+  G4ParticleTable *particles = G4ParticleTable::GetParticleTable();
+  for(G4int i = 0; i < particles->entries(); i++)
+    {
+      const G4ParticleDefinition *particle = particles->GetParticle(i);
+      const G4ProcessManager *manager = particle->GetProcessManager();
+      if(manager == NULL) continue;
+      const G4ProcessVector *processes = manager->GetProcessList();
+      for(G4int k = 0; k < processes->entries(); k++)
+	{
+	  G4VProcess *process = (*processes)[k];
+	  const G4VEmProcess *em = dynamic_cast<const G4VEmProcess*>(process);
+	  const G4VEnergyLossProcess *loss = dynamic_cast<const G4VEnergyLossProcess*>(process);
+	  const G4VMultipleScattering *msc = dynamic_cast<const G4VMultipleScattering*>(process);
+	  if(em == NULL && loss == NULL && msc == NULL) continue;
+	  models << particle->GetParticleName() << " " << process->GetProcessName() << ":";
+	  //the model managers return NULL past the last model:
+	  for(G4int m = 0; ; m++)
+	    {
+	      const G4VEmModel *model = (em != NULL)? em->GetModelByIndex(m)
+		: (loss != NULL)? loss->GetModelByIndex(m) : msc->GetModelByIndex(m);
+	      if(model == NULL) break;
+	      models << " " << model->GetName() << " [" << model->LowEnergyLimit()
+		     << ", " << model->HighEnergyLimit() << "]";
+	    }
+	  models << "\n";
+	}
+    }
+  return models.str();
+}
+
+G4String PhysicsTableCache::entry_directory(const G4String &key) const
+{
+  char name[32];
+  snprintf(name, sizeof(name), "%016llx", key_hash(key));
+  return root + "/" + name;
+}
+
+G4bool PhysicsTableCache::is_valid_entry(const G4String &dir, const G4String &key) const
+{
+  std::ifstream file((dir + "/" + PHYSICS_CACHE_KEY_FILE).c_str());
+  if(!file.good()) return false;
+  std::ostringstream stored;
+  stored << file.rdbuf();
+  return stored.str() == key;
+}
+
+G4String PhysicsTableCache::read_models(const G4String &dir) const
+{
+  std::ifstream file((dir + "/" + PHYSICS_CACHE_MODELS_FILE).c_str());
+  std::ostringstream stored;
+  if(file.good())
+    stored << file.rdbuf();
+  return stored.str();
+}
+
+void PhysicsTableCache::prepare(G4VUserPhysicsList *physics)
+{
+  if(!is_enabled()) return;
+  const G4String key = make_key();
+  const G4String dir = entry_directory(key);
+  prepared_key = key;
+  retrieve_key = "";
+  if(!is_directory(dir))
+    {
+      G4cout << "Physics table cache: no entry " << dir << ", tables will be built and stored.\n";
+      return;
+    }
+  if(!is_valid_entry(dir, key))
+    {
+      G4cout << "Physics table cache: entry " << dir
+	     << " is stale or incomplete, tables will be rebuilt.\n";
+      return;
+    }
+  G4cout << "Physics table cache: retrieving tables from " << dir << "\n";
+  physics->SetPhysicsTableRetrieved(dir);
+  retrieve_key = key;
+}
+
+G4bool PhysicsTableCache::store(G4VUserPhysicsList *physics, const G4String &key,
+				const G4String &models)
+{
+  const G4String dir = entry_directory(key);
+  std::ostringstream tmp;
+  tmp << dir << ".tmp." << getpid();
+  const G4String tmp_dir = tmp.str();
+  if(mkdir(root.c_str(), 0755) != 0 && errno != EEXIST)
+    return false;
+  remove_directory(tmp_dir);
+  if(mkdir(tmp_dir.c_str(), 0755) != 0)
+    return false;
+  G4bool ok = physics->StorePhysicsTable(tmp_dir);
+  if(ok)
+    {
+      std::ofstream file((tmp_dir + "/" + PHYSICS_CACHE_MODELS_FILE).c_str());
+      file << models;
+      file.close();
+      ok = !file.fail();
+    }
+  if(ok)
+    {//the key goes last, an entry without it is never used:
+      std::ofstream file((tmp_dir + "/" + PHYSICS_CACHE_KEY_FILE).c_str());
+      file << key;
+      file.close();
+      ok = !file.fail();
+    }
+  if(ok && is_directory(dir))
+    {//stale entry with the same hash, or another job was faster:
+      if(is_valid_entry(dir, key))
+	{
+	  remove_directory(tmp_dir);
+	  return true;
+	}
+      const G4String trash = tmp_dir + ".old";
+      if(rename(dir.c_str(), trash.c_str()) == 0)
+	remove_directory(trash);
+    }
+  if(ok)
+    ok = (rename(tmp_dir.c_str(), dir.c_str()) == 0) || is_valid_entry(dir, key);
+  if(!ok)
+    remove_directory(tmp_dir);
+  return ok;
+}
+
+void PhysicsTableCache::update(G4VUserPhysicsList *physics)
+{
+  if(!is_enabled()) return;
+  const G4String key = make_key();
+  if(key == done_key) return;
+  const G4String models = make_models();
+  if(key != prepared_key)
+    {//the entry was chosen at /run/initialize by the key of that moment:
+      G4cout << "Physics table cache: (warning) materials, cuts, EM parameters or processes"
+	     << " changed after /run/initialize(e.g. by /construction/region_cut), the key of"
+	     << (retrieve_key.empty()? " the lookup" : " the retrieved entry")
+	     << " is stale. Tables are not stored, make such changes before"
+	     << " /run/initialize to use the cache.\n";
+    }
+  else if(!retrieve_key.empty() && physics->IsPhysicsTableRetrieved())
+    {
+      const G4String dir = entry_directory(key);
+      if(read_models(dir) == models)
+	G4cout << "Physics table cache: tables were retrieved from " << dir << "\n";
+      else
+	{//PhysicsList was changed without PHYSICS_CACHE_VERSION:
+	  remove_directory(dir);
+	  G4Exception("PhysicsTableCache::update", "exgps_cache01", RunMustBeAborted,
+		      ("the entry " + dir + " was made by other models of the EM processes,"
+		       " the retrieved tables are wrong; the entry is removed,"
+		       " run the program again.").c_str());
+	}
+    }
+  else
+    {
+      if(!retrieve_key.empty())
+	G4cout << "Physics table cache: Geant4 did not accept the entry "
+	       << entry_directory(retrieve_key) << ", tables were rebuilt.\n";
+      if(store(physics, key, models))
+	G4cout << "Physics table cache: tables are stored to " << entry_directory(key) << "\n";
+      else
+	G4cout << "Physics table cache: (warning) can't store tables to "
+	       << entry_directory(key) << "\n";
+    }
+  //tables of the next runs are built, not retrieved, unless the key is the same:
+  physics->ResetPhysicsTableRetrieved();
+  retrieve_key = "";
+  done_key = key;
+}
@@ -34,6 +34,7 @@
 #include "G4ParticleTable.hh"
 #include "G4ParticleDefinition.hh"
 #include "G4RandomDirection.hh"
+#include "Randomize.hh"
 #include <stdlib.h>
 
 PrimaryGeneratorAction::PrimaryGeneratorAction()
@@ -75,7 +76,7 @@ void PrimaryGeneratorAction::GeneratePrimaries(G4Event* event)
   // задаем случайное направление излучения
   if(real_electron_beam)
     {
-      source_position = G4ThreeVector(beam_diameter*drand48(),beam_diameter*drand48(),0);
+      source_position = G4ThreeVector(beam_diameter*G4UniformRand(),beam_diameter*G4UniformRand(),0);
     }
   
   particleGun->SetParticlePosition(source_position);
@@ -29,18 +29,28 @@
 
 #include "RunAction.hh"
 #include "Hist1i.h"
+#include "PhysicsList.hh"
+#include "ImportanceProcess.hh"
+#include "WeightWindowProcess.hh"
+#include "WeightWindowGenerator.hh"
+#include "StackingAction.hh"
 
 #include "G4Run.hh"
 #include "Randomize.hh"
 
 RunAction::RunAction() 
 {
-
+  DSD_vector = NULL;
+  master_DSD_vector = NULL;
+  ww_generator = NULL;
+  physics_list = NULL;
 }
 
 RunAction::~RunAction()
 {
   DSD_vector=NULL;
+  master_DSD_vector=NULL;
+  delete ww_generator;
 }
 
 /** 
@@ -55,7 +65,51 @@ void RunAction::BeginOfRunAction(const G4Run*)
 {
   G4cout << "\n*********************************************\n";
   G4cout << "\n\n=======================\nBegin of RunAction:\n";
-  
+  if(IsMaster())
+    {//physics tables are ready at this moment:
+      if(physics_list != NULL)
+	physics_list->update_table_cache();
+
+      //split particles have weights, the workers start after this:
+      const bool weighted = ImportanceProcess::is_enabled()
+	|| WeightWindowProcess::is_enabled();
+      DetectorSD2::set_weighted_scoring(weighted);
+      if(ImportanceProcess::is_enabled())
+	{
+	  const std::vector<double> &layers = ImportanceProcess::get_importances();
+	  G4cout << "Importance sampling: " << layers.size() << " layers, importances:";
+	  for(size_t i = 0; i < layers.size(); i++)
+	    G4cout << " " << layers[i];
+	  G4cout << "\n";
+	}
+      if(WeightWindowProcess::is_enabled())
+	WeightWindowProcess::print(G4cout);
+      StackingAction::print_rules(G4cout);
+      WeightWindowGenerator::reset_master();
+      if(WeightWindowGenerator::is_enabled())
+	{
+	  G4cout << "Weight windows pilot run: ";
+	  WeightWindowGenerator::get_mesh().print(G4cout);
+	  G4cout << "\n";
+	}
+      if(DSD_vector != NULL)
+	for(size_t i = 0; i < DSD_vector->size(); i++)
+	  {
+	    DSD_vector->at(i)->reset_history_statistics();
+	    if(weighted && DSD_vector->at(i)->is_raw_capture())
+	      G4cout << "(warning) " << DSD_vector->at(i)->GetName()
+		     << ": raw files keep no weights, use the histograms.\n";
+	  }
+      run_start = std::chrono::steady_clock::now();
+    }
+  else if(master_DSD_vector != NULL && DSD_vector != NULL)
+    {//histogram settings may be changed between runs, the master's detectors
+     //have them; the thread's counts were merged at the end of the last run:
+      for(size_t i = 0; i < DSD_vector->size() && i < master_DSD_vector->size(); i++)
+	DSD_vector->at(i)->copy_settings(master_DSD_vector->at(i));
+    }
+  if(ww_generator != NULL)
+    ww_generator->begin_run(DSD_vector);
 }
 
 /** 
@@ -66,13 +120,37 @@ void RunAction::BeginOfRunAction(const G4Run*)
       DetectorSD::save_histo() which will write all 
       histograms created by DetectorSD objects to files.;
 */
-void RunAction::EndOfRunAction(const G4Run* )
+void RunAction::EndOfRunAction(const G4Run* run)
 {
+  if(ww_generator != NULL)
+    ww_generator->merge();
+  if(IsMaster())
+    WeightWindowGenerator::write_master(run->GetNumberOfEvent());
+  if(!IsMaster() && master_DSD_vector!=NULL && DSD_vector!=NULL)
+    {//worker thread: pass the data to the master's detectors
+      for(size_t i = 0; i < DSD_vector->size() && i < master_DSD_vector->size(); i++)
+	master_DSD_vector->at(i)->merge(DSD_vector->at(i));
+      return;
+    }
   if(this->DSD_vector!=NULL && (!DSD_vector->empty()) )
     {
+      //the event loop only, without saving:
+      std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - run_start;
       std::vector<DetectorSD2*>::iterator iter;
       for(iter = DSD_vector->begin(); iter < DSD_vector->end(); iter++)
 	(*iter)->save_all();
+      //waits for the writer thread too:
+      DetectorSD2::close_raw_files(run->GetNumberOfEvent());
+      for(iter = DSD_vector->begin(); iter < DSD_vector->end(); iter++)
+	(*iter)->print_history_statistics(seconds.count());
+      G4cout << "Run: " << run->GetNumberOfEvent() << " events in "
+	     << seconds.count() << " s, "
+	     << ((seconds.count() > 0)? run->GetNumberOfEvent()/seconds.count() : 0)
+	     << " events/s\n";
+      G4cout << "Event loop stalled by raw data saving: "
+	     << DetectorSD2::get_flush_stall_time(true) << " s ("
+	     << ((DetectorSD2::is_async_writing())? "writer thread" : "no writer thread")
+	     << ")\n";
     }
 }
 
@@ -0,0 +1,90 @@
+/* ========================================================== */
+// Part of simulation for use with GEANT4 code.
+// Splitting and russian roulette of a track, common for
+// ImportanceProcess and WeightWindowProcess.
+//
+// Taras Schevchenko National University of Kyiv, 2012.
+/* ========================================================== */
+
+#include "SplitRoulette.hh"
+
+#include "G4Track.hh"
+#include "G4Step.hh"
+#include "G4DynamicParticle.hh"
+#include "Randomize.hh"
+
+#include <float.h>
+
+SplitRoulette::SplitRoulette(const G4String &name): G4VProcess(name, fGeneral)
+{
+}
+
+SplitRoulette::~SplitRoulette()
+{
+}
+
+G4double SplitRoulette::PostStepGetPhysicalInteractionLength(const G4Track&, G4double,
+							     G4ForceCondition *condition)
+{
+  *condition = (is_active())? StronglyForced : NotForced;
+  return DBL_MAX;
+}
+
+G4VParticleChange* SplitRoulette::PostStepDoIt(const G4Track &track, const G4Step &step)
+{
+  particle_change.Initialize(track);
+  //StronglyForced is invoked for the tracks killed in this step too:
+  if(track.GetTrackStatus() == fAlive && is_active())
+    bias(track, step);
+  return &particle_change;
+}
+
+bool SplitRoulette::is_copy(const G4Track &track)
+{
+  return dynamic_cast<const SplitRoulette*>(track.GetCreatorProcess()) != NULL;
+}
+
+bool SplitRoulette::check_exclusive(const G4String &enabling, const bool other_enabled)
+{
+  if(!other_enabled)
+    return true;
+  G4Exception("SplitRoulette::check_exclusive", "exgps_bias01", JustWarning,
+	      ("importances and weight windows can't be used together, the "
+	       + enabling + " are not enabled; disable the other ones first.").c_str());
+  return false;
+}
+
+void SplitRoulette::apply(const G4Track &track, const double lower, const double upper,
+			  const double target)
+{
+  const double weight = track.GetWeight();
+  if(weight < lower)
+    {//russian roulette:
+      if(G4UniformRand()*target < weight)
+	particle_change.ProposeWeight(target);
+      else
+	particle_change.ProposeTrackStatus(fStopAndKill);
+      return;
+    }
+  if(weight <= upper)
+    return;
+
+  const double copies = weight/target;
+  int n_copies = (int)copies;
+  if(G4UniformRand() < copies - n_copies)
+    n_copies++;
+  if(n_copies > max_split)
+    n_copies = max_split;
+  if(n_copies <= 1)
+    return;
+  //the track itself is one of the copies:
+  const double copy_weight = weight/n_copies;
+  particle_change.ProposeWeight(copy_weight);
+  particle_change.SetNumberOfSecondaries(n_copies - 1);
+  particle_change.SetSecondaryWeightByProcess(true);
+  for(int i = 1; i < n_copies; i++)
+    {
+      particle_change.AddSecondary(new G4DynamicParticle(*track.GetDynamicParticle()));
+      particle_change.GetSecondary(i - 1)->SetWeight(copy_weight);
+    }
+}
@@ -39,19 +39,29 @@
 // 
 
 #include "StackingAction.hh"
-
-#include "HistoManager.hh"
+#include "SplitRoulette.hh"
 
 #include "G4Track.hh"
+#include "G4ParticleDefinition.hh"
+#include "G4ParticleTable.hh"
+#include "G4VPhysicalVolume.hh"
+#include "G4LogicalVolume.hh"
+#include "G4Region.hh"
+#include "G4RegionStore.hh"
+
+#include <float.h>
 
+std::vector<StackingAction::rule> StackingAction::rules;
+unsigned StackingAction::rules_version = 1;
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
 StackingAction::StackingAction()
 {
-  histoManager   = HistoManager::GetPointer();
   killSecondary  = false;
-  pname          = ""; 
+  resolved_version = 0;
+  last_particle = NULL;
+  last_rules = NULL;
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -63,33 +73,146 @@ StackingAction::~StackingAction()
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
+void StackingAction::SetKill(const G4String& name)
+{
+  add_rule(name, 0, "*", fKill);
+}
+
+bool StackingAction::add_rule(const G4String &particle, const G4double threshold,
+			      const G4String &region,
+			      const G4ClassificationOfNewTrack classification)
+{
+  if(particle != "*" && G4ParticleTable::GetParticleTable()->FindParticle(particle) == NULL)
+    {
+      G4cerr << "StackingAction: there is no particle \"" << particle
+	     << "\", the rule is not added.\n";
+      return false;
+    }
+  rule added;
+  added.particle = particle;
+  added.region = region;
+  added.threshold = (threshold > 0)? threshold : 0;
+  added.classification = classification;
+  rules.push_back(added);
+  rules_version++;
+  return true;
+}
+
+void StackingAction::clear_rules()
+{
+  rules.clear();
+  rules_version++;
+}
+
+void StackingAction::print_rules(std::ostream &stream)
+{
+  for(size_t i = 0; i < rules.size(); i++)
+    {
+      stream << "Stacking rule " << i + 1 << ": " << rules[i].particle;
+      if(rules[i].threshold > 0)
+	stream << " below " << rules[i].threshold/keV << " keV";
+      stream << " born in " << rules[i].region << " -- ";
+      //the values of G4ClassificationOfNewTrack are not indices(fKill is -9):
+      switch(rules[i].classification)
+	{
+	case fUrgent:   stream << "urgent";   break;
+	case fWaiting:  stream << "waiting";  break;
+	case fPostpone: stream << "postpone"; break;
+	case fKill:     stream << "kill";     break;
+	default:        stream << "stack " << rules[i].classification; break;
+	}
+      stream << "\n";
+    }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void StackingAction::resolve_rules()
+{
+  particle_rules.clear();
+  any_particle_rules.clear();
+  last_particle = NULL;
+  last_rules = NULL;
+  resolved_version = rules_version;
+
+  G4ParticleTable *particles = G4ParticleTable::GetParticleTable();
+  //lists of the particles with rules of their own:
+  for(size_t i = 0; i < rules.size(); i++)
+    if(rules[i].particle != "*")
+      particle_rules[particles->FindParticle(rules[i].particle)];
+  particle_rules.erase(NULL);
+
+  for(size_t i = 0; i < rules.size(); i++)
+    {
+      resolved_rule resolved;
+      resolved.region = NULL;
+      resolved.threshold = (rules[i].threshold > 0)? rules[i].threshold : DBL_MAX;
+      resolved.classification = rules[i].classification;
+      if(rules[i].region != "*")
+	{
+	  resolved.region = G4RegionStore::GetInstance()->GetRegion(rules[i].region, false);
+	  if(resolved.region == NULL)
+	    {
+	      G4cerr << "StackingAction: there is no region \"" << rules[i].region
+		     << "\", rule " << i + 1 << " is ignored.\n";
+	      continue;
+	    }
+	}
+      if(rules[i].particle == "*")
+	{
+	  any_particle_rules.push_back(resolved);
+	  std::map<const G4ParticleDefinition*, std::vector<resolved_rule> >::iterator iter;
+	  for(iter = particle_rules.begin(); iter != particle_rules.end(); iter++)
+	    iter->second.push_back(resolved);
+	}
+      else
+	{
+	  const G4ParticleDefinition *particle = particles->FindParticle(rules[i].particle);
+	  if(particle != NULL)
+	    particle_rules[particle].push_back(resolved);
+	}
+    }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
 G4ClassificationOfNewTrack
 StackingAction::ClassifyNewTrack(const G4Track* aTrack)
 {
-  G4ClassificationOfNewTrack status = fUrgent;
-
-  if (aTrack->GetTrackStatus() == fAlive) 
-    histoManager->ScoreNewTrack(aTrack);
-
-  const G4String name = aTrack->GetDefinition()->GetParticleName();
-
-  if(histoManager->GetVerbose() > 1 ) {
-    G4cout << "Track #"
-	   << aTrack->GetTrackID() << " of " << name
-	   << " E(MeV)= " << aTrack->GetKineticEnergy()/MeV
-	   << " produced by " 
-	   << histoManager->CurrentParticle()->GetParticleName()
-	   << " ID= " << aTrack->GetParentID()
-	   << " with E(MeV)= " << histoManager->CurrentKinEnergy()/MeV
-	   << G4endl;
-  }
-  if(aTrack->GetTrackID() == 1) return status;
-
-  //stack or delete secondaries
-  if (killSecondary)      status = fKill;
-  else if(pname == name)  status = fKill; 
-
-  return status;
+  if(aTrack->GetParentID() == 0) return fUrgent;
+  if(killSecondary) return fKill;
+
+  if(resolved_version != rules_version)
+    resolve_rules();
+
+  //rules are looked up by the pointers, no names compared:
+  const G4ParticleDefinition *particle = aTrack->GetDefinition();
+  if(particle != last_particle)
+    {
+      std::map<const G4ParticleDefinition*, std::vector<resolved_rule> >::const_iterator iter =
+	particle_rules.find(particle);
+      last_particle = particle;
+      last_rules = (iter != particle_rules.end())? &iter->second : &any_particle_rules;
+    }
+  if(last_rules->empty()) return fUrgent;
+  //copies made by splitting share the fate of the track they're split from,
+  //a rule for them alone would change the weight of the lineage:
+  if(SplitRoulette::is_copy(*aTrack)) return fUrgent;
+
+  //secondaries get the touchable of their parent's step:
+  const G4Region *region = NULL;
+  const G4VPhysicalVolume *volume = aTrack->GetVolume();
+  if(volume != NULL)
+    region = volume->GetLogicalVolume()->GetRegion();
+  const G4double energy = aTrack->GetKineticEnergy();
+  for(size_t i = 0; i < last_rules->size(); i++)
+    {
+      const resolved_rule &candidate = (*last_rules)[i];
+      if(energy < candidate.threshold
+	 && (candidate.region == NULL || candidate.region == region))
+	return candidate.classification;
+    }
+  return fUrgent;
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -39,7 +39,10 @@
 
 SteppingAction::SteppingAction()
 { 
-
+  DSD_vector = NULL;
+  last_sensitive = NULL;
+  last_detector = NULL;
+  ww_generator = NULL;
 }
 
 SteppingAction::~SteppingAction()
@@ -54,36 +57,30 @@ SteppingAction::~SteppingAction()
 void SteppingAction::SetDetectorSD(std::vector <DetectorSD2*> *vector)
 {
   DSD_vector = vector;
+  last_sensitive = NULL;
+  last_detector = NULL;
 }
   
 void SteppingAction::UserSteppingAction(const G4Step* aStep)
 { 
-  G4VPhysicalVolume* volume = aStep->GetPostStepPoint()->GetPhysicalVolume();
+  if(ww_generator != NULL)
+    ww_generator->step(aStep);
   G4VSensitiveDetector* sens_detector = aStep->GetPostStepPoint()->GetSensitiveDetector();
-  
-  G4String volumeName= (volume)? volume->GetName(): G4String("null");
-  G4String sensName= (sens_detector)? sens_detector->GetName(): G4String("null");
-  G4Track *track = aStep->GetTrack();
-  
-  G4String particleName = (track->GetDynamicParticle()
-			        ->GetDefinition()
-			        ->GetParticleName());
-  if(sens_detector!=NULL && DSD_vector!=NULL)
+  //most of the steps are made outside of the detectors:
+  if(sens_detector == NULL || DSD_vector == NULL) return;
+
+  DetectorSD2 *detector = find_detector(sens_detector);
+  if(detector != NULL)
     {
-      std::vector<DetectorSD2*>::iterator iter;
-      for(iter = DSD_vector->begin(); iter < DSD_vector->end(); iter++)
-	{
-	  if( (*iter)->GetName() == sensName)
-	    {
-	      (*iter)->fill_hist(particleName, track->GetKineticEnergy());
-	      // G4cout << "stepping: DetectorSD name: " << sensName
-	      //  	     << " track ID: "<< track->GetTrackID()
-	      //  	     << " p.name: "  << particleName
-	      //  	     << " p.energy :"<< (track->GetKineticEnergy())/keV <<
-	      // 	"\n";
-	    }
-	}
+      const G4Track *track = aStep->GetTrack();
+      detector->fill_hist(track->GetDefinition(), track->GetKineticEnergy(),
+			  track->GetWeight());
+      if(ww_generator != NULL && ww_generator->is_target(detector))
+	ww_generator->score(track, track->GetWeight());
+      // G4cout << "stepping: DetectorSD name: " << detector->GetName()
+      //  	     << " track ID: "<< track->GetTrackID()
+      //  	     << " p.name: "  << track->GetDefinition()->GetParticleName()
+      //  	     << " p.energy :"<< (track->GetKineticEnergy())/keV <<
+      // 	"\n";
     }
-
 }
-
@@ -0,0 +1,202 @@
+/* ========================================================== */
+// Part of simulation for use with GEANT4 code.
+// Weight windows generator: importances of the mesh bins from a pilot run.
+//
+// Taras Schevchenko National University of Kyiv, 2012.
+/* ========================================================== */
+
+#include "WeightWindowGenerator.hh"
+#include "DetectorSD2.hh"
+
+#include "G4Track.hh"
+#include "G4Step.hh"
+#include "G4StepPoint.hh"
+#include "G4AutoLock.hh"
+
+#include <fstream>
+#include <iomanip>
+
+WeightWindowMesh WeightWindowGenerator::mesh;
+G4String WeightWindowGenerator::output_name;
+G4String WeightWindowGenerator::target_name = WW_DEFAULT_TARGET;
+double WeightWindowGenerator::ratio = 5;
+std::vector<double> WeightWindowGenerator::master_weight_sum;
+std::vector<double> WeightWindowGenerator::master_score_sum;
+double WeightWindowGenerator::master_total_score = 0;
+
+namespace
+{
+  /** workers merge their counts into the master ones at the same time*/
+  G4Mutex masterMutex = G4MUTEX_INITIALIZER;
+}
+
+WeightWindowGenerator::WeightWindowGenerator()
+{
+  target = NULL;
+  total_score = 0;
+}
+
+WeightWindowGenerator::~WeightWindowGenerator()
+{
+}
+
+bool WeightWindowGenerator::set_output(const G4String &file_name)
+{
+  if(!file_name.empty() && mesh.size() <= 1)
+    {
+      G4cerr << "WeightWindowGenerator: the mesh has one bin, set /construction/ww_mesh"
+	     << " and ww_energies before ww_generate; no pilot run.\n";
+      return false;
+    }
+  output_name = file_name;
+  return true;
+}
+
+bool WeightWindowGenerator::set_ratio(const double value)
+{
+  if(!(value > 1)) return false;
+  ratio = value;
+  return true;
+}
+
+void WeightWindowGenerator::begin_run(const std::vector<DetectorSD2*> *detectors)
+{
+  target = NULL;
+  tracks.clear();
+  total_score = 0;
+  weight_sum.assign((is_enabled())? mesh.size() : 0, 0.0);
+  score_sum.assign(weight_sum.size(), 0.0);
+  if(!is_enabled() || detectors == NULL) return;
+  //looked up once, the scores are matched by pointers:
+  for(size_t i = 0; i < detectors->size(); i++)
+    if(detectors->at(i)->GetName() == target_name)
+      target = detectors->at(i);
+}
+
+void WeightWindowGenerator::begin_event()
+{
+  if(!tracks.empty())
+    tracks.clear();
+}
+
+void WeightWindowGenerator::step(const G4Step *step)
+{
+  if(weight_sum.empty()) return;
+  const G4Track *track = step->GetTrack();
+  const G4int id = track->GetTrackID();
+  std::map<G4int, lineage>::iterator found = tracks.find(id);
+  if(found == tracks.end())
+    {//the first step: the particle enters the bin where it's born
+      const G4StepPoint *point = step->GetPreStepPoint();
+      lineage born;
+      born.parent = track->GetParentID();
+      born.born = point->GetGlobalTime();
+      born.last_bin = -1;
+      found = tracks.insert(std::pair<G4int, lineage>(id, born)).first;
+      const long bin = mesh.index(point->GetPosition(), point->GetKineticEnergy());
+      if(bin >= 0)
+	{
+	  entry entered = {bin, born.born};
+	  found->second.entries.push_back(entered);
+	  found->second.last_bin = bin;
+	  weight_sum[bin] += point->GetWeight();
+	}
+    }
+  const G4StepPoint *point = step->GetPostStepPoint();
+  const long bin = mesh.index(point->GetPosition(), track->GetKineticEnergy());
+  if(bin == found->second.last_bin) return;
+  found->second.last_bin = bin;
+  if(bin < 0) return;
+  entry entered = {bin, point->GetGlobalTime()};
+  found->second.entries.push_back(entered);
+  weight_sum[bin] += track->GetWeight();
+}
+
+void WeightWindowGenerator::score(const G4Track *track, const double weight)
+{
+  if(score_sum.empty()) return;
+  total_score += weight;
+  //the particle's own entries are all older than the score,
+  //the ancestors' ones count up to the birth of the next generation:
+  double before = track->GetGlobalTime();
+  std::map<G4int, lineage>::const_iterator found = tracks.find(track->GetTrackID());
+  while(found != tracks.end())
+    {
+      const std::vector<entry> &entries = found->second.entries;
+      for(size_t i = 0; i < entries.size() && entries[i].time <= before; i++)
+	score_sum[entries[i].bin] += weight;
+      before = found->second.born;
+      found = tracks.find(found->second.parent);
+    }
+}
+
+void WeightWindowGenerator::merge()
+{
+  if(weight_sum.empty()) return;
+  G4AutoLock lock(&masterMutex);
+  if(master_weight_sum.size() != weight_sum.size())
+    {
+      master_weight_sum.assign(weight_sum.size(), 0.0);
+      master_score_sum.assign(weight_sum.size(), 0.0);
+    }
+  for(size_t i = 0; i < weight_sum.size(); i++)
+    {
+      master_weight_sum[i] += weight_sum[i];
+      master_score_sum[i] += score_sum[i];
+    }
+  master_total_score += total_score;
+  weight_sum.assign(weight_sum.size(), 0.0);
+  score_sum.assign(score_sum.size(), 0.0);
+  total_score = 0;
+  tracks.clear();
+}
+
+void WeightWindowGenerator::reset_master()
+{
+  G4AutoLock lock(&masterMutex);
+  master_weight_sum.clear();
+  master_score_sum.clear();
+  master_total_score = 0;
+}
+
+bool WeightWindowGenerator::write_master(const G4int histories)
+{
+  G4AutoLock lock(&masterMutex);
+  if(!is_enabled()) return true;
+  if(histories <= 0 || !(master_total_score > 0))
+    {
+      G4cerr << "WeightWindowGenerator: \"" << target_name
+	     << "\" has no score, the map is not written.\n";
+      return false;
+    }
+  std::ofstream file(output_name.c_str());
+  if(!file.is_open())
+    {
+      G4cerr << "WeightWindowGenerator: can't write \"" << output_name << "\".\n";
+      return false;
+    }
+  const double source_importance = master_total_score/histories;
+  const double lower_at_source = 2.0/(1.0 + ratio);
+  file << "# exgps weight windows: lower bounds for \"" << target_name << "\", "
+       << histories << " histories, score per history " << source_importance << "\n"
+       << "# bins: ((x*NY + y)*NZ + z)*NE + energy, mm and MeV\n";
+  file << std::setprecision(10);
+  mesh.write_header(file);
+  file << "ratio " << ratio << "\nwindows " << master_weight_sum.size() << "\n";
+
+  size_t with_window = 0;
+  for(size_t i = 0; i < master_weight_sum.size(); i++)
+    {
+      double lower = 0;
+      if(master_score_sum[i] > 0 && master_weight_sum[i] > 0)
+	{
+	  lower = lower_at_source*source_importance*master_weight_sum[i]/master_score_sum[i];
+	  with_window++;
+	}
+      file << lower << "\n";
+    }
+  G4cout << "Weight windows written to \"" << output_name << "\": " << with_window
+	 << " windows of " << master_weight_sum.size() << " bins, score per history "
+	 << source_importance << "\n";
+  return true;
+}
@@ -0,0 +1,108 @@
+/* ========================================================== */
+// Part of simulation for use with GEANT4 code.
+// Spatial-energy mesh of the weight windows.
+//
+// Taras Schevchenko National University of Kyiv, 2012.
+/* ========================================================== */
+
+#include "WeightWindowMesh.hh"
+
+#include <math.h>
+#include <string>
+
+WeightWindowMesh::WeightWindowMesh()
+{
+  n_cells[0] = n_cells[1] = n_cells[2] = 1;
+  set_energies(1, 1*keV, 100*MeV);
+}
+
+void WeightWindowMesh::set_box(const G4ThreeVector &low_corner, const G4ThreeVector &high_corner)
+{
+  low = low_corner;
+  high = high_corner;
+}
+
+bool WeightWindowMesh::set_cells(const int nx, const int ny, const int nz)
+{
+  if(nx < 1 || ny < 1 || nz < 1) return false;
+  n_cells[0] = nx;
+  n_cells[1] = ny;
+  n_cells[2] = nz;
+  return true;
+}
+
+bool WeightWindowMesh::set_energies(const int n, const double e_min, const double e_max)
+{
+  if(n < 1 || !(e_min > 0) || !(e_max > e_min)) return false;
+  n_energies = n;
+  energy_min = e_min;
+  energy_max = e_max;
+  log_range = log(e_max/e_min);
+  return true;
+}
+
+long WeightWindowMesh::index(const G4ThreeVector &position, const double energy) const
+{
+  long cell = 0;
+  for(int axis = 0; axis < 3; axis++)
+    {
+      const double q = (position[axis] - low[axis])/(high[axis] - low[axis]);
+      if(!(q >= 0 && q < 1)) return -1;
+      cell = cell*n_cells[axis] + (long)(q*n_cells[axis]);
+    }
+  long bin = 0;
+  if(energy > energy_min)
+    {
+      bin = (long)(n_energies*log(energy/energy_min)/log_range);
+      if(bin >= n_energies) bin = n_energies - 1;
+    }
+  return cell*n_energies + bin;
+}
+
+void WeightWindowMesh::write_header(std::ostream &stream) const
+{
+  stream << "mesh";
+  for(int axis = 0; axis < 3; axis++)
+    stream << " " << low[axis];
+  for(int axis = 0; axis < 3; axis++)
+    stream << " " << high[axis];
+  for(int axis = 0; axis < 3; axis++)
+    stream << " " << n_cells[axis];
+  stream << "\nenergy " << n_energies << " " << energy_min << " " << energy_max << "\n";
+}
+
+bool WeightWindowMesh::read_header(std::istream &stream)
+{
+  std::string word;
+  double corners[6];
+  int cells[3];
+  if(!(stream >> word) || word != "mesh") return false;
+  for(int i = 0; i < 6; i++)
+    if(!(stream >> corners[i])) return false;
+  for(int i = 0; i < 3; i++)
+    if(!(stream >> cells[i])) return false;
+
+  int n;
+  double e_min, e_max;
+  if(!(stream >> word) || word != "energy" || !(stream >> n >> e_min >> e_max))
+    return false;
+  for(int axis = 0; axis < 3; axis++)
+    if(!(corners[axis + 3] > corners[axis])) return false;
+  //this mesh is changed only if all of the header is right:
+  WeightWindowMesh parsed;
+  if(!parsed.set_energies(n, e_min, e_max) || !parsed.set_cells(cells[0], cells[1], cells[2]))
+    return false;
+  parsed.set_box(G4ThreeVector(corners[0], corners[1], corners[2]),
+		 G4ThreeVector(corners[3], corners[4], corners[5]));
+  *this = parsed;
+  return true;
+}
+
+void WeightWindowMesh::print(std::ostream &stream) const
+{
+  stream << n_cells[0] << "x" << n_cells[1] << "x" << n_cells[2]
+	 << " boxes from (" << low[0]/cm << ", " << low[1]/cm << ", " << low[2]/cm
+	 << ") to (" << high[0]/cm << ", " << high[1]/cm << ", " << high[2]/cm
+	 << ") cm, " << n_energies << " energy bins from " << energy_min/keV
+	 << " to " << energy_max/keV << " keV";
+}
@@ -0,0 +1,96 @@
+/* ========================================================== */
+// Part of simulation for use with GEANT4 code.
+// Splitting and russian roulette by the weight windows map.
+//
+// Taras Schevchenko National University of Kyiv, 2012.
+/* ========================================================== */
+
+#include "WeightWindowProcess.hh"
+
+#include "G4Track.hh"
+#include "G4Step.hh"
+#include "G4StepPoint.hh"
+
+#include <fstream>
+#include <string>
+
+WeightWindowMesh WeightWindowProcess::mesh;
+std::vector<double> WeightWindowProcess::lower_bounds;
+double WeightWindowProcess::ratio = 5;
+G4String WeightWindowProcess::map_file_name;
+
+WeightWindowProcess::WeightWindowProcess(): SplitRoulette("weight_window")
+{
+}
+
+WeightWindowProcess::~WeightWindowProcess()
+{
+}
+
+bool WeightWindowProcess::load(const G4String &file_name)
+{
+  if(file_name.empty())
+    {
+      lower_bounds.clear();
+      map_file_name = "";
+      return true;
+    }
+
+  std::ifstream file(file_name.c_str());
+  if(!file.is_open())
+    {
+      G4cerr << "WeightWindowProcess: can't open \"" << file_name << "\".\n";
+      return false;
+    }
+  //comments are at the beginning only:
+  while(file.peek() == '#')
+    file.ignore(1 << 16, '\n');
+
+  //the map in use is kept until all of the file is read:
+  WeightWindowMesh file_mesh;
+  std::string word;
+  size_t count = 0;
+  double file_ratio = 0;
+  if(!file_mesh.read_header(file)
+     || !(file >> word) || word != "ratio" || !(file >> file_ratio) || !(file_ratio > 1)
+     || !(file >> word) || word != "windows" || !(file >> count) || count != file_mesh.size())
+    {
+      G4cerr << "WeightWindowProcess: \"" << file_name << "\" is not a weight windows map.\n";
+      return false;
+    }
+  std::vector<double> values(count);
+  for(size_t i = 0; i < count; i++)
+    if(!(file >> values[i]) || values[i] < 0)
+      {
+	G4cerr << "WeightWindowProcess: \"" << file_name << "\" has "
+	       << i << " windows of " << count << ".\n";
+	return false;
+      }
+  mesh = file_mesh;
+  ratio = file_ratio;
+  lower_bounds.swap(values);
+  map_file_name = file_name;
+  return true;
+}
+
+void WeightWindowProcess::print(std::ostream &stream)
+{
+  size_t with_window = 0;
+  for(size_t i = 0; i < lower_bounds.size(); i++)
+    if(lower_bounds[i] > 0) with_window++;
+  stream << "Weight windows from \"" << map_file_name << "\": ";
+  mesh.print(stream);
+  stream << ", " << with_window << " windows of " << lower_bounds.size()
+	 << ", upper/lower " << ratio << "\n";
+}
+
+void WeightWindowProcess::bias(const G4Track &track, const G4Step &step)
+{
+  const long bin = mesh.index(step.GetPostStepPoint()->GetPosition(), track.GetKineticEnergy());
+  if(bin < 0 || !(lower_bounds[bin] > 0))
+    return;
+  const double lower = lower_bounds[bin];
+  const double upper = lower*ratio;
+  //survivors of the roulette and the copies are in the middle of the window:
+  apply(track, lower, upper, 0.5*(lower + upper));
+}
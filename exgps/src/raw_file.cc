@@ -0,0 +1,277 @@
+/* ========================================================== */
+// Part of simulation for use with GEANT4 code.
+// Binary raw-energy files written by DetectorSD2.
+//
+// Taras Schevchenko National University of Kyiv, 2012.
+/* ========================================================== */
+
+#include "raw_file.h"
+#include <string.h>
+
+/** offset of value_count and event_count in the file*/
+#define RAW_FILE_COUNTERS_OFFSET 32
+
+namespace
+{
+  bool host_is_little_endian()
+  {
+    const unsigned short one = 1;
+    return *((const unsigned char*)&one) == 1;
+  }
+
+  /** Copy n bytes of the value to little-endian order.*/
+  void to_little_endian(unsigned char *dst, const void *src, const size_t n)
+  {
+    const unsigned char *bytes = (const unsigned char*)src;
+    if(host_is_little_endian())
+      memcpy(dst, bytes, n);
+    else
+      for(size_t i = 0; i < n; i++) dst[i] = bytes[n - 1 - i];
+  }
+
+  int write_u32(FILE *fp, const unsigned value)
+  {
+    unsigned char bytes[4];
+    for(int i = 0; i < 4; i++) bytes[i] = (unsigned char)(value >> (8*i));
+    return (fwrite(bytes, 1, 4, fp) == 4)? 0 : -1;
+  }
+
+  int write_u64(FILE *fp, const unsigned long long value)
+  {
+    unsigned char bytes[8];
+    for(int i = 0; i < 8; i++) bytes[i] = (unsigned char)(value >> (8*i));
+    return (fwrite(bytes, 1, 8, fp) == 8)? 0 : -1;
+  }
+
+  int read_u32(FILE *fp, unsigned &value)
+  {
+    unsigned char bytes[4];
+    if(fread(bytes, 1, 4, fp) != 4) return -1;
+    value = 0;
+    for(int i = 0; i < 4; i++) value |= ((unsigned)bytes[i]) << (8*i);
+    return 0;
+  }
+
+  int read_u64(FILE *fp, unsigned long long &value)
+  {
+    unsigned char bytes[8];
+    if(fread(bytes, 1, 8, fp) != 8) return -1;
+    value = 0;
+    for(int i = 0; i < 8; i++) value |= ((unsigned long long)bytes[i]) << (8*i);
+    return 0;
+  }
+
+  int read_string(FILE *fp, std::string &str, const unsigned length)
+  {
+    str.clear();
+    if(length == 0) return 0;
+    if(length > 4096) return -1;
+    std::vector<char> chars(length);
+    if(fread(&chars[0], 1, length, fp) != length) return -1;
+    str.assign(&chars[0], length);
+    return 0;
+  }
+}
+
+const char *raw_file_header::unit_name() const
+{
+  switch(energy_units)
+    {
+    case 0:  return "eV";
+    case 2:  return "MeV";
+    default:
+      return "keV";
+    }
+}
+
+raw_file::raw_file()
+{
+  fp = NULL;
+  writing = false;
+}
+
+raw_file::~raw_file()
+{
+  close();
+}
+
+bool raw_file::is_binary(const std::string &filename)
+{
+  FILE *file = fopen(filename.c_str(), "rb");
+  if(file == NULL) return false;
+  char magic[8];
+  bool result = (fread(magic, 1, 8, file) == 8 && memcmp(magic, RAW_FILE_MAGIC, 8) == 0);
+  fclose(file);
+  return result;
+}
+
+int raw_file::write_header(const raw_file_header &header)
+{
+  int res = 0;
+  res |= (fwrite(RAW_FILE_MAGIC, 1, 8, fp) == 8)? 0 : -1;
+  res |= write_u32(fp, RAW_FILE_VERSION);
+  res |= write_u32(fp, header.value_size);
+  res |= write_u32(fp, header.energy_units);
+  res |= write_u32(fp, header.detector_name.size());
+  res |= write_u32(fp, header.species.size());
+  res |= write_u32(fp, header.quantity.size());
+  res |= write_u64(fp, header.event_count);
+  res |= write_u64(fp, header.value_count);
+  res |= (fwrite(header.detector_name.data(), 1, header.detector_name.size(), fp)
+	  == header.detector_name.size())? 0 : -1;
+  res |= (fwrite(header.species.data(), 1, header.species.size(), fp)
+	  == header.species.size())? 0 : -1;
+  res |= (fwrite(header.quantity.data(), 1, header.quantity.size(), fp)
+	  == header.quantity.size())? 0 : -1;
+  return res;
+}
+
+int raw_file::read_header(raw_file_header &header)
+{
+  char magic[8];
+  unsigned version = 0, name_length = 0, species_length = 0, quantity_length = 0;
+  if(fread(magic, 1, 8, fp) != 8 || memcmp(magic, RAW_FILE_MAGIC, 8) != 0)
+    return -1;
+  if(read_u32(fp, version) || version != RAW_FILE_VERSION) return -1;
+  if(read_u32(fp, header.value_size) || read_u32(fp, header.energy_units)) return -1;
+  if(header.value_size != sizeof(float) && header.value_size != sizeof(double))
+    return -1;
+  if(read_u32(fp, name_length) || read_u32(fp, species_length)
+     || read_u32(fp, quantity_length))
+    return -1;
+  if(read_u64(fp, header.event_count) || read_u64(fp, header.value_count))
+    return -1;
+  if(read_string(fp, header.detector_name, name_length)
+     || read_string(fp, header.species, species_length)
+     || read_string(fp, header.quantity, quantity_length))
+    return -1;
+  return 0;
+}
+
+int raw_file::open_write(const std::string &filename, const raw_file_header &header)
+{
+  close();
+  d_header = header;
+  d_header.event_count = 0;
+  d_header.value_count = 0;
+
+  //append to the existing file if it has the same layout:
+  fp = fopen(filename.c_str(), "r+b");
+  if(fp != NULL)
+    {
+      raw_file_header existing;
+      if(read_header(existing) == 0
+	 && existing.value_size == header.value_size
+	 && existing.energy_units == header.energy_units
+	 && existing.detector_name == header.detector_name
+	 && existing.species == header.species
+	 && existing.quantity == header.quantity)
+	{
+	  d_header.event_count = existing.event_count;
+	  d_header.value_count = existing.value_count;
+	  fseek(fp, 0, SEEK_END);
+	}
+      else
+	{
+	  fclose(fp);
+	  fp = NULL;
+	}
+    }
+  if(fp == NULL)
+    {
+      fp = fopen(filename.c_str(), "w+b");
+      if(fp == NULL) return -1;
+      if(write_header(d_header) != 0)
+	{
+	  fclose(fp);
+	  fp = NULL;
+	  return -1;
+	}
+    }
+  d_stream_buffer.resize(RAW_FILE_BUFFER_SIZE);
+  setvbuf(fp, &d_stream_buffer[0], _IOFBF, d_stream_buffer.size());
+  writing = true;
+  return 0;
+}
+
+int raw_file::write(const double *values, const size_t n_values)
+{
+  if(fp == NULL || !writing) return -1;
+  if(n_values == 0) return 0;
+  const size_t value_size = d_header.value_size;
+  if(value_size == sizeof(double) && host_is_little_endian())
+    {
+      if(fwrite(values, sizeof(double), n_values, fp) != n_values) return -1;
+    }
+  else
+    {
+      d_buffer.resize(n_values*value_size);
+      unsigned char *dst = &d_buffer[0];
+      if(value_size == sizeof(float))
+	for(size_t i = 0; i < n_values; i++)
+	  {
+	    const float value = (float)values[i];
+	    to_little_endian(dst + i*value_size, &value, value_size);
+	  }
+      else
+	for(size_t i = 0; i < n_values; i++)
+	  to_little_endian(dst + i*value_size, values + i, value_size);
+      if(fwrite(dst, value_size, n_values, fp) != n_values) return -1;
+    }
+  d_header.value_count += n_values;
+  return 0;
+}
+
+int raw_file::open_read(const std::string &filename)
+{
+  close();
+  fp = fopen(filename.c_str(), "rb");
+  if(fp == NULL) return -1;
+  if(read_header(d_header) != 0)
+    {
+      fclose(fp);
+      fp = NULL;
+      return -1;
+    }
+  writing = false;
+  return 0;
+}
+
+size_t raw_file::read(double *values, const size_t n_values)
+{
+  if(fp == NULL || writing || n_values == 0) return 0;
+  const size_t value_size = d_header.value_size;
+  d_buffer.resize(n_values*value_size);
+  const size_t n_read = fread(&d_buffer[0], value_size, n_values, fp);
+  for(size_t i = 0; i < n_read; i++)
+    {
+      const unsigned char *src = &d_buffer[i*value_size];
+      if(value_size == sizeof(float))
+	{
+	  float value;
+	  to_little_endian((unsigned char*)&value, src, value_size);
+	  values[i] = value;
+	}
+      else
+	to_little_endian((unsigned char*)(values + i), src, value_size);
+    }
+  return n_read;
+}
+
+int raw_file::close(const unsigned long long add_events)
+{
+  if(fp == NULL) return 0;
+  int res = 0;
+  if(writing)
+    {
+      d_header.event_count += add_events;
+      fflush(fp);
+      res |= fseek(fp, RAW_FILE_COUNTERS_OFFSET, SEEK_SET);
+      res |= write_u64(fp, d_header.event_count);
+      res |= write_u64(fp, d_header.value_count);
+    }
+  res |= fclose(fp);
+  fp = NULL;
+  writing = false;
+  return (res == 0)? 0 : -1;
+}
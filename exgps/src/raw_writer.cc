@@ -0,0 +1,121 @@
+/* ========================================================== */
+// Part of simulation for use with GEANT4 code.
+// Background thread which writes raw-energy batches of DetectorSD2.
+//
+// Taras Schevchenko National University of Kyiv, 2012.
+/* ========================================================== */
+
+#include "raw_writer.h"
+#include <utility>
+
+raw_writer::raw_writer(write_function function, const size_t max_jobs,
+		       const size_t batch_capacity)
+{
+  d_function = function;
+  d_max_jobs = (max_jobs > 0)? max_jobs : 1;
+  d_running = false;
+  d_stop = false;
+  d_busy = 0;
+  //double buffering works from the first flush:
+  if(batch_capacity > 0)
+    {
+      d_spare.resize(d_max_jobs);
+      for(size_t i = 0; i < d_spare.size(); i++)
+	d_spare[i].reserve(batch_capacity);
+    }
+}
+
+raw_writer::~raw_writer()
+{
+  finish();
+}
+
+void raw_writer::set_queue_size(const size_t max_jobs)
+{
+  std::lock_guard<std::mutex> lock(d_mutex);
+  d_max_jobs = (max_jobs > 0)? max_jobs : 1;
+}
+
+void raw_writer::submit(raw_write_job &job, std::vector<double> &buffer)
+{
+  std::unique_lock<std::mutex> lock(d_mutex);
+  if(!d_running)
+    {
+      d_stop = false;
+      d_running = true;
+      d_thread = std::thread(&raw_writer::run, this);
+    }
+  //backpressure: wait for the disk
+  while(d_queue.size() >= d_max_jobs)
+    d_job_done.wait(lock);
+
+  job.values.swap(buffer);
+  d_queue.push_back(std::move(job));
+  buffer.clear();
+  //give an already allocated vector back:
+  if(!d_spare.empty())
+    {
+      buffer.swap(d_spare.back());
+      d_spare.pop_back();
+    }
+  d_job_added.notify_one();
+}
+
+void raw_writer::drain()
+{
+  std::unique_lock<std::mutex> lock(d_mutex);
+  while(!d_queue.empty() || d_busy > 0)
+    d_job_done.wait(lock);
+}
+
+void raw_writer::finish()
+{
+  {
+    std::lock_guard<std::mutex> lock(d_mutex);
+    if(!d_running) return;
+    d_stop = true;
+    d_job_added.notify_one();
+  }
+  d_thread.join();
+  //batches submitted after the thread has seen the stop flag are written
+  //here, under the lock, so a new thread can't overtake them:
+  std::lock_guard<std::mutex> lock(d_mutex);
+  while(!d_queue.empty())
+    {
+      d_function(d_queue.front());
+      d_queue.pop_front();
+    }
+  d_running = false;
+  d_stop = false;
+  d_job_done.notify_all();
+}
+
+void raw_writer::run()
+{
+  std::unique_lock<std::mutex> lock(d_mutex);
+  for(;;)
+    {
+      while(d_queue.empty() && !d_stop)
+	d_job_added.wait(lock);
+      if(d_queue.empty())
+	break;//stop requested and nothing left
+      raw_write_job job = std::move(d_queue.front());
+      d_queue.pop_front();
+      d_busy++;
+      d_job_done.notify_all();
+
+      lock.unlock();
+      d_function(job);
+      job.values.clear();
+      lock.lock();
+
+      //keep not more vectors than may be in the queue:
+      if(d_spare.size() < d_max_jobs)
+	{
+	  d_spare.push_back(std::vector<double>());
+	  d_spare.back().swap(job.values);
+	}
+      d_busy--;
+      d_job_done.notify_all();
+    }
+}
@@ -0,0 +1,45 @@
+#!/bin/sh
+#
+# Benchmark of the splitting and roulette: runs exgps with bias_analog.mac,
+# bias_importance.mac and bias_ww.mac in the directories bench_analog,
+# bench_importance and bench_ww, prints the score per history and the
+# figure of merit 1/(R^2*T) of the detector of each run, and the gain
+# in the figure of merit over the analog run.
+#
+# Usage, from the exgps directory:
+#   tools/bias_benchmark.sh [EXGPS [THREADS [DETECTOR]]]
+# EXGPS is ./exgps by default, DETECTOR is DET.INSIDE.
+#
+# Taras Schevchenko National University of Kyiv, 2012.
+
+EXE=${1:-./exgps}
+THREADS=${2:-1}
+DETECTOR=${3:-DET.INSIDE}
+EXE="$(cd "$(dirname "$EXE")" && pwd)/$(basename "$EXE")"
+SOURCE_DIR="$(pwd)"
+
+for mode in analog importance ww; do
+    mkdir -p "bench_$mode"
+    (cd "bench_$mode" && "$EXE" "$SOURCE_DIR/bias_$mode.mac" "$THREADS" > run.log 2>&1) || {
+        echo "exgps failed, see bench_$mode/run.log"; exit 1; }
+done
+
+# the last run of the log: "NAME: N histories, score per history M +- R%,
+# figure of merit 1/(R^2*T) = F 1/s"
+fom() {
+    grep "^$DETECTOR: " "bench_$1/run.log" | tail -1 | sed -n 's/.*= \([^ ]*\) 1\/s$/\1/p'
+}
+
+analog=$(fom analog)
+status=0
+for mode in analog importance ww; do
+    line=$(grep "^$DETECTOR: " "bench_$mode/run.log" | tail -1)
+    value=$(fom $mode)
+    if [ -z "$value" ]; then
+        echo "$mode: no figure of merit(no score?): $line"; status=2; continue
+    fi
+    echo "$mode: $line"
+    awk -v a="$analog" -v v="$value" -v m="$mode" \
+        'BEGIN { if(a > 0) printf("%s: gain in the figure of merit %.2f\n", m, v/a) }'
+done
+exit $status
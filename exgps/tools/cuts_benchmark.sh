@@ -0,0 +1,40 @@
+#!/bin/sh
+#
+# Benchmark of the production cuts: runs exgps with cuts_fine.mac and
+# cuts_coarse.mac in the directories bench_fine and bench_coarse,
+# prints events/s of both runs and compares every histogram of the
+# coarse run with the fine one by histcmp(built with exgps).
+#
+# Usage, from the exgps directory:
+#   tools/cuts_benchmark.sh [EXGPS [THREADS]]
+# EXGPS is ./exgps by default, histcmp is looked for next to it.
+#
+# Taras Schevchenko National University of Kyiv, 2012.
+
+EXE=${1:-./exgps}
+THREADS=${2:-1}
+EXE="$(cd "$(dirname "$EXE")" && pwd)/$(basename "$EXE")"
+HISTCMP=${HISTCMP:-"$(dirname "$EXE")/histcmp"}
+SOURCE_DIR="$(pwd)"
+
+for mode in fine coarse; do
+    mkdir -p "bench_$mode"
+    (cd "bench_$mode" && "$EXE" "$SOURCE_DIR/cuts_$mode.mac" "$THREADS" > run.log 2>&1) || {
+        echo "exgps failed, see bench_$mode/run.log"; exit 1; }
+done
+
+fine_rate=$(grep "events/s" bench_fine/run.log | tail -1 | awk '{print $(NF-1)}')
+coarse_rate=$(grep "events/s" bench_coarse/run.log | tail -1 | awk '{print $(NF-1)}')
+echo "fine cuts:   $fine_rate events/s"
+echo "coarse cuts: $coarse_rate events/s"
+awk -v f="$fine_rate" -v c="$coarse_rate" 'BEGIN { if(f > 0) printf("speedup:     %.2f\n", c/f) }'
+
+status=0
+for fine in bench_fine/*_hist.dat; do
+    coarse="bench_coarse/$(basename "$fine")"
+    if [ ! -f "$coarse" ]; then
+        echo "$coarse: missing"; status=2; continue
+    fi
+    "$HISTCMP" "$fine" "$coarse" || status=2
+done
+exit $status
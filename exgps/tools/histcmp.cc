@@ -0,0 +1,105 @@
+/* ========================================================== */
+// Part of simulation for use with GEANT4 code.
+// Compares two histograms(*_hist.dat files) written by DetectorSD2:
+// chi2 per degree of freedom, ratio of the sums and the largest pull.
+//
+// Usage: histcmp A_hist.dat B_hist.dat [SCALE]
+// B is multiplied by SCALE(1 by default), e.g. the ratio of the events
+// of the runs. Errors are taken from the third column if there is one,
+// sqrt(count) otherwise. Exit code: 0 if the histograms agree,
+// 2 if they don't, 1 on errors.
+//
+// Taras Schevchenko National University of Kyiv, 2012.
+/* ========================================================== */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <map>
+#include <string>
+
+/** count and squared error of a bin*/
+struct bin_value
+{
+  double count;
+  double error2;
+};
+
+/** Read "bin count [error]" lines, bins are keyed by their centers.
+    \return false if the file can't be read.*/
+static bool read_histogram(const char *name, std::map<double, bin_value> &bins)
+{
+  FILE *fp = fopen(name, "r");
+  if(fp == NULL)
+    return false;
+  char line[512];
+  while(fgets(line, sizeof(line), fp) != NULL)
+    {
+      double center, count, error;
+      const int n = sscanf(line, "%lf %lf %lf", &center, &count, &error);
+      if(n < 2)
+	continue;
+      bin_value &value = bins[center];
+      value.count += count;
+      value.error2 += (n > 2)? error*error : fabs(count);
+    }
+  fclose(fp);
+  return true;
+}
+
+int main(int argc, char **argv)
+{
+  if(argc < 3)
+    {
+      fprintf(stderr, "Usage: %s A_hist.dat B_hist.dat [SCALE]\n", argv[0]);
+      return 1;
+    }
+  const double scale = (argc > 3)? atof(argv[3]) : 1.0;
+  std::map<double, bin_value> a, b;
+  if(!read_histogram(argv[1], a) || !read_histogram(argv[2], b))
+    {
+      fprintf(stderr, "%s: can't read %s or %s\n", argv[0], argv[1], argv[2]);
+      return 1;
+    }
+  //bins missing in one of the files are empty there:
+  std::map<double, bin_value>::const_iterator iter;
+  for(iter = a.begin(); iter != a.end(); iter++)
+    b[iter->first];
+  for(iter = b.begin(); iter != b.end(); iter++)
+    a[iter->first];
+
+  double chi2 = 0, sum_a = 0, sum_b = 0;
+  double max_pull = 0, max_pull_bin = 0;
+  long ndf = 0;
+  for(iter = a.begin(); iter != a.end(); iter++)
+    {
+      const bin_value &x = iter->second;
+      const bin_value &y = b[iter->first];
+      sum_a += x.count;
+      sum_b += scale*y.count;
+      const double sigma2 = x.error2 + scale*scale*y.error2;
+      if(!(sigma2 > 0))
+	continue;
+      const double pull = (x.count - scale*y.count)/sqrt(sigma2);
+      chi2 += pull*pull;
+      ndf++;
+      if(fabs(pull) > fabs(max_pull))
+	{
+	  max_pull = pull;
+	  max_pull_bin = iter->first;
+	}
+    }
+  if(ndf == 0)
+    {
+      fprintf(stderr, "%s: the histograms are empty\n", argv[0]);
+      return 1;
+    }
+  //chi2/ndf of the same distribution is 1 +- sqrt(2/ndf):
+  const double limit = 1 + 3*sqrt(2.0/ndf);
+  const bool agree = chi2/ndf < limit;
+  printf("%s vs %s: %ld bins, chi2/ndf %g (limit %g), sum ratio %g, max pull %g at %g: %s\n",
+	 argv[1], argv[2], ndf, chi2/ndf, limit,
+	 (sum_b != 0)? sum_a/sum_b : 0.0, max_pull, max_pull_bin,
+	 agree? "agree" : "DIFFER");
+  return agree? 0 : 2;
+}
@@ -0,0 +1,75 @@
+/* ========================================================== */
+// Part of simulation for use with GEANT4 code.
+// Converts binary raw-energy files(*_unit.bin) written by DetectorSD2
+// to the text format of *_unit.raw files: one "%f" value per line.
+//
+// Usage: raw2text FILE.bin [FILE.raw]
+// If the output name is omitted, ".bin" is replaced with ".raw".
+//
+// Taras Schevchenko National University of Kyiv, 2012.
+/* ========================================================== */
+
+#include "raw_file.h"
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+int main(int argc, char **argv)
+{
+  if(argc < 2)
+    {
+      fprintf(stderr, "Usage: %s FILE.bin [FILE.raw]\n", argv[0]);
+      return 1;
+    }
+  std::string input = argv[1];
+  std::string output;
+  if(argc > 2)
+    output = argv[2];
+  else
+    {
+      output = input;
+      size_t pos = output.rfind(".bin");
+      if(pos != std::string::npos && pos + 4 == output.size())
+	output.replace(pos, 4, ".raw");
+      else
+	output += ".raw";
+    }
+
+  raw_file file;
+  if(file.open_read(input) != 0)
+    {
+      fprintf(stderr, "%s: not a binary raw file: %s\n", argv[0], input.c_str());
+      return 1;
+    }
+  const raw_file_header &header = file.header();
+  fprintf(stderr, "%s: detector %s, %s energy of %s, %s units, %llu values, %llu events\n",
+	  input.c_str(), header.detector_name.c_str(), header.quantity.c_str(),
+	  header.species.c_str(), header.unit_name(),
+	  header.value_count, header.event_count);
+
+  FILE *fp = fopen(output.c_str(), "w");
+  if(fp == NULL)
+    {
+      fprintf(stderr, "%s: can't open file %s\n", argv[0], output.c_str());
+      return 1;
+    }
+  std::vector<double> values(1 << 16);
+  unsigned long long n_total = 0;
+  size_t n_read;
+  while((n_read = file.read(&values[0], values.size())) > 0)
+    {
+      //same narrowing as in DetectorSD2::dump_vector():
+      for(size_t i = 0; i < n_read; i++)
+	fprintf(fp, "%f\n", (float)values[i]);
+      n_total += n_read;
+    }
+  fclose(fp);
+  file.close();
+  if(n_total != header.value_count)
+    {
+      fprintf(stderr, "%s: expected %llu values, got %llu\n",
+	      argv[0], header.value_count, n_total);
+      return 1;
+    }
+  return 0;
+}
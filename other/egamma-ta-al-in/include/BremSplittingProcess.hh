@@ -0,0 +1,73 @@
+/* ========================================================== */
+// Part of simulation for use with GEANT4 code.
+// Uniform bremsstrahlung splitting in a chosen region.
+//
+// Taras Schevchenko National University of Kyiv, 2012.
+/* ========================================================== */
+
+#ifndef BremSplittingProcess_h
+#define BremSplittingProcess_h 1
+
+#include "G4WrapperProcess.hh"
+#include "globals.hh"
+
+class G4Region;
+
+/** Region where the splitting is done if no other one is chosen,
+    DetectorConstruction puts the TL_PLATE converter into it.*/
+#define BREM_SPLIT_DEFAULT_REGION "CONVERTER"
+
+class BremSplittingProcess : public G4WrapperProcess
+{
+  /**
+     Wraps G4eBremsstrahlung: each interaction of the electron
+     inside of the chosen region is sampled N times by the wrapped process,
+     all emitted photons are kept with weight (electron's weight)/N.
+     The electron itself gets the final state of the last sample.
+     Only the tracks of full weight are split: the lineage of a split
+     photon(e.g. e+e- pairs it makes in the region) keeps weight 1/N.
+     With N = 1 the process is the same as the wrapped one.
+     Parameters are common to all instances(e- and e+ have one each),
+     so they may be changed from the /construction/ messenger between runs.
+   */
+public:
+  BremSplittingProcess();
+  ~BremSplittingProcess();
+
+  G4VParticleChange* PostStepDoIt(const G4Track &track, const G4Step &step);
+
+  /** Set the number of photons per interaction, 1 disables splitting.*/
+  static void set_split_factor(const G4int factor);
+
+  static G4int get_split_factor()
+  {
+    return split_factor;
+  }
+
+  /** Set name of the G4Region where interactions are split.*/
+  static void set_region_name(const G4String &name);
+
+  static const G4String& get_region_name()
+  {
+    return region_name;
+  }
+
+  /** \return true if the photons get weights other than 1.*/
+  static G4bool is_enabled()
+  {
+    return split_factor > 1;
+  }
+
+private:
+  /** \return the region by it's name, NULL if there is no such region.*/
+  static G4Region* find_region();
+
+  static G4int split_factor;
+  static G4String region_name;
+
+  /** region_name resolved by find_region(), reset on renaming*/
+  static G4Region *region;
+  static G4bool region_looked_up;
+};
+
+#endif
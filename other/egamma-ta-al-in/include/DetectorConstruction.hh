@@ -27,6 +27,7 @@
 #include "G4VUserDetectorConstruction.hh"
 #include "DetectorSD.hh"
 #include "DetectorConstructionMessenger.hh"
+#include "BremSplittingProcess.hh"
 
 #include <string>
 #include "geom_objects.h"
@@ -190,6 +191,24 @@ class DetectorConstruction : public G4VUserDetectorConstruction
   }
 
 
+  /** Set number of photons emitted per bremsstrahlung interaction
+      in the splitting region, 1 -- no splitting.
+      \param split factor.
+   */
+  void set_brem_split_factor(const G4int factor)
+  {
+    BremSplittingProcess::set_split_factor(factor);
+  }
+
+  /** Set the region where bremsstrahlung is split,
+      "CONVERTER"(the TL_PLATE) by default.
+      \param name of the G4Region.
+   */
+  void set_brem_split_region(const G4String &name)
+  {
+    BremSplittingProcess::set_region_name(name);
+  }
+
   /**Return value of energy units used.
      \return energy units used: case 0: eV, case 1: keV, case 2: MeV.
    */
@@ -101,6 +101,12 @@ private:
 
   /** Set number of histogram max value.  */
   G4UIcmdWithADoubleAndUnit* cmd_histo_max;
+
+  /** Set number of photons per bremsstrahlung interaction. */
+  G4UIcmdWithAnInteger* cmd_brem_split;
+
+  /** Set region where bremsstrahlung is split. */
+  G4UIcmdWithAString* cmd_brem_split_region;
     
 
 };
@@ -9,10 +9,13 @@
 #ifndef DetectorSD2_h
 #define DetectorSD2_h 1
 #include "G4VSensitiveDetector.hh"
+//shared with exgps, whose DetectorSD2 scores split histories the same way:
+#include "../../../exgps/include/BranchDeposits.hh"
 #include <ios>
 #include <iostream>
 #include <fstream>
 #include <map>
+#include <vector>
 #include <utility>
 
 #define MAX_BATCH_SIZE 200000
@@ -26,6 +29,11 @@ class DetectorSD2: public G4VSensitiveDetector
   /**
      This sensitive detector class counts deposited particle's energy
      and it's initial kinetic enegy(without losses).
+     In the weighted mode(variance reduction is on) each record has got
+     the weight of the particle and goes to *.wraw files of 2 columns:
+     value, weight. Deposited energy is then summed per particle that
+     entered the detector(with all of it's secondaries) instead of per event,
+     because the split photons of one event are alternatives of each other.
    */
 public:
 
@@ -45,10 +53,10 @@ public:
       \param Pointer to particle definition
       \param energy value
       \param energy unit, case 0: eV, case 1: keV, case 2: MeV.
-      
+      \param weight of the particle, kept in the weighted mode only.
   */
   void fill_hist(const G4String &pname, const double energy,
-		 const unsigned EUNIT=1);
+		 const unsigned EUNIT=1, const double weight=1.0);
 
   
   /** Get known about particle type from given definition
@@ -63,10 +71,10 @@ public:
       \param Pointer to particle definition
       \param energy value
       \param energy unit, case 0: eV, case 1: keV, case 2: MeV.
-      
+      \param weight of the particle, kept in the weighted mode only.
   */
   void fill_hist_deposited(const G4String &pname, const double energy,
-			   const unsigned EUNIT=1);
+			   const unsigned EUNIT=1, const double weight=1.0);
 
   
   /** Get known about particle type from given definition
@@ -90,6 +98,13 @@ public:
 
   /** Save all data vectors to files. Call this at the end of work.*/
   void save_all();
+
+  /** Switch the weighted mode, call it between runs only,
+      when the data vectors are saved.*/
+  void set_weighted(const bool is_weighted)
+  {
+    weighted = is_weighted;
+  }
 private:
   
   /** clear the vectors with raw spectra.*/
@@ -99,6 +114,16 @@ private:
   void dump_vector(const char *filename,
 		   std::vector<double> &vector,
 		   bool append = true ) const;
+
+  /** Dump the data and their weights to file of 2 columns.*/
+  void dump_vector(const char *filename,
+		   std::vector<double> &vector,
+		   std::vector<double> &weights,
+		   bool append = true ) const;
+
+  /** Name of the file for the particle's records,
+      \param "kinetic" or "deposited"*/
+  G4String data_filename(const char *kind, const G4String &pname) const;
 private:
   
   unsigned  d_energy_units;
@@ -106,6 +131,15 @@ private:
   std::map<G4String, std::vector <double> > named_vector_map_Ekin;
   std::map<G4String, std::vector <double> > named_vector_map_Edep;
   std::map<G4String, std::vector <double> >::iterator the_iterator;
+
+  /** weights of the records of the maps above, weighted mode only*/
+  std::map<G4String, std::vector <double> > named_weight_map_Ekin;
+  std::map<G4String, std::vector <double> > named_weight_map_Edep;
+  bool weighted;
+
+  /** deposits of the current event per particle which entered
+      the detector, weighted mode only*/
+  BranchDeposits branch_deposits;
   
   
 private:
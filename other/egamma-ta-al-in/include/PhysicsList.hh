@@ -12,6 +12,8 @@
 #include "G4VUserPhysicsList.hh"
 #include "globals.hh"
 
+class G4VProcess;
+
 class PhysicsList: public G4VUserPhysicsList
 {
   public:
@@ -26,6 +28,9 @@ class PhysicsList: public G4VUserPhysicsList
 
     // these methods Construct physics processes and register them
     void ConstructEM();
+
+    /** \return new bremsstrahlung process, see BremSplittingProcess.*/
+    G4VProcess* brem_process();
 };
 
 #endif
@@ -0,0 +1,97 @@
+/* ========================================================== */
+// Part of simulation for use with GEANT4 code.
+// Uniform bremsstrahlung splitting in a chosen region.
+//
+// Taras Schevchenko National University of Kyiv, 2012.
+/* ========================================================== */
+
+#include "BremSplittingProcess.hh"
+
+#include "G4VParticleChange.hh"
+#include "G4Track.hh"
+#include "G4Step.hh"
+#include "G4StepPoint.hh"
+#include "G4VPhysicalVolume.hh"
+#include "G4LogicalVolume.hh"
+#include "G4Region.hh"
+#include "G4RegionStore.hh"
+
+#include <vector>
+
+G4int BremSplittingProcess::split_factor = 1;
+G4String BremSplittingProcess::region_name = BREM_SPLIT_DEFAULT_REGION;
+G4Region* BremSplittingProcess::region = NULL;
+G4bool BremSplittingProcess::region_looked_up = false;
+
+BremSplittingProcess::BremSplittingProcess(): G4WrapperProcess("split_")
+{
+}
+
+BremSplittingProcess::~BremSplittingProcess()
+{
+}
+
+void BremSplittingProcess::set_split_factor(const G4int factor)
+{
+  split_factor = (factor > 1)? factor : 1;
+}
+
+void BremSplittingProcess::set_region_name(const G4String &name)
+{
+  region_name = name;
+  region = NULL;
+  region_looked_up = false;
+}
+
+G4Region* BremSplittingProcess::find_region()
+{
+  if(!region_looked_up)
+    {//regions are made by DetectorConstruction::Construct(), look for it once:
+      region = G4RegionStore::GetInstance()->GetRegion(region_name, false);
+      region_looked_up = true;
+      if(region == NULL)
+	G4cout << "BremSplittingProcess: (warning) there is no region \""
+	       << region_name << "\", bremsstrahlung is not split.\n";
+    }
+  return region;
+}
+
+G4VParticleChange* BremSplittingProcess::PostStepDoIt(const G4Track &track,
+						       const G4Step &step)
+{
+  G4VParticleChange *change = pRegProcess->PostStepDoIt(track, step);
+  if(split_factor <= 1) return change;
+  //e- and e+ of the split photons converted in the region are split no more,
+  //their photons would get the weights 1/N^2, 1/N^3...(primaries weigh 1):
+  if(track.GetWeight() < 1) return change;
+
+  G4VPhysicalVolume *volume = step.GetPreStepPoint()->GetPhysicalVolume();
+  if(volume == NULL || find_region() == NULL
+     || volume->GetLogicalVolume()->GetRegion() != region)
+    return change;
+
+  //each new sample clears the secondaries of the previous one,
+  //so they are copied out first:
+  std::vector<G4Track*> photons;
+  photons.reserve(split_factor);
+  const G4int verbose = change->GetVerboseLevel();
+  change->SetVerboseLevel(0);
+  for(G4int i = 0; i < split_factor; i++)
+    {
+      if(i > 0)
+	change = pRegProcess->PostStepDoIt(track, step);
+      for(G4int k = 0; k < change->GetNumberOfSecondaries(); k++)
+	photons.push_back(new G4Track(*change->GetSecondary(k)));
+    }
+  change->SetNumberOfSecondaries(photons.size());
+  change->SetVerboseLevel(verbose);
+  change->SetSecondaryWeightByProcess(true);
+
+  const G4double weight = track.GetWeight()/split_factor;
+  for(size_t i = 0; i < photons.size(); i++)
+    {
+      photons[i]->SetWeight(weight);
+      change->AddSecondary(photons[i]);
+    }
+  return change;
+}
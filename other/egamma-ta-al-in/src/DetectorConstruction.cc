@@ -29,6 +29,7 @@
 
 #include "DetectorConstruction.hh"
 #include "quick_geom.hh"
+#include "G4Region.hh"
 
 DetectorConstruction::DetectorConstruction()
 {
@@ -259,6 +260,9 @@ G4VPhysicalVolume* DetectorConstruction::Construct()
 	     cap_diameter/2,
 	     cap_diameter/2,
 	     cap_thickness/2  );
+  //the converter is a region of it's own, bremsstrahlung may be split there:
+  G4Region *converter_region = new G4Region(BREM_SPLIT_DEFAULT_REGION);
+  converter_region->AddRootLogicalVolume(tl_plane_box->get_logical());
   /**
      детектор-заглушка для отримання спектру просто без
      самопоглинання чи якихось реакції всередині матеріалу детектора.
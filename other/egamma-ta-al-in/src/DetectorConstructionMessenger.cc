@@ -125,6 +125,21 @@ DetectorConstructionMessenger::DetectorConstructionMessenger(DetectorConstructio
   cmd_histo_max -> SetRange("Size>=0.");
   cmd_histo_max -> SetUnitCategory("Length");
   cmd_histo_max -> AvailableForStates(G4State_Idle); 
+
+  cmd_brem_split =  new G4UIcmdWithAnInteger("/construction/brem_split",this);
+  cmd_brem_split -> SetGuidance("Number of photons emitted per bremsstrahlung interaction");
+  cmd_brem_split -> SetGuidance("in the splitting region, each with 1/N of electron's weight.");
+  cmd_brem_split -> SetGuidance("1 -- no splitting(default).");
+  cmd_brem_split -> SetParameterName("Number",true);
+  cmd_brem_split -> SetDefaultValue(1);
+  cmd_brem_split -> SetRange("Number>=1");
+  cmd_brem_split -> AvailableForStates(G4State_PreInit, G4State_Idle); 
+
+  cmd_brem_split_region =  new G4UIcmdWithAString("/construction/brem_split_region",this);
+  cmd_brem_split_region -> SetGuidance("Region where bremsstrahlung is split,");
+  cmd_brem_split_region -> SetGuidance(BREM_SPLIT_DEFAULT_REGION " (the TL_PLATE) by default.");
+  cmd_brem_split_region -> SetParameterName("Region",false);
+  cmd_brem_split_region -> AvailableForStates(G4State_PreInit, G4State_Idle); 
     
   
 }
@@ -146,6 +161,8 @@ DetectorConstructionMessenger::~DetectorConstructionMessenger()
   delete cmd_histo_bins;
   delete cmd_histo_min;
   delete cmd_histo_max;
+  delete cmd_brem_split;
+  delete cmd_brem_split_region;
 
   delete valueDir;
 }
@@ -197,6 +214,12 @@ void DetectorConstructionMessenger::SetNewValue(G4UIcommand* command,G4String ne
   if(command == cmd_histo_max)
     detector -> set_histo_max
       (cmd_histo_max -> GetNewDoubleValue(newValue));
+
+  if(command == cmd_brem_split)
+    detector -> set_brem_split_factor
+      (cmd_brem_split -> GetNewIntValue(newValue));
+  if(command == cmd_brem_split_region)
+    detector -> set_brem_split_region(newValue);
   
 }
 
@@ -46,6 +46,7 @@ DetectorSD2::DetectorSD2(G4String name): G4VSensitiveDetector(name)
   runAction = (RunAction*) G4RunManager::GetRunManager()->GetUserRunAction();
   d_energy_units=1;
   debug_output = false;
+  weighted = false;
   temp_count = 0;
 }
 
@@ -59,6 +60,7 @@ void DetectorSD2::Initialize(G4HCofThisEvent*)
 {
   // в начале события сбрасываем энергию поглощенную детектором
   detEnergy = 0;
+  branch_deposits.clear();
 }
 
 G4bool DetectorSD2::ProcessHits(G4Step* step, G4TouchableHistory*)
@@ -71,6 +73,10 @@ G4bool DetectorSD2::ProcessHits(G4Step* step, G4TouchableHistory*)
   G4double edep = step->GetTotalEnergyDeposit();
   detEnergy += edep;
 
+  //split photons of one electron are alternatives of each other:
+  if(weighted)
+    branch_deposits.add(track, edep);
+
   if(debug_output)
     {
       G4cout<< "\n---\n"
@@ -87,6 +93,16 @@ void DetectorSD2::EndOfEvent(G4HCofThisEvent*)
 {
   // сохраняем энергию накопленную за событие в детекторе
   // в гистограмму
+  if(weighted)
+    {
+      BranchDeposits::branch_map::const_iterator iter;
+      for(iter = branch_deposits.branches().begin();
+	  iter != branch_deposits.branches().end(); iter++)
+	if(iter->second.energy > 0)
+	  fill_hist_deposited(iter->second.definition->GetParticleName(),
+			      iter->second.energy, d_energy_units, iter->second.weight);
+      return;
+    }
   if(detEnergy > 0)
     fill_hist_deposited(particle_name, detEnergy);
 }
@@ -119,7 +135,8 @@ void DetectorSD2::fill_hist_deposited(const G4ParticleDefinition *pdef, const do
     \param Pointer to particle definition
     \param Energy in keV units.
 */
-void DetectorSD2::fill_hist(const G4String &pname, const double energy, const unsigned EUNIT)
+void DetectorSD2::fill_hist(const G4String &pname, const double energy, const unsigned EUNIT,
+			    const double weight)
 {
   if(EUNIT <= 2) d_energy_units = EUNIT;
   if(energy < 0) return;
@@ -146,6 +163,8 @@ void DetectorSD2::fill_hist(const G4String &pname, const double energy, const un
 		 << the_iterator->second.size() << "\n";
 	}
       the_iterator->second.push_back(value);
+      if(weighted)
+	named_weight_map_Ekin[pname].push_back(weight);
       if(the_iterator->second.size() > MAX_BATCH_SIZE)
 	{
 	  save_Ekinetic(the_iterator);
@@ -156,6 +175,8 @@ void DetectorSD2::fill_hist(const G4String &pname, const double energy, const un
       std::vector <double> new_vec;
       new_vec.push_back(value);
       named_vector_map_Ekin.insert(pair<G4String, std::vector <double> >(pname, new_vec));
+      if(weighted)
+	named_weight_map_Ekin[pname].push_back(weight);
 
       if(debug_output)
 	{
@@ -182,7 +203,8 @@ void DetectorSD2::fill_hist(const G4String &pname, const double energy, const un
 */
 void DetectorSD2::fill_hist_deposited(const G4String &pname,
 				      const double energy,
-				      const unsigned EUNIT)
+				      const unsigned EUNIT,
+				      const double weight)
 {
   if(EUNIT <= 2) d_energy_units = EUNIT;
   if(energy < 0) return;
@@ -200,6 +222,8 @@ void DetectorSD2::fill_hist_deposited(const G4String &pname,
   if(the_iterator != named_vector_map_Edep.end())
     {//if the given particle name has been found:
       the_iterator->second.push_back(value);
+      if(weighted)
+	named_weight_map_Edep[pname].push_back(weight);
       if(the_iterator->second.size() > MAX_BATCH_SIZE)
 	{
 	  save_Edeposited(the_iterator);
@@ -212,6 +236,8 @@ void DetectorSD2::fill_hist_deposited(const G4String &pname,
       std::vector <double> new_vec;
       new_vec.push_back(value);
       named_vector_map_Edep.insert(pair<G4String, std::vector <double> >(pname, new_vec));
+      if(weighted)
+	named_weight_map_Edep[pname].push_back(weight);
     }
 			      
 }
@@ -221,6 +247,8 @@ void DetectorSD2::clear_raw_data()
 {
   named_vector_map_Ekin.clear();
   named_vector_map_Edep.clear();
+  named_weight_map_Ekin.clear();
+  named_weight_map_Edep.clear();
 }
 
 /** Dump the data from vector to file.*/
@@ -241,24 +269,54 @@ void DetectorSD2::dump_vector(const char *filename,
     }
 }
 
+/** Dump the data and their weights to file of 2 columns.*/
+void DetectorSD2::dump_vector(const char *filename,
+			      std::vector<double> &vector,
+			      std::vector<double> &weights, bool append) const
+{
+  if(weights.size() != vector.size())
+    {//the values can't be matched with the weights any more:
+      G4cerr << "DetectorSD2: " << vector.size() << " values and " << weights.size()
+	     << " weights for \"" << ((filename != NULL)? filename : "") << "\", not written.\n";
+      return;
+    }
+  if(filename!=NULL && (!vector.empty()))
+    {
+      FILE *fp = fopen(filename, (append)? "a+" : "w+");
+      if(fp!=NULL)
+	{
+	  for(unsigned i = 0; i < vector.size(); i++)
+	    fprintf(fp,"%f\t%g\n", (float)vector[i], weights[i]);
+	  fclose(fp);
+	}
+    }
+}
+
+/** Name of the file for the particle's records,
+    the weighted ones are written to *.wraw files.*/
+G4String DetectorSD2::data_filename(const char *kind, const G4String &pname) const
+{
+  G4String filename = G4VSensitiveDetector::SensitiveDetectorName;
+  filename += G4String("_") + kind + "_" + pname;
+  switch(d_energy_units)
+    {
+    case 0:  filename += "_eV_unit"; break;
+    case 1:  filename += "_keV_unit"; break;
+    case 2:  filename +=  "_MeV_unit"; break;
+    default:
+      filename += "_keV_unit"; break;
+    }
+  filename += (weighted)? ".wraw" : ".raw";
+  return filename;
+}
+
 void DetectorSD2::save_Ekinetic(std::map<G4String, std::vector <double> >::iterator &named_particle_iterator, bool noclear)
 {
   if(named_particle_iterator != (this->named_vector_map_Ekin.end())
      && !named_vector_map_Ekin.empty())
     {
-      G4String filename;
       G4String sensDetName = G4VSensitiveDetector::SensitiveDetectorName;
-      //make filename:
-      filename += sensDetName + "_kinetic_" + named_particle_iterator->first;
-      
-      switch(d_energy_units)
-	{
-	case 0:  filename += "_eV_unit.raw"; break;
-	case 1:  filename += "_keV_unit.raw"; break;
-	case 2:  filename +=  "_MeV_unit.raw"; break;
-	default:
-	  filename += "_keV_unit.raw"; break;
-	}
+      G4String filename = data_filename("kinetic", named_particle_iterator->first);
       if(debug_output)
 	{
 	  G4cout << "SAVING KINETIC ENERGY VEC:\n"
@@ -269,7 +327,15 @@ void DetectorSD2::save_Ekinetic(std::map<G4String, std::vector <double> >::itera
 		 << named_particle_iterator->second.size() << "\n------\n";
 	}
       //--write raw particle's energies
-      dump_vector(filename, named_particle_iterator->second, true);
+      if(weighted)
+	{
+	  std::vector<double> &weights = named_weight_map_Ekin[named_particle_iterator->first];
+	  dump_vector(filename, named_particle_iterator->second, weights, true);
+	  if( !noclear)
+	    weights.clear();
+	}
+      else
+	dump_vector(filename, named_particle_iterator->second, true);
       //clear vector:
       if( !noclear)
 	named_particle_iterator->second.clear();
@@ -282,19 +348,8 @@ void DetectorSD2::save_Edeposited(std::map<G4String, std::vector <double> >::ite
   if(named_particle_iterator != this->named_vector_map_Edep.end()
      && !named_vector_map_Edep.empty())
     {
-      G4String filename;
       G4String sensDetName = G4VSensitiveDetector::SensitiveDetectorName;
-      //make filename:
-      filename += sensDetName + "_deposited_" + named_particle_iterator->first;
-      
-      switch(d_energy_units)
-	{
-	case 0:  filename += "_eV_unit.raw"; break;
-	case 1:  filename += "_keV_unit.raw"; break;
-	case 2:  filename +=  "_MeV_unit.raw"; break;
-	default:
-	  filename += "_keV_unit.raw"; break;
-	}
+      G4String filename = data_filename("deposited", named_particle_iterator->first);
       if(debug_output)
 	{
 	  G4cout << "SAVING DEPOSITED ENERGY VEC:\n"
@@ -305,7 +360,15 @@ void DetectorSD2::save_Edeposited(std::map<G4String, std::vector <double> >::ite
 		 << named_particle_iterator->second.size() << "\n------\n";
 	}
       //--write raw particle's energies
-      dump_vector(filename, named_particle_iterator->second, true);
+      if(weighted)
+	{
+	  std::vector<double> &weights = named_weight_map_Edep[named_particle_iterator->first];
+	  dump_vector(filename, named_particle_iterator->second, weights, true);
+	  if( !noclear)
+	    weights.clear();
+	}
+      else
+	dump_vector(filename, named_particle_iterator->second, true);
       if( !noclear)
 	named_particle_iterator->second.clear();
     }
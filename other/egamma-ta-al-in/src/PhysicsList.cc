@@ -52,6 +52,7 @@ void PhysicsList::ConstructProcess()
 #include "G4eMultipleScattering.hh"
 
 #include "G4UrbanMscModel93.hh"
+#include "BremSplittingProcess.hh"
 
 void PhysicsList::ConstructEM()
 {
@@ -74,7 +75,7 @@ void PhysicsList::ConstructEM()
       //pmanager->AddProcess(new G4eMultipleScattering,-1, 1,1);
       pmanager->AddProcess(msc,                     -1, 1, 1);      
       pmanager->AddProcess(new G4eIonisation,       -1, 2,2);
-      pmanager->AddProcess(new G4eBremsstrahlung,   -1, 3,3);      
+      pmanager->AddProcess(brem_process(),          -1, 3,3);      
 
     } else if (particleName == "e+") {
       G4eMultipleScattering* msc = new G4eMultipleScattering();
@@ -82,12 +83,21 @@ void PhysicsList::ConstructEM()
       //pmanager->AddProcess(new G4eMultipleScattering,-1, 1,1);
       pmanager->AddProcess(msc,                     -1, 1, 1);      
       pmanager->AddProcess(new G4eIonisation,       -1, 2,2);
-      pmanager->AddProcess(new G4eBremsstrahlung,   -1, 3,3);
+      pmanager->AddProcess(brem_process(),          -1, 3,3);
       pmanager->AddProcess(new G4eplusAnnihilation,  0,-1,4);
     }
   }
 }
 
+/** G4eBremsstrahlung wrapped by the splitting process,
+    which is off until /construction/brem_split is given.*/
+G4VProcess* PhysicsList::brem_process()
+{
+  BremSplittingProcess *splitting = new BremSplittingProcess();
+  splitting->RegisterProcess(new G4eBremsstrahlung);
+  return splitting;
+}
+
 void PhysicsList::SetCuts()
 {
   // default cut value for all particle types 
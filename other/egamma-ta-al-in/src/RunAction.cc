@@ -29,6 +29,7 @@
 
 #include "RunAction.hh"
 #include "Hist1i.h"
+#include "BremSplittingProcess.hh"
 
 #include "G4Run.hh"
 #include "Randomize.hh"
@@ -56,6 +57,18 @@ void RunAction::BeginOfRunAction(const G4Run*)
   G4cout << "\n*********************************************\n";
   G4cout << "\n\n=======================\nBegin of RunAction:\n";
   
+  //split photons have weights, the detectors have to record them:
+  const bool weighted = BremSplittingProcess::is_enabled();
+  if(weighted)
+    G4cout << "Bremsstrahlung splitting: " << BremSplittingProcess::get_split_factor()
+	   << " photons per interaction in region "
+	   << BremSplittingProcess::get_region_name() << "\n";
+  if(this->DSD_vector!=NULL)
+    {
+      std::vector<DetectorSD2*>::iterator iter;
+      for(iter = DSD_vector->begin(); iter < DSD_vector->end(); iter++)
+	(*iter)->set_weighted(weighted);
+    }
 }
 
 /** 
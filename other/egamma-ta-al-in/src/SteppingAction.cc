@@ -75,7 +75,8 @@ void SteppingAction::UserSteppingAction(const G4Step* aStep)
 	{
 	  if( (*iter)->GetName() == sensName)
 	    {
-	      (*iter)->fill_hist(particleName, track->GetKineticEnergy());
+	      (*iter)->fill_hist(particleName, track->GetKineticEnergy(),
+				 1, track->GetWeight());
 	      // G4cout << "stepping: DetectorSD name: " << sensName
 	      //  	     << " track ID: "<< track->GetTrackID()
 	      //  	     << " p.name: "  << particleName